@@ -15,6 +15,8 @@ private:
     void testingMenu();
     void realImageMenu();
     void benchmarkMenu();
+    void performanceMenu();
+    void chooseKNNSearchMode();
 
     void clearScreen();
     void pressAnyKeyToContinue();
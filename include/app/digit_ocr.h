@@ -5,11 +5,13 @@
 #include <string>
 #include <vector>
 
+#include "baselines/common/feature_dataset.h"
 #include "baselines/common/training_sample.h"
 #include "baselines/knn/feature_extractor.h"
 #include "baselines/knn/knn_classifier.h"
 #include "baselines/neural_network/neural_network_classifier.h"
 #include "core/image_matrix.h"
+#include "data/feature_cache.h"
 #include "data/mnist_loader.h"
 #include "preprocess/preprocessor.h"
 
@@ -24,17 +26,43 @@ public:
 
     void trainModel(const std::string& trainingDataPath, AlgorithmType algo = AlgorithmType::KNN);
     std::string recognize(const ImageMatrix& image, AlgorithmType algo = AlgorithmType::KNN);
+    // Feeds operator-corrected digits back into the live KNN model: one character of labels
+    // per digit recognize() finds in image ('-' skips a digit). No retraining or reindexing;
+    // saveModel() folds the learned digits into the saved reference set.
+    bool learnDigits(const ImageMatrix& image, const std::string& labels);
     void saveModel(const std::string& filename, AlgorithmType algo = AlgorithmType::KNN);
     void loadModel(const std::string& filename, AlgorithmType algo = AlgorithmType::KNN);
 
     // Testing (evaluation) methods
     float evaluateOnTestData(const std::string& testDataPath, AlgorithmType algo = AlgorithmType::KNN);
+    // evaluates on an IDX image/label pair read chunkImages images at a time, so memory stays
+    // bounded however large the files are; the features are not cached
+    float evaluateStream(
+        const std::string& imagePath,
+        const std::string& labelPath,
+        AlgorithmType algo = AlgorithmType::KNN,
+        std::size_t chunkImages = 8192);
     float evaluateOnTrainingData();
-    void confusionMatrix(const std::vector<MNISTImage>& testData, AlgorithmType algo = AlgorithmType::KNN);
+    void confusionMatrix(const MNISTDataset& testData, AlgorithmType algo = AlgorithmType::KNN);
 
     // Check if model is trained
     bool isTrained(AlgorithmType algo = AlgorithmType::KNN) const;
 
+    // KNN search strategy; builds the index right away if the model is already trained
+    void setKNNSearchMode(KNNSearchMode mode);
+    // recall/latency of the approximate KNN search against the exact scan on MNIST test data
+    void benchmarkKNNSearch(const std::string& testDataPath, std::size_t maxQueries = 1000);
+    // PCA output dimension for the next KNN training, 0 = keep the full features;
+    // retrains right away if the training samples are loaded
+    void setKNNPCAComponents(int components);
+    // accuracy and latency of the exact scan at several PCA dimensions on MNIST test data
+    void benchmarkKNNPCA(const std::string& testDataPath, std::size_t maxQueries = 1000);
+    // shrinks the KNN reference set to edited + condensed prototypes and reports the accuracy delta
+    // on MNIST test data; saveModel() then stores only the prototypes
+    void selectKNNPrototypes(const std::string& testDataPath);
+    // directory of the extracted-feature cache, "feature_cache" by default
+    void setFeatureCacheDirectory(const std::string& path) { featureCache.setDirectory(path); }
+
 private:
     Preprocessor preprocessor;
     FeatureExtractor featureExtractor;
@@ -44,9 +72,16 @@ private:
     bool knnTrained = false;
     bool neuralNetworkTrained = false;
 
-    std::vector<TrainingSample> knnTrainingSamples;
+    FeatureDataset knnTrainingSet;
+    FeatureCache featureCache;
 
-    std::vector<TrainingSample> loadMNISTSamples(const std::vector<MNISTImage>& data, AlgorithmType algo) const;
+    // per-sample model files written before the mapped format
+    bool loadLegacyModel(const std::string& filename);
+    // features of an IDX image/label file pair for algo, served from featureCache when the files
+    // and the extractor config are unchanged, extracted and cached otherwise; empty on failure.
+    // A path that does not exist is read from its gzip-compressed .gz sibling if there is one
+    FeatureDataset loadMNISTFeatures(const std::string& imagePath, const std::string& labelPath, AlgorithmType algo) const;
+    std::vector<TrainingSample> loadMNISTSamples(const std::string& imagePath, const std::string& labelPath, AlgorithmType algo) const;
 };
 
 
@@ -0,0 +1,50 @@
+#pragma once
+#ifndef FEATURE_DATASET_H
+#define FEATURE_DATASET_H
+
+#include "baselines/common/feature_matrix.h"
+#include "baselines/common/training_sample.h"
+#include "io/mapped_file.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/* Labelled samples of one feature size, stored as the rows of one padded
+   FeatureMatrix: the contiguous counterpart of std::vector<TrainingSample>,
+   filled in place by batch feature extraction. features may be a view into
+   a mapped file (e.g. a feature cache entry), which storage keeps mapped. */
+struct FeatureDataset {
+    FeatureDataset();
+    FeatureDataset(std::size_t rows, std::size_t cols);
+
+    // rows as wide as the longest sample, shorter samples zero-extended
+    static FeatureDataset fromSamples(const std::vector<TrainingSample>& samples);
+    // per-sample copies of rows [first, first + count), for the APIs that take samples
+    std::vector<TrainingSample> toSamples(std::size_t first = 0, std::size_t count = static_cast<std::size_t>(-1)) const;
+    FeatureDataset subset(const std::vector<std::size_t>& indices) const;
+    // grows by samples.size() rows (one reallocation); samples wider than cols() are cut
+    void append(const std::vector<TrainingSample>& samples);
+    void clear();
+
+    std::size_t size() const { return labels.size(); }
+    bool empty() const { return labels.empty(); }
+    std::size_t cols() const { return features.cols(); }
+
+    FeatureMatrix features;
+    std::vector<int> labels;
+    std::shared_ptr<const MappedFile> storage;  // set when features is a view
+};
+
+/* A dataset too large to hold at once, handed out as consecutive
+   FeatureDataset chunks, e.g. features extracted from a streamed file. */
+class FeatureChunkSource {
+public:
+    virtual ~FeatureChunkSource() = default;
+
+    // the next chunk into chunk; false after the last one
+    virtual bool next(FeatureDataset& chunk) = 0;
+    // back to the first chunk, for the next pass
+    virtual void rewind() = 0;
+};
+
+#endif // !FEATURE_DATASET_H
@@ -0,0 +1,59 @@
+#pragma once
+#ifndef FEATURE_MATRIX_H
+#define FEATURE_MATRIX_H
+
+#include <cstddef>
+#include <memory>
+
+/* Row-major float matrix with one aligned allocation.
+   Every row starts on a cache line and is zero-padded up to stride()
+   floats, so SIMD kernels can walk whole vectors without a scalar tail.
+   A matrix can also be a read-only view over memory it does not own
+   (e.g. a mapped model file); copying a view makes an owning copy. */
+class FeatureMatrix {
+public:
+    static constexpr std::size_t alignment = 64;                       // bytes
+    static constexpr std::size_t rowPadding = alignment / sizeof(float); // floats
+
+    FeatureMatrix();
+    FeatureMatrix(std::size_t rows, std::size_t cols);
+
+    FeatureMatrix(const FeatureMatrix& other);
+    FeatureMatrix& operator=(const FeatureMatrix& other);
+    FeatureMatrix(FeatureMatrix&& other) noexcept;
+    FeatureMatrix& operator=(FeatureMatrix&& other) noexcept;
+
+    // owning matrix whose memory is left as allocated: the caller writes every float of
+    // every row, padding included (lets parallel fillers touch their own pages first)
+    static FeatureMatrix uninitialized(std::size_t rows, std::size_t cols);
+    // rows * paddedSize(cols) floats laid out like an owning matrix;
+    // data must be `alignment`-aligned, outlive the view and is never written
+    static FeatureMatrix view(const float* data, std::size_t rows, std::size_t cols);
+    bool isView() const { return rowData && !values; }
+
+    std::size_t rows() const { return rowCount; }
+    std::size_t cols() const { return colCount; }
+    std::size_t stride() const { return rowStride; }
+    bool empty() const { return rowCount == 0; }
+
+    float* row(std::size_t r) { return rowData + r * rowStride; }
+    const float* row(std::size_t r) const { return rowData + r * rowStride; }
+
+    // copies up to cols() values into row r, zero-filling the rest of the row
+    void setRow(std::size_t r, const float* source, std::size_t count);
+
+    static std::size_t paddedSize(std::size_t cols);
+
+private:
+    struct AlignedDeleter {
+        void operator()(float* ptr) const;
+    };
+
+    std::size_t rowCount = 0;
+    std::size_t colCount = 0;
+    std::size_t rowStride = 0;
+    std::unique_ptr<float[], AlignedDeleter> values;
+    float* rowData = nullptr;  // values.get(), or the viewed memory
+};
+
+#endif // !FEATURE_MATRIX_H
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef BINARY_STORE_H
+#define BINARY_STORE_H
+
+#include "baselines/knn/feature_extractor.h"
+#include "baselines/knn/k_nearest_list.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Pixel features reduced to one bit each (pixel > threshold, the same cut as
+   Preprocessor::applyThreshold) and packed into 64-bit words, 13 words for a
+   28x28 digit. Zone and projection features are not used. Distances are
+   Hamming distances: XOR + popcount over the words of a row. */
+class BinaryFeatureStore {
+public:
+    using Distance = std::uint32_t;
+    using NearestList = BasicKNearestList<Distance>;
+
+    BinaryFeatureStore();
+
+    static std::size_t wordsFor(const KNNFeatureLayout& layout);
+
+    // allocates rows cleared rows; false if the layout has no pixels
+    bool reset(const KNNFeatureLayout& layout, std::size_t rows, int threshold);
+    void clear();
+
+    // binarizes the pixel part of float features (extractKNNFeatures() output) into row r
+    void setRow(std::size_t r, const float* features, std::size_t count);
+    // same packing for a query, out must hold wordsPerRow() words
+    void pack(const float* features, std::size_t count, std::uint64_t* out) const;
+
+    // closest rows by Hamming distance, as many as best holds
+    void search(const std::uint64_t* query, NearestList& best) const;
+
+    bool empty() const { return rowCount == 0; }
+    std::size_t size() const { return rowCount; }
+    std::size_t wordsPerRow() const { return words; }
+    std::size_t memoryBytes() const { return bits.size() * sizeof(std::uint64_t); }
+
+private:
+    KNNFeatureLayout featureLayout;
+    int threshold = 128;  // on the 0-255 pixel scale
+    std::size_t rowCount = 0;
+    std::size_t words = 0;
+    std::vector<std::uint64_t> bits;  // rowCount x words, rows back to back
+};
+
+#endif // !BINARY_STORE_H
@@ -0,0 +1,57 @@
+#pragma once
+#ifndef CASCADE_INDEX_H
+#define CASCADE_INDEX_H
+
+#include "baselines/common/feature_matrix.h"
+#include "baselines/knn/feature_extractor.h"
+#include "baselines/knn/k_nearest_list.h"
+#include <cstddef>
+#include <vector>
+
+struct CascadeParams {
+    int shortlist = 256;  // rows kept by the coarse stage and scored with full distances
+};
+
+// per-query buffers of CascadeIndex::search(), one per worker thread so repeated searches allocate nothing
+struct CascadeSearchScratch {
+    FeatureMatrix coarseQuery;
+    std::vector<float> coarse;
+    std::vector<int> order;
+};
+
+/* Coarse-to-fine search. The zoning and projection features (72 values for
+   a 28x28 digit, against 856 in total) are copied into their own small
+   matrix. Every row is ranked by the distance over those features, and only
+   the `shortlist` closest rows get a full distance. That distance includes
+   the coarse part, so the coarse distance never exceeds it, but rows cut
+   by the shortlist are not checked again: the search is approximate, and
+   the shortlist trades recall for speed. */
+class CascadeIndex {
+public:
+    CascadeIndex();
+
+    // false if the layout does not describe data's columns
+    bool build(const FeatureMatrix& data, const KNNFeatureLayout& layout, const CascadeParams& params);
+    void clear();
+
+    // k nearest rows of data (the matrix the index was built from) among the coarse shortlist
+    void search(
+        const FeatureMatrix& data,
+        const float* query,
+        KNearestList& result,
+        CascadeSearchScratch& scratch,
+        KNNSearchStats* stats = nullptr) const;
+
+    bool empty() const { return coarseFeatures.empty(); }
+    std::size_t size() const { return coarseFeatures.rows(); }
+    std::size_t memoryBytes() const { return coarseFeatures.rows() * coarseFeatures.stride() * sizeof(float); }
+    const CascadeParams& parameters() const { return params; }
+    void setShortlist(int shortlist) { params.shortlist = shortlist; }
+
+private:
+    CascadeParams params;
+    std::size_t coarseOffset = 0;   // first coarse column in the full feature rows
+    FeatureMatrix coarseFeatures;   // rows x (zones + row and column projections)
+};
+
+#endif // !CASCADE_INDEX_H
@@ -0,0 +1,50 @@
+#pragma once
+#ifndef DISTANCE_KERNELS_H
+#define DISTANCE_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Squared L2 distance between two float vectors of length n.
+// Dispatches once at runtime to AVX2+FMA, SSE2 or a scalar loop.
+float squaredL2Distance(const float* a, const float* b, std::size_t n);
+
+// reference implementation, used by tests to validate the SIMD paths
+float squaredL2DistanceScalar(const float* a, const float* b, std::size_t n);
+
+// Same as squaredL2Distance, but stops as soon as the partial sum exceeds bound.
+// The returned value is then only guaranteed to be > bound, not the full distance.
+float squaredL2DistanceBounded(const float* a, const float* b, std::size_t n, float bound);
+
+float dotProduct(const float* a, const float* b, std::size_t n);
+
+// out[r] = dot(query, rows + r * stride) for r in [0, rowCount).
+// The query stays in registers across several rows, which is what makes
+// the ||q||^2 - 2*q*t + ||t||^2 batch path cheaper than one scan per query.
+void dotProductRows(
+    const float* query,
+    const float* rows,
+    std::size_t stride,
+    std::size_t rowCount,
+    std::size_t n,
+    float* out);
+
+// Exact squared distance between two byte vectors (n <= 65536 keeps the sum in range).
+std::uint32_t squaredDistanceU8(const std::uint8_t* a, const std::uint8_t* b, std::size_t n);
+
+// Exact squared distance between two int16 vectors, every a[i] - b[i] must fit in int16.
+std::uint64_t squaredDistanceI16(const std::int16_t* a, const std::int16_t* b, std::size_t n);
+
+// out[r] = popcount(query ^ row r) summed over `words` 64-bit words, rows packed back to back.
+// Uses the popcnt instruction when the CPU has it.
+void hammingDistanceRows(
+    const std::uint64_t* query,
+    const std::uint64_t* rows,
+    std::size_t words,
+    std::size_t rowCount,
+    std::uint32_t* out);
+
+// name of the kernel selected for this CPU ("avx2", "sse2" or "scalar")
+const char* distanceKernelName();
+
+#endif // !DISTANCE_KERNELS_H
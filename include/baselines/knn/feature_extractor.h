@@ -3,24 +3,65 @@
 #define FEATURE_EXTRACTOR_H
 
 #include "core/image_matrix.h"
+#include <cstddef>
+#include <string>
 #include <vector>
 
+// Where each feature group sits in extractKNNFeatures() output:
+// pixels, zone means, row means (height values), column means (width values).
+struct KNNFeatureLayout {
+    int width = 0;
+    int height = 0;
+    int zoningGridSize = 0;
+
+    int pixelCount() const { return width * height; }
+    int zoneCount() const { return zoningGridSize * zoningGridSize; }
+    // pixels averaged into each zone feature, the same for every zone
+    int zonePixels() const { return zoningGridSize > 0 ? (width / zoningGridSize) * (height / zoningGridSize) : 0; }
+    int dimensions() const { return pixelCount() + zoneCount() + height + width; }
+    bool valid() const { return width > 0 && height > 0 && zonePixels() > 0; }
+};
+
 class FeatureExtractor {
 public:
     FeatureExtractor();
 
+    // Every extractor also takes an ImageView, so a crop of a larger image or a
+    // mapped MNIST image is read in place; the ImageMatrix forms extract from view().
+
     // main KNN feature extractor method, combines all feature types
     std::vector<float> extractKNNFeatures(const ImageMatrix& digit) const;
+    std::vector<float> extractKNNFeatures(const ImageView& digit) const;
+    // same values in one sweep over the pixels, no allocation;
+    // out must hold getKNNFeatureDimensions(digit.width, digit.height) floats
+    void extractKNNFeaturesInto(const ImageMatrix& digit, float* out) const;
+    void extractKNNFeaturesInto(const ImageView& digit, float* out) const;
+    // row i (at out + i * stride) = features of digits[i]; columns past the feature
+    // dimension are left untouched, so a zeroed padded matrix stays padded
+    void extractKNNFeaturesBatch(const std::vector<ImageMatrix>& digits, float* out, std::size_t stride) const;
     std::vector<float> extractNeuralNetworkFeatures(const ImageMatrix& digit) const;
+    std::vector<float> extractNeuralNetworkFeatures(const ImageView& digit) const;
     // individual feature extraction methods
     std::vector<float> extractPixelFeatures(const ImageMatrix& digit) const;
+    std::vector<float> extractPixelFeatures(const ImageView& digit) const;
     std::vector<float> extractZoningFeatures(const ImageMatrix& digit) const;
+    std::vector<float> extractZoningFeatures(const ImageView& digit) const;
     std::vector<float> extractProjectionFeatures(const ImageMatrix& digit) const;
+    std::vector<float> extractProjectionFeatures(const ImageView& digit) const;
 
     // returns total feature vector size
     int getKNNFeatureDimensions(int width, int height) const;
+    KNNFeatureLayout getKNNFeatureLayout(int width, int height) const;
+
+    // Short descriptions of the extraction settings, used to key cached features:
+    // two extractors give the same features exactly when their descriptions match.
+    std::string getKNNFeatureConfig() const;
+    std::string getNeuralNetworkFeatureConfig() const;
 
 private:
+    // bump when a feature computation changes, so cached features are not reused
+    static constexpr int featureVersion = 1;
+
     int zoningGridSize = 4; // 4x4 grid for zoning features
 };
 
@@ -0,0 +1,65 @@
+#pragma once
+#ifndef HNSW_INDEX_H
+#define HNSW_INDEX_H
+
+#include "baselines/common/feature_matrix.h"
+#include "baselines/knn/k_nearest_list.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+struct HNSWParams {
+    int M = 16;                 // links per node on the upper layers, 2*M on layer 0
+    int efConstruction = 100;   // candidate list size while inserting
+    int efSearch = 64;          // candidate list size while querying (raised to k if smaller)
+    unsigned int seed = 42;     // level generator seed, fixed for reproducible graphs
+};
+
+/* Hierarchical navigable small world graph over the rows of a FeatureMatrix
+   (Malkov & Yashunin). The index stores only the graph; the matrix it was
+   built from must be passed back in for every search. */
+class HNSWIndex {
+public:
+    HNSWIndex();
+
+    void build(const FeatureMatrix& data, const HNSWParams& params);
+    void clear();
+
+    // k approximate nearest rows of query (padded to data.stride()) by squared L2 distance
+    void search(const FeatureMatrix& data, const float* query, int k, KNearestList& result) const;
+
+    bool empty() const { return nodeLevels.empty(); }
+    std::size_t size() const { return nodeLevels.size(); }
+    const HNSWParams& parameters() const { return params; }
+    void setEfSearch(int ef) { params.efSearch = ef; }
+
+    // the loaded graph must match the row and column count of data
+    bool save(const std::string& path) const;
+    bool load(const std::string& path, const FeatureMatrix& data);
+
+private:
+    using Candidate = std::pair<float, int>;  // (distance, row)
+
+    HNSWParams params;
+    int maxLevel = -1;
+    int entryPoint = -1;
+    std::size_t dataCols = 0;
+
+    std::vector<int> nodeLevels;
+    // layer 0: (2*M + 1) ints per node, slot 0 is the link count
+    std::vector<int> baseLinks;
+    // layers 1..level of each node: (M + 1) ints per layer, same layout
+    std::vector<std::vector<int>> upperLinks;
+
+    int maxLinks(int level) const { return level == 0 ? 2 * params.M : params.M; }
+    int* links(int node, int level);
+    const int* links(int node, int level) const;
+
+    int greedyClosest(const FeatureMatrix& data, const float* query, int entry, int fromLevel, int toLevel) const;
+    // ef closest nodes found from entry on one layer, sorted by distance
+    std::vector<Candidate> searchLayer(const FeatureMatrix& data, const float* query, int entry, int ef, int level) const;
+    std::vector<int> selectNeighbors(const FeatureMatrix& data, const std::vector<Candidate>& candidates, int maxCount) const;
+    void connect(const FeatureMatrix& data, int node, int neighbor, int level);
+};
+
+#endif // !HNSW_INDEX_H
@@ -0,0 +1,61 @@
+#pragma once
+#ifndef IVF_INDEX_H
+#define IVF_INDEX_H
+
+#include "baselines/common/feature_matrix.h"
+#include "baselines/knn/k_nearest_list.h"
+#include "baselines/knn/kmeans.h"
+#include <cstddef>
+#include <vector>
+
+struct IVFParams {
+    int lists = 256;              // k-means cells
+    int nprobe = 8;               // cells scanned per query
+    int trainingSamples = 20000;  // rows the centroids are fitted on
+    int iterations = 10;          // k-means iterations
+    unsigned int threads = 0;     // build workers, 0 = hardware concurrency
+    unsigned int seed = 42;
+};
+
+/* Inverted file index: k-means splits the rows into `lists` cells, and each
+   cell keeps its rows' features back to back, so probing a cell is one
+   sequential scan. A query ranks the centroids and scans only the nprobe
+   closest cells. Recall grows with nprobe; nprobe = lists is an exact scan.
+   insert() files a new row under its nearest centroid without refitting. */
+class IVFIndex {
+public:
+    IVFIndex();
+
+    void build(const FeatureMatrix& data, const IVFParams& params);
+    void clear();
+    // adds one row (padded to stride() floats) under its nearest cell
+    void insert(const float* features, int row);
+
+    // closest rows among the probed cells, as many as result holds
+    void search(const float* query, KNearestList& result, KNNSearchStats* stats = nullptr) const;
+
+    bool empty() const { return centroids.clusters == 0; }
+    std::size_t size() const { return rowCount; }
+    std::size_t listCount() const { return lists.size(); }
+    std::size_t stride() const { return rowStride; }
+    // centroids, list features and row ids
+    std::size_t memoryBytes() const;
+    const IVFParams& parameters() const { return params; }
+    void setProbes(int nprobe) { params.nprobe = nprobe; }
+
+private:
+    struct InvertedList {
+        std::vector<int> rows;        // row ids in the source matrix
+        std::vector<float> features;  // rows.size() x rowStride
+    };
+
+    IVFParams params;
+    KMeansResult centroids;   // dim = rowStride, padding columns stay zero
+    std::vector<InvertedList> lists;
+    std::size_t rowStride = 0;
+    std::size_t rowCount = 0;
+
+    std::size_t nearestList(const float* features) const;
+};
+
+#endif // !IVF_INDEX_H
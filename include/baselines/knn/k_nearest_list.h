@@ -0,0 +1,74 @@
+#pragma once
+#ifndef K_NEAREST_LIST_H
+#define K_NEAREST_LIST_H
+
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Fixed-capacity list of the k closest (row, distance) pairs seen so far, sorted by distance.
+// bound() is the current k-th distance: candidates at or above it can be skipped.
+// Distance is float for the float kernels, an unsigned integer for the quantized store.
+template <typename Distance>
+class BasicKNearestList {
+public:
+    explicit BasicKNearestList(int k) : maxSize(k) {
+        items.reserve(k);
+    }
+
+    void clear() { items.clear(); }
+    bool full() const { return static_cast<int>(items.size()) >= maxSize; }
+    int size() const { return static_cast<int>(items.size()); }
+    int capacity() const { return maxSize; }
+
+    Distance bound() const {
+        return full() ? items.back().second : unbounded();
+    }
+
+    void push(int row, Distance distance) {
+        if (maxSize <= 0 || distance >= bound()) {
+            return;
+        }
+
+        if (full()) {
+            items.pop_back();
+        }
+
+        // insertion sort step, k is small
+        auto it = items.end();
+        while (it != items.begin() && (it - 1)->second > distance) {
+            --it;
+        }
+        items.insert(it, {row, distance});
+    }
+
+    const std::pair<int, Distance>& operator[](int i) const { return items[i]; }
+    typename std::vector<std::pair<int, Distance>>::const_iterator begin() const { return items.begin(); }
+    typename std::vector<std::pair<int, Distance>>::const_iterator end() const { return items.end(); }
+
+private:
+    int maxSize;
+    std::vector<std::pair<int, Distance>> items;
+
+    static Distance unbounded() {
+        return std::numeric_limits<Distance>::has_infinity
+            ? std::numeric_limits<Distance>::infinity()
+            : std::numeric_limits<Distance>::max();
+    }
+};
+
+using KNearestList = BasicKNearestList<float>;
+
+// Per-query work counters, summed over queries by the caller.
+// candidates: stored rows considered, fullDistances: rows whose full distance was computed.
+struct KNNSearchStats {
+    std::size_t candidates = 0;
+    std::size_t fullDistances = 0;
+
+    double prunedFraction() const {
+        return candidates > 0 ? 1.0 - static_cast<double>(fullDistances) / static_cast<double>(candidates) : 0.0;
+    }
+};
+
+#endif // !K_NEAREST_LIST_H
@@ -0,0 +1,31 @@
+#pragma once
+#ifndef KMEANS_H
+#define KMEANS_H
+
+#include <cstddef>
+#include <vector>
+
+struct KMeansResult {
+    std::size_t clusters = 0;
+    std::size_t dim = 0;
+    std::vector<float> centroids;  // clusters x dim, row-major
+};
+
+// Lloyd's k-means over `rows` vectors of length dim, read `stride` floats apart.
+// Centroids start from distinct random samples; empty clusters are re-seeded.
+// The assignment step is split over `threads` workers (0 = hardware concurrency);
+// the result does not depend on the thread count.
+KMeansResult kmeans(
+    const float* data,
+    std::size_t rows,
+    std::size_t dim,
+    std::size_t stride,
+    std::size_t clusters,
+    int iterations,
+    unsigned int seed,
+    unsigned int threads = 1);
+
+// index of the centroid closest to vector (squared L2)
+std::size_t nearestCentroid(const KMeansResult& model, const float* vector);
+
+#endif // !KMEANS_H
@@ -2,28 +2,256 @@
 #ifndef KNN_CLASSIFIER_H
 #define KNN_CLASSIFIER_H
 
+#include "baselines/common/feature_dataset.h"
+#include "baselines/common/feature_matrix.h"
 #include "baselines/common/training_sample.h"
+#include "baselines/knn/binary_store.h"
+#include "baselines/knn/cascade_index.h"
+#include "baselines/knn/hnsw_index.h"
+#include "baselines/knn/ivf_index.h"
+#include "baselines/knn/k_nearest_list.h"
+#include "baselines/knn/online_store.h"
+#include "baselines/knn/pca.h"
+#include "baselines/knn/pivot_index.h"
+#include "baselines/knn/pq_index.h"
+#include "baselines/knn/prototype_selection.h"
+#include "baselines/knn/quantized_store.h"
+#include "io/mapped_file.h"
+#include <string>
 #include <vector>
 
+enum class KNNSearchMode {
+    Exact,  // linear scan over every stored sample
+    HNSW,   // approximate search over the HNSW graph
+    PQ,     // product-quantized codes, optionally re-ranked with exact distances
+    Quantized, // exact search over integer features, needs setFeatureLayout()
+    Binary,    // Hamming distance over thresholded pixels, needs setFeatureLayout()
+    Pivot,     // exact scan that skips rows ruled out by stored pivot distances (LAESA)
+    Cascade,   // zoning/projection distance shortlist, full distances on it only, needs setFeatureLayout()
+    IVF        // k-means cells, only the nprobe cells nearest to the query are scanned
+    // index modes fall back to Exact until their index is built
+};
+
+// one stored sample near a query, as returned by neighborsBatch()
+struct KNNNeighbor {
+    int row;
+    int label;
+    float distance;  // squared L2 for the float modes, as fed to vote()
+};
+
 class KNNClassifier {
 public:
     KNNClassifier(int k = 3);
-    void train(const std::vector<TrainingSample>* trainingData);
+    // copies the samples into one contiguous, SIMD-padded feature matrix;
+    // buildSearchIndex = false leaves the index to loadIndex()/buildIndex()
+    void train(const std::vector<TrainingSample>* trainingData, bool buildSearchIndex = true);
+    // same from a contiguous dataset, whose padded rows are copied as one block
+    void train(const FeatureDataset& trainingData, bool buildSearchIndex = true);
+    // trains on a prototype subset of trainingData and returns the kept sample indices
+    std::vector<std::size_t> trainPrototypes(
+        const std::vector<TrainingSample>* trainingData,
+        const PrototypeSelectionParams& params = {},
+        PrototypeSelectionStats* stats = nullptr);
     int predict(const std::vector<float>& features) const;
 
-    // maxSamples = 0 -> evaluate on full train dataset
+    // Appends samples to a trained float-feature model. The IVF index files the new rows
+    // under their nearest cells as they come; the other indexes are rebuilt.
+    // Returns false when only a compact store or PQ codes are kept.
+    bool addSamples(const std::vector<TrainingSample>& samples);
+
+    // Online update, safe while other threads predict: the sample is visible to every query
+    // that starts after the call returns, and each query sees one consistent set of samples.
+    // Appended rows are scanned exactly next to the current index, which is left as it is.
+    // Not available in Binary mode (its distances are Hamming counts). Everything else
+    // that changes the model (train, load, add/merge, set*Params) still needs exclusive access.
+    bool appendSample(const TrainingSample& sample);
+    std::size_t appendedCount() const { return appended.size(); }
+    // moves the appended samples into the reference matrix and rebuilds the index;
+    // false (and the samples stay appended) when the model keeps no float features
+    bool mergeAppendedSamples();
+
+    // row ids of the k nearest stored samples under the current search mode, nearest first;
+    // stats, when given, accumulates the Exact, Pivot, Cascade and IVF mode work counters
+    std::vector<int> nearestRows(const std::vector<float>& features, KNNSearchStats* stats = nullptr) const;
+
+    // Predicts many queries at once: distances come from ||q||^2 - 2*q*t + ||t||^2
+    // over cache-sized tiles of the training matrix, shared by a block of queries.
+    // Blocks are spread over `threads` workers, 0 = hardware concurrency.
+    std::vector<int> predictBatch(const std::vector<std::vector<float>>& queries, unsigned int threads = 0) const;
+    // the neighbors predictBatch() votes on, nearest first (ties go to the smaller row);
+    // fewer than k when fewer samples are stored
+    std::vector<std::vector<KNNNeighbor>> neighborsBatch(
+        const std::vector<std::vector<float>>& queries,
+        unsigned int threads = 0) const;
+
+    // maxSamples = 0 -> evaluate on full train dataset; threads = 0 -> hardware concurrency
     float evaluate(
         const std::vector<TrainingSample>& testData,
         std::size_t maxSamples = 0,
-        bool showProgress = false) const;
+        bool showProgress = false,
+        unsigned int threads = 0) const;
+    float evaluate(
+        const FeatureDataset& testData,
+        std::size_t maxSamples = 0,
+        bool showProgress = false,
+        unsigned int threads = 0) const;
+    // how many of the evaluated rows are predicted right; evaluate() is this over the row count
+    std::size_t countCorrect(
+        const FeatureDataset& testData,
+        std::size_t maxSamples = 0,
+        bool showProgress = false,
+        unsigned int threads = 0) const;
+
+    void setSearchMode(KNNSearchMode mode);
+    KNNSearchMode getSearchMode() const { return searchMode; }
+    void setHNSWParams(const HNSWParams& params);
+    void setHNSWEfSearch(int efSearch);
+    const HNSWParams& getHNSWParams() const { return hnswParams; }
+    void setPQParams(const PQParams& params);
+    void setPQRerankCount(int count);
+    const PQParams& getPQParams() const { return pqParams; }
+    void setPivotParams(const PivotParams& params);
+    const PivotParams& getPivotParams() const { return pivotParams; }
+    void setCascadeShortlist(int shortlist);
+    const CascadeParams& getCascadeParams() const { return cascadeParams; }
+    void setIVFParams(const IVFParams& params);
+    void setIVFProbes(int nprobe);
+    const IVFParams& getIVFParams() const { return ivfParams; }
+    // PCA fitted by train() for the float-feature modes; stored rows and queries are then
+    // kept as their leading components. Takes effect at the next train().
+    void setPCAParams(const PCAParams& params) { pcaParams = params; }
+    const PCAParams& getPCAParams() const { return pcaParams; }
+    // output dimension of the fitted projection, 0 when features are stored as extracted
+    std::size_t projectedDim() const { return projection.outputDim(); }
+    double explainedVariance() const { return projection.explainedVariance(); }
+    // positions of the feature groups, needed by the Quantized and Binary modes
+    void setFeatureLayout(const KNNFeatureLayout& layout) { featureLayout = layout; }
+    // pixel cut of the Binary mode on the 0-255 scale, should match the image binarization
+    void setBinaryThreshold(int threshold) { binaryThreshold = threshold; }
+    // false for modes whose compact store replaces the float matrix
+    static bool storesFloatFeatures(KNNSearchMode mode);
+
+    // builds the index required by the current search mode if it is missing
+    void buildIndex();
+    // true when the current search mode has its index ready
+    bool hasIndex() const;
+    // HNSW graph, stored next to the model file
+    bool saveIndex(const std::string& path) const;
+    bool loadIndex(const std::string& path);
+
+    // Model file: header, labels, squared norms, then the padded feature matrix at
+    // an aligned offset, then the PCA projection if one was fitted. loadModel() maps
+    // the file and searches the matrix in place, so processes loading the same model
+    // share its pages.
+    bool saveModel(const std::string& path) const;
+    bool loadModel(const std::string& path);
+    static bool isModelFile(const std::string& path);
+    // Splits the stored rows into `shards` contiguous model files <prefix>.shard<i>.knn,
+    // each carrying the PCA projection, for KNNShardServer processes. Returns the paths
+    // in row order, empty on failure. Appended samples must be merged first.
+    std::vector<std::string> saveShardModels(const std::string& pathPrefix, int shards) const;
+
+    // Compressed model: labels + PQ codebooks and codes, no float features.
+    // Loading one switches to PQ mode without exact re-ranking.
+    bool saveCompressedModel(const std::string& path) const;
+    bool loadCompressedModel(const std::string& path);
+    static bool isCompressedModel(const std::string& path);
+    bool hasFeatures() const { return !referenceFeatures.empty(); }
+    // reference set bytes of the current mode's compact store (PQ codes or integer features),
+    // or of the pivot distance table / coarse features / inverted lists in Pivot, Cascade and IVF modes
+    std::size_t compressedBytes() const;
+
+    int getK() const { return k; }
+    // length of the feature vectors the model was trained on, before any projection
+    std::size_t inputDim() const { return featureDim; }
+    std::size_t size() const { return referenceLabels.size() + appended.size(); }
+
+    // majority vote over (label, distance) pairs, any int labels;
+    // ties go to the smaller distance sum, then to the smaller label
+    static int vote(const std::vector<std::pair<int, float>>& neighbors);
 
 private:
     int k;
-    const std::vector<TrainingSample>* trainingData = nullptr;
+    KNNSearchMode searchMode = KNNSearchMode::Exact;
+    HNSWParams hnswParams;
+    HNSWIndex hnswIndex;
+    PQParams pqParams;
+    PQIndex pqIndex;
+    PivotParams pivotParams;
+    PivotIndex pivotIndex;
+    CascadeParams cascadeParams;
+    CascadeIndex cascadeIndex;
+    IVFParams ivfParams;
+    IVFIndex ivfIndex;
+    PCAParams pcaParams;
+    PCAProjection projection;
+    KNNFeatureLayout featureLayout;
+    QuantizedFeatureStore quantizedStore;
+    int binaryThreshold = 128;
+    BinaryFeatureStore binaryStore;
+
+    // empty when only a compressed model is loaded, or when training in Quantized/Binary mode;
+    // a view into modelFile after loadModel()
+    MappedFile modelFile;
+    FeatureMatrix referenceFeatures;
+    std::vector<int> referenceLabels;
+    std::size_t featureDim = 0;  // extracted features per sample, before any projection
+    std::vector<float> referenceNorms;  // squared L2 norm of every stored row
+    // samples appended since the last train/merge, row ids continue after referenceLabels
+    OnlineReferenceStore appended;
 
-    float euclideanDistance(const std::vector<float>& a, const std::vector<float>& b) const;
+    // index search buffers, one per worker of the batch paths
+    struct SearchScratch {
+        PivotSearchScratch pivot;
+        CascadeSearchScratch cascade;
+    };
 
     std::vector<std::pair<int, float>> findKNearest(const std::vector<float>& features) const;
+    // width of a query row: featureDim, or the PCA output dimension
+    std::size_t queryDim() const;
+    // writes features into row r of block in the stored layout (projected when PCA is on)
+    void encodeQuery(const std::vector<float>& features, FeatureMatrix& block, std::size_t r) const;
+    void encodeQuery(const float* features, std::size_t count, FeatureMatrix& block, std::size_t r) const;
+    // drops the reference set, every index and the projection
+    void clearModel();
+    // PCA, row norms and the search index over a freshly filled referenceFeatures
+    void prepareReferenceRows(bool buildSearchIndex);
+    // encode(q, block, r) writes query q into row r of block, labelOf(q) is its true label
+    // number of correct predictions among the first limit queries
+    template <typename EncodeQuery, typename LabelOf>
+    std::size_t evaluateQueries(
+        std::size_t limit,
+        EncodeQuery encode,
+        LabelOf labelOf,
+        bool showProgress,
+        unsigned int threads) const;
+    bool usesIndex() const;
+    // query must be padded to referenceFeatures.stride()
+    void searchNearest(const float* query, KNearestList& best, SearchScratch& scratch, KNNSearchStats* stats = nullptr) const;
+    void exactSearch(const float* query, KNearestList& best) const;
+    void quantizedSearch(const float* query, KNearestList& best) const;
+    void binarySearch(const float* query, KNearestList& best) const;
+    bool canUseCompactStore() const;
+    void resetCompactStore(std::size_t rows);
+    void setCompactRow(std::size_t r, const float* features, std::size_t count);
+    void appendRows(const FeatureMatrix& rows, const std::vector<int>& labels);
+    void searchAppended(
+        const OnlineReferenceStore::Snapshot& snapshot,
+        const float* query,
+        KNearestList& best,
+        KNNSearchStats* stats = nullptr) const;
+    std::vector<std::pair<int, float>> labelNeighbors(
+        const KNearestList& best,
+        const OnlineReferenceStore::Snapshot& snapshot) const;
+    // k nearest of the first count rows of queries, appended rows included
+    void searchBlock(
+        const FeatureMatrix& queries,
+        std::size_t count,
+        const OnlineReferenceStore::Snapshot& snapshot,
+        std::vector<KNearestList>& best,
+        SearchScratch& scratch) const;
+    void predictBlock(const FeatureMatrix& queries, std::size_t count, int* predictions, SearchScratch& scratch) const;
+    bool writeModel(const std::string& path, std::size_t firstRow, std::size_t rowCount) const;
 };
 
 #endif // KNN_CLASSIFIER_H
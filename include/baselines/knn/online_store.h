@@ -0,0 +1,60 @@
+#pragma once
+#ifndef ONLINE_STORE_H
+#define ONLINE_STORE_H
+
+#include "baselines/common/feature_matrix.h"
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/* Append-only reference rows that can grow while other threads search.
+   Rows live in fixed-size segments that are never reallocated. A writer
+   fills the next free row of the tail segment, then publishes a new
+   immutable Snapshot (segment list + row count) with one atomic pointer
+   store. Readers load the current snapshot without locking and only read
+   rows below its count, so they never see a half-written row. Old
+   snapshots are freed when their last reader drops them (RCU-style
+   reclamation through the shared_ptr count). */
+class OnlineReferenceStore {
+public:
+    static constexpr std::size_t segmentRows = 1024;
+
+    struct Segment {
+        explicit Segment(std::size_t cols);
+
+        FeatureMatrix features;  // segmentRows x cols, filled front to back
+        std::vector<int> labels;
+        std::vector<float> norms;  // squared L2 norm of every row
+    };
+
+    struct Snapshot {
+        std::vector<std::shared_ptr<Segment>> segments;
+        std::size_t rows = 0;
+
+        const float* row(std::size_t r) const { return segments[r / segmentRows]->features.row(r % segmentRows); }
+        int label(std::size_t r) const { return segments[r / segmentRows]->labels[r % segmentRows]; }
+        float norm(std::size_t r) const { return segments[r / segmentRows]->norms[r % segmentRows]; }
+    };
+
+    OnlineReferenceStore();
+
+    // drops every row and sets the row width; not safe while other threads use the store
+    void reset(std::size_t cols);
+
+    // copies cols() floats of row; safe to call concurrently with snapshot() and other appends
+    void append(const float* row, int label);
+
+    // rows published so far; lock-free, the snapshot stays valid while it is held
+    std::shared_ptr<const Snapshot> snapshot() const;
+
+    std::size_t size() const { return snapshot()->rows; }
+    std::size_t cols() const { return columnCount; }
+
+private:
+    std::size_t columnCount = 0;
+    std::mutex appendMutex;  // serializes writers; readers never take it
+    std::shared_ptr<const Snapshot> published;  // only accessed through std::atomic_load/atomic_store
+};
+
+#endif // !ONLINE_STORE_H
@@ -0,0 +1,52 @@
+#pragma once
+#ifndef PCA_H
+#define PCA_H
+
+#include "baselines/common/feature_matrix.h"
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+struct PCAParams {
+    int components = 0;           // output dimension, 0 = no projection
+    int trainingSamples = 10000;  // rows the covariance is estimated from
+    unsigned int threads = 0;     // covariance workers, 0 = hardware concurrency
+    unsigned int seed = 42;       // training subset
+};
+
+/* Principal component projection. The covariance of a training subset is
+   accumulated in cache-sized tiles across worker threads, then decomposed
+   with a Householder tridiagonalization followed by implicit QL iterations
+   (the EISPACK tred2/tql2 pair). project() maps a feature vector onto the
+   leading eigenvectors. */
+class PCAProjection {
+public:
+    PCAProjection();
+
+    // false if data is empty or components is not in [1, data.cols())
+    bool fit(const FeatureMatrix& data, const PCAParams& params);
+    void clear();
+
+    // out[c] = dot(component c, features - mean) for c < outputDim();
+    // features shorter than inputDim() are zero-extended
+    void project(const float* features, std::size_t count, float* out) const;
+
+    bool empty() const { return components.empty(); }
+    std::size_t inputDim() const { return components.cols(); }
+    std::size_t outputDim() const { return components.rows(); }
+    // share of the training variance kept by the projection
+    double explainedVariance() const { return keptVariance; }
+
+    bool write(std::ostream& out) const;
+    // reads a block of at most bytes; a non-zero inputDim or outputDim must match the stored
+    // projection. Sizes are checked before anything is allocated.
+    bool read(std::istream& in, std::uint64_t bytes, std::size_t inputDim = 0, std::size_t outputDim = 0);
+
+private:
+    FeatureMatrix components;          // outputDim x inputDim, one eigenvector per row
+    std::vector<float> meanProjection; // dot(component c, mean), subtracted after the dot product
+    double keptVariance = 0.0;
+};
+
+#endif // !PCA_H
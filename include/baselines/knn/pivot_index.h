@@ -0,0 +1,56 @@
+#pragma once
+#ifndef PIVOT_INDEX_H
+#define PIVOT_INDEX_H
+
+#include "baselines/common/feature_matrix.h"
+#include "baselines/knn/k_nearest_list.h"
+#include <cstddef>
+#include <vector>
+
+struct PivotParams {
+    int pivots = 32;        // stored distances per row
+    int seedFactor = 4;     // k * seedFactor rows with the smallest bounds are scored first
+    unsigned int seed = 42; // first pivot
+};
+
+// per-query buffers of PivotIndex::search(), one per worker thread so repeated searches allocate nothing
+struct PivotSearchScratch {
+    std::vector<float> bounds;
+    std::vector<int> order;
+};
+
+/* LAESA-style exact search. A few training rows are picked as pivots
+   (farthest-first) and every row's true Euclidean distance to each pivot
+   is stored. For a query q, |d(q, p) - d(x, p)| <= d(q, x) for every pivot p,
+   so a row whose largest such bound is not below the current k-th distance
+   cannot be a neighbor and its full distance is skipped. Results are the
+   same as the linear scan; distances in the result stay squared. */
+class PivotIndex {
+public:
+    PivotIndex();
+
+    void build(const FeatureMatrix& data, const PivotParams& params);
+    void clear();
+
+    // exact k nearest rows of data (the matrix the index was built from), as many as result holds
+    void search(
+        const FeatureMatrix& data,
+        const float* query,
+        KNearestList& result,
+        PivotSearchScratch& scratch,
+        KNNSearchStats* stats = nullptr) const;
+
+    bool empty() const { return rowCount == 0; }
+    std::size_t size() const { return rowCount; }
+    std::size_t pivotCount() const { return pivotRows.size(); }
+    std::size_t memoryBytes() const { return pivotDistances.size() * sizeof(float); }
+    const PivotParams& parameters() const { return params; }
+
+private:
+    PivotParams params;
+    std::size_t rowCount = 0;
+    std::vector<int> pivotRows;
+    std::vector<float> pivotDistances; // pivots x rows, one contiguous column per pivot
+};
+
+#endif // !PIVOT_INDEX_H
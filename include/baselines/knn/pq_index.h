@@ -0,0 +1,58 @@
+#pragma once
+#ifndef PQ_INDEX_H
+#define PQ_INDEX_H
+
+#include "baselines/common/feature_matrix.h"
+#include "baselines/knn/k_nearest_list.h"
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+struct PQParams {
+    int subspaces = 32;           // code bytes per vector
+    int trainingSamples = 10000;  // rows used to fit the codebooks
+    int iterations = 12;          // k-means iterations per subspace
+    int rerankCount = 64;         // shortlist re-ranked with exact distances, 0 = PQ distances only
+    unsigned int seed = 42;
+};
+
+/* Product quantizer: every vector is split into `subspaces` chunks and each
+   chunk is stored as the id of its nearest centroid (one byte). Queries use
+   asymmetric distances: a per-query table of chunk-to-centroid distances,
+   summed over the codes of every stored row. */
+class PQIndex {
+public:
+    static constexpr int centroidCount = 256;
+
+    PQIndex();
+
+    void build(const FeatureMatrix& data, const PQParams& params);
+    void clear();
+
+    // closest rows by approximate (ADC) squared distance, as many as result holds
+    void search(const float* query, KNearestList& result) const;
+
+    bool empty() const { return rowCount == 0; }
+    std::size_t size() const { return rowCount; }
+    std::size_t dimensions() const { return dim; }
+    std::size_t codeBytes() const { return codes.size(); }
+    std::size_t memoryBytes() const;
+    const PQParams& parameters() const { return params; }
+    void setRerankCount(int count) { params.rerankCount = count; }
+
+    bool write(std::ostream& out) const;
+    bool read(std::istream& in);
+
+private:
+    PQParams params;
+    std::size_t rowCount = 0;
+    std::size_t dim = 0;
+    std::size_t subDim = 0;  // ceil(dim / subspaces), the last chunk is zero-padded
+
+    std::vector<float> codebooks;     // subspaces x centroidCount x subDim
+    std::vector<std::uint8_t> codes;  // rowCount x subspaces
+
+    void buildDistanceTable(const float* query, std::vector<float>& table) const;
+};
+
+#endif // !PQ_INDEX_H
@@ -0,0 +1,35 @@
+#pragma once
+#ifndef PROTOTYPE_SELECTION_H
+#define PROTOTYPE_SELECTION_H
+
+#include "baselines/common/training_sample.h"
+#include <cstddef>
+#include <vector>
+
+struct PrototypeSelectionParams {
+    bool edit = true;            // Wilson editing: drop samples their k neighbors misclassify
+    int editK = 3;
+    bool condense = true;        // Hart's CNN: keep only samples the kept set misclassifies
+    int maxCondensePasses = 10;  // passes over the absorbed samples, stops early when nothing is added
+    std::size_t batchSize = 1024; // condensing candidates classified in parallel against a fixed store
+    unsigned int threads = 0;    // 0 = hardware concurrency
+    unsigned int seed = 42;      // condensing visit order
+};
+
+struct PrototypeSelectionStats {
+    std::size_t original = 0;
+    std::size_t edited = 0;     // samples left after editing
+    std::size_t condensed = 0;  // samples left after condensing
+    int condensePasses = 0;
+    double seconds = 0.0;
+};
+
+// Indices (ascending) of the samples to keep as KNN prototypes: Wilson editing
+// removes noisy and overlapping samples, then Hart condensing keeps the ones
+// needed to classify the rest correctly with 1-NN.
+std::vector<std::size_t> selectPrototypes(
+    const std::vector<TrainingSample>& samples,
+    const PrototypeSelectionParams& params,
+    PrototypeSelectionStats* stats = nullptr);
+
+#endif // !PROTOTYPE_SELECTION_H
@@ -0,0 +1,80 @@
+#pragma once
+#ifndef QUANTIZED_STORE_H
+#define QUANTIZED_STORE_H
+
+#include "baselines/knn/feature_extractor.h"
+#include "baselines/knn/k_nearest_list.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/* KNN reference set kept as the integers the float features are computed from:
+   pixels as bytes, zone and projection sums as int16. The integer squared
+   distance is an exact multiple of the float-path distance (each group is
+   weighted by its squared normalization), so the neighbor order is the same
+   at roughly a third of the memory and with integer SIMD kernels. */
+class QuantizedFeatureStore {
+public:
+    using Distance = std::uint64_t;
+    using NearestList = BasicKNearestList<Distance>;
+
+    static constexpr std::size_t alignment = 64; // bytes
+
+    QuantizedFeatureStore();
+
+    // false when the group sums of this layout would not fit in int16
+    static bool supports(const KNNFeatureLayout& layout);
+
+    // allocates rows zero-filled rows; false if the layout is not supported
+    bool reset(const KNNFeatureLayout& layout, std::size_t rows);
+    void clear();
+
+    // quantizes float features (extractKNNFeatures() output) into row r
+    void setRow(std::size_t r, const float* features, std::size_t count);
+    // same encoding for a query, out must hold rowBytes() bytes
+    void quantize(const float* features, std::size_t count, std::uint8_t* out) const;
+
+    Distance distance(const std::uint8_t* a, const std::uint8_t* b) const;
+    // closest rows to an encoded query, as many as best holds
+    void search(const std::uint8_t* query, NearestList& best) const;
+    // the float-path squared distance an integer distance corresponds to
+    float toFloatDistance(Distance distance) const;
+
+    bool empty() const { return rowCount == 0; }
+    std::size_t size() const { return rowCount; }
+    std::size_t rowBytes() const { return rowStride; }
+    std::size_t memoryBytes() const { return rowCount * rowStride; }
+    const KNNFeatureLayout& layout() const { return featureLayout; }
+
+private:
+    struct AlignedDeleter {
+        void operator()(std::uint8_t* ptr) const;
+    };
+
+    KNNFeatureLayout featureLayout;
+    std::size_t rowCount = 0;
+    std::size_t rowStride = 0;
+
+    // row layout: pixel bytes, then zone, row and column sums as int16,
+    // each group zero-padded to a whole SIMD vector
+    std::size_t pixelBytes = 0;
+    std::size_t zoneOffset = 0;
+    std::size_t rowSumOffset = 0;
+    std::size_t columnSumOffset = 0;
+    std::size_t zoneValues = 0;
+    std::size_t rowSumValues = 0;
+    std::size_t columnSumValues = 0;
+
+    // per-group weights of the integer distance and its float scale
+    Distance pixelWeight = 0;
+    Distance zoneWeight = 0;
+    Distance rowSumWeight = 0;
+    Distance columnSumWeight = 0;
+    double floatScale = 0.0;
+
+    std::unique_ptr<std::uint8_t[], AlignedDeleter> values;
+
+    const std::uint8_t* row(std::size_t r) const { return values.get() + r * rowStride; }
+};
+
+#endif // !QUANTIZED_STORE_H
@@ -0,0 +1,97 @@
+#pragma once
+#ifndef SHARDED_KNN_H
+#define SHARDED_KNN_H
+
+#include "baselines/knn/knn_classifier.h"
+#include <cstddef>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/* One shard of a reference set served to a ShardedKNNClassifier over a
+   Unix-domain socket. The classifier is usually a loadModel() of one of the
+   files written by KNNClassifier::saveShardModels(), so the rows stay in the
+   shared file mapping. Batches are answered with neighborsBatch(), the k
+   nearest rows of every query with their labels and distances. Coordinators
+   are served one connection at a time. */
+class KNNShardServer {
+public:
+    // threads = workers per batch, 0 = hardware concurrency
+    explicit KNNShardServer(const KNNClassifier& classifier, unsigned int threads = 0);
+    ~KNNShardServer();
+
+    KNNShardServer(const KNNShardServer&) = delete;
+    KNNShardServer& operator=(const KNNShardServer&) = delete;
+
+    // binds socketPath, replacing a stale socket file
+    bool listen(const std::string& socketPath);
+    // answers requests until a coordinator asks for shutdown; false on a socket error
+    bool serve();
+    void close();
+
+private:
+    const KNNClassifier& classifier;
+    unsigned int threads;
+    int listenFd = -1;
+    std::string boundPath;
+
+    // false when the connection is done, shutdown set when it asked the server to stop
+    bool handleRequest(int fd, bool& shutdown);
+};
+
+/* Coordinator over KNNShardServer processes that each hold a contiguous
+   slice of one reference set. A batch is sent to every shard before any
+   answer is read, so the shards search it in parallel. The per-shard top-k
+   lists are merged on (distance, global row) and voted on with
+   KNNClassifier::vote(), which reproduces the neighbors and predictions
+   of the unsharded classifier. Shard order must follow the row order of
+   saveShardModels(). */
+class ShardedKNNClassifier {
+public:
+    ShardedKNNClassifier();
+    ~ShardedKNNClassifier();
+
+    ShardedKNNClassifier(const ShardedKNNClassifier&) = delete;
+    ShardedKNNClassifier& operator=(const ShardedKNNClassifier&) = delete;
+
+    // waits up to timeoutMs for each shard to start listening; false if any shard is
+    // unreachable or the shards disagree on k or on the feature size
+    bool connect(const std::vector<std::string>& socketPaths, int timeoutMs = 5000);
+    void disconnect();
+    // asks every shard process to exit, then disconnects
+    void shutdownShards();
+
+    int predict(const std::vector<float>& features);
+    std::vector<int> predictBatch(const std::vector<std::vector<float>>& queries);
+    // merged neighbors, rows numbered across the whole reference set; empty lists on a shard error
+    std::vector<std::vector<KNNNeighbor>> neighborsBatch(const std::vector<std::vector<float>>& queries);
+
+    bool connected() const { return !shards.empty(); }
+    std::size_t shardCount() const { return shards.size(); }
+    std::size_t size() const { return totalRows; }
+    int getK() const { return k; }
+
+private:
+    struct Shard {
+        int fd = -1;
+        std::size_t firstRow = 0;  // global id of the shard's row 0
+        std::size_t rows = 0;
+    };
+
+    std::vector<Shard> shards;
+    std::size_t totalRows = 0;
+    std::size_t featureDim = 0;
+    int k = 0;
+
+    bool searchChunk(
+        const std::vector<std::vector<float>>& queries,
+        std::size_t begin,
+        std::size_t end,
+        std::vector<std::vector<KNNNeighbor>>& neighbors);
+};
+
+// Forks a worker process that loads modelPath and serves it on socketPath until shutdown.
+// Returns the child pid, -1 on failure. Fork before starting threads in the parent.
+pid_t startKNNShardProcess(const std::string& modelPath, const std::string& socketPath, int k, unsigned int threads = 1);
+
+#endif // !SHARDED_KNN_H
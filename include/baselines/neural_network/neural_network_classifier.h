@@ -4,6 +4,7 @@
 
 #include "baselines/common/training_sample.h"
 #include "baselines/neural_network/nn/opt_mlp.h"
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -14,6 +15,8 @@ public:
     void train(const std::vector<TrainingSample>& trainingData, int epochs = 20, float learningRate = 0.05f);
     int predict_digit(const std::vector<float>& features);
     float evaluate(std::vector<TrainingSample>& testData);
+    // number of samples predicted right; evaluate() is this over testData.size()
+    std::size_t countCorrect(const std::vector<TrainingSample>& testData, bool showProgress = false);
 
     bool save_model(const std::string& filename) const;
     bool load_model(const std::string& filename);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "baselines/common/feature_dataset.h"
+#include "baselines/nn_mlp_fast/matrix.h"
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct BatchLoaderParams {
+    bool shuffle = false;            // new sample order every epoch
+    std::size_t prefetchDepth = 2;   // batches assembled ahead of the trainer
+    unsigned int seed = 42;
+};
+
+// one minibatch: batch rows of features and their labels
+struct Batch {
+    Matrix X;
+    std::vector<int> y;
+};
+
+/* Assembles the minibatches of `epochs` passes over a dataset on a producer
+   thread while the trainer computes. Ready batches wait in a ring of
+   prefetchDepth slots; next() swaps the caller's spent batch into the slot
+   it takes, so the buffers circulate and steady state allocates nothing.
+   With shuffle on, every epoch visits the rows in a fresh permutation; each
+   batch is copied from its rows into one contiguous matrix. The dataset must
+   outlive the loader. */
+class BatchLoader {
+public:
+    BatchLoader(const FeatureDataset& data, std::size_t batchSize, int epochs, const BatchLoaderParams& params = {});
+    ~BatchLoader();
+
+    BatchLoader(const BatchLoader&) = delete;
+    BatchLoader& operator=(const BatchLoader&) = delete;
+
+    std::size_t batchesPerEpoch() const { return perEpoch; }
+    // the next batch in epoch order into batch; false once every epoch has been handed out
+    bool next(Batch& batch);
+
+private:
+    const FeatureDataset& data;
+    std::size_t batchSize;
+    std::size_t perEpoch;
+    std::size_t total;
+    BatchLoaderParams params;
+
+    std::vector<Batch> ring;
+    std::size_t head = 0;       // next slot the trainer takes
+    std::size_t ready = 0;      // filled slots from head on
+    std::size_t delivered = 0;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable filled;
+    std::condition_variable drained;
+    std::thread producer;
+
+    void produce();
+};
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "baselines/common/feature_dataset.h"
 #include "baselines/common/training_sample.h"
+#include "baselines/nn_mlp_fast/batch_loader.h"
 #include "baselines/nn_mlp_fast/dense_layer.h"
 #include "baselines/nn_mlp_fast/matrix.h"
 #include <string>
@@ -16,9 +18,29 @@ public:
         float learningRate = 0.01f,
         std::size_t batchSize = 64,
         const std::string& runName = "");
+    // minibatches come from a BatchLoader: in dataset order unless setBatchLoaderParams() turns
+    // on shuffling, and assembled on a producer thread while the previous batch trains
+    void train(
+        const FeatureDataset& trainingData,
+        int epochs = 10,
+        float learningRate = 0.01f,
+        std::size_t batchSize = 64,
+        const std::string& runName = "");
+    // every epoch rewinds the source and trains on its chunks in order; only one chunk is held,
+    // and a chunk's last batch is short rather than spanning into the next chunk
+    void train(
+        FeatureChunkSource& trainingData,
+        int epochs = 10,
+        float learningRate = 0.01f,
+        std::size_t batchSize = 64,
+        const std::string& runName = "");
+
+    // shuffling, prefetch depth and seed of the minibatches train() draws
+    void setBatchLoaderParams(const BatchLoaderParams& params) { loaderParams = params; }
 
     int predict_digit(const std::vector<float>& features) const;
     float evaluate(const std::vector<TrainingSample>& testData) const;
+    float evaluate(const FeatureDataset& testData) const;
 
     bool save_model(const std::string& filename) const;
     bool load_model(const std::string& filename);
@@ -27,16 +49,12 @@ private:
     DenseLayer layer1;
     DenseLayer layer2;
     DenseLayer layer3;
+    BatchLoaderParams loaderParams;
 
-    static Matrix makeBatchX(
-        const std::vector<TrainingSample>& data,
-        std::size_t start,
-        std::size_t batchSize);
-
-    static std::vector<int> makeBatchY(
-        const std::vector<TrainingSample>& data,
-        std::size_t start,
-        std::size_t batchSize);
+    int predictRow(const float* features, int featureDim) const;
+    // forward, backward and step on one batch; returns its loss
+    float trainBatch(const Matrix& X, const std::vector<int>& y, float learningRate);
+    static void logEpoch(int epoch, int epochs, float avgLoss, const std::string& runName);
 
     static Matrix tanhForward(const Matrix& x);
     static Matrix tanhBackward(const Matrix& activated, const Matrix& gradOutput);
@@ -2,6 +2,7 @@
 #ifndef IMAGE_MATRIX_H
 #define IMAGE_MATRIX_H
 
+#include "core/image_view.h"
 #include <vector>
 #include <string>
 
@@ -13,6 +14,8 @@ public:
     // constructors
     ImageMatrix();
     ImageMatrix(int w, int h, int c, unsigned char value = 0);
+    // copies the viewed pixels into a packed image
+    explicit ImageMatrix(const ImageView& view);
 
     // access
     inline unsigned char& operator()(int y, int x, int c) {
@@ -22,6 +25,11 @@ public:
     inline const unsigned char& operator()(int y, int x, int c) const {
         return data[(y * width + x) * channels + c];
     }
+
+    // views of the whole image or of a rectangle in it (clipped); invalidated by resize()
+    ImageView view() const { return {data.data(), width, height, channels}; }
+    ImageView view(int x, int y, int w, int h) const { return view().crop(x, y, w, h); }
+
     // basic utilities
     bool empty() const;
     void fill(unsigned char value);
@@ -0,0 +1,47 @@
+#pragma once
+#ifndef IMAGE_VIEW_H
+#define IMAGE_VIEW_H
+
+#include <algorithm>
+#include <cstddef>
+
+/* Non-owning view of interleaved 8-bit pixels laid out like ImageMatrix,
+   except that row y starts stride bytes after row y - 1. A view can thus
+   cover a rectangle inside a larger image, and cropping it again is only
+   pointer arithmetic. The viewed pixels must outlive the view. */
+class ImageView {
+public:
+    const unsigned char* data = nullptr;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::size_t stride = 0;  // bytes from the start of one row to the next
+
+    ImageView() = default;
+    ImageView(const unsigned char* data, int width, int height, int channels, std::size_t stride)
+        : data(data), width(width), height(height), channels(channels), stride(stride) {}
+    // tightly packed rows
+    ImageView(const unsigned char* data, int width, int height, int channels)
+        : ImageView(data, width, height, channels, static_cast<std::size_t>(width) * channels) {}
+
+    const unsigned char& operator()(int y, int x, int c) const {
+        return data[y * stride + static_cast<std::size_t>(x) * channels + c];
+    }
+    const unsigned char* row(int y) const { return data + y * stride; }
+
+    bool empty() const { return width <= 0 || height <= 0; }
+    // rows follow each other without gaps, so the pixels are one block
+    bool contiguous() const { return stride == static_cast<std::size_t>(width) * channels; }
+
+    // the rectangle at (x, y) of size w x h, clipped to this view
+    ImageView crop(int x, int y, int w, int h) const {
+        const int left = std::clamp(x, 0, width);
+        const int top = std::clamp(y, 0, height);
+        const int right = std::clamp(x + w, left, width);
+        const int bottom = std::clamp(y + h, top, height);
+        return {data + top * stride + static_cast<std::size_t>(left) * channels,
+                right - left, bottom - top, channels, stride};
+    }
+};
+
+#endif // !IMAGE_VIEW_H
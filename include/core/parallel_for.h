@@ -0,0 +1,61 @@
+#pragma once
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// 0 -> one worker per hardware thread
+inline unsigned int resolveThreadCount(unsigned int threads) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    return std::max(1u, threads);
+}
+
+/* Runs fn(begin, end, worker) over [0, count) in chunks of `grain` items.
+   Chunks are handed out through an atomic counter, so workers that hit
+   cheap items simply take more chunks. worker is in [0, threads) and
+   indexes per-thread scratch; the calling thread is worker 0. */
+template <typename Fn>
+void parallelFor(std::size_t count, std::size_t grain, unsigned int threads, Fn&& fn) {
+    if (count == 0) {
+        return;
+    }
+
+    grain = std::max<std::size_t>(1, grain);
+    const std::size_t chunks = (count + grain - 1) / grain;
+    const unsigned int workers = static_cast<unsigned int>(
+        std::min<std::size_t>(resolveThreadCount(threads), chunks));
+
+    if (workers == 1) {
+        for (std::size_t begin = 0; begin < count; begin += grain) {
+            fn(begin, std::min(count, begin + grain), 0u);
+        }
+        return;
+    }
+
+    std::atomic<std::size_t> nextChunk{0};
+    auto run = [&](unsigned int worker) {
+        for (std::size_t chunk = nextChunk.fetch_add(1); chunk < chunks; chunk = nextChunk.fetch_add(1)) {
+            const std::size_t begin = chunk * grain;
+            fn(begin, std::min(count, begin + grain), worker);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (unsigned int worker = 1; worker < workers; worker++) {
+        pool.emplace_back(run, worker);
+    }
+
+    run(0);
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+#endif // !PARALLEL_FOR_H
@@ -0,0 +1,28 @@
+#pragma once
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <cstddef>
+
+/* Non-owning view of count contiguous T, the subset of C++20 std::span the
+   tree needs. The viewed memory must outlive the span. */
+template <typename T>
+class Span {
+public:
+    Span() = default;
+    Span(T* data, std::size_t count) : items(data), count(count) {}
+
+    T* data() const { return items; }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    T& operator[](std::size_t i) const { return items[i]; }
+    T* begin() const { return items; }
+    T* end() const { return items + count; }
+
+private:
+    T* items = nullptr;
+    std::size_t count = 0;
+};
+
+#endif // !SPAN_H
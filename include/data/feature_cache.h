@@ -0,0 +1,35 @@
+#pragma once
+#ifndef FEATURE_CACHE_H
+#define FEATURE_CACHE_H
+
+#include "baselines/common/feature_dataset.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Content-addressed store of extracted features. An entry is keyed by a hash
+   of the source files' bytes and of the extractor configuration, so a changed
+   dataset or extractor setting never hits a stale entry. Entries are laid out
+   like the KNN model file (header, labels, aligned padded rows) and are
+   loaded by mapping them: the dataset's features are a view of the file. */
+class FeatureCache {
+public:
+    explicit FeatureCache(std::string directory = "feature_cache");
+
+    void setDirectory(const std::string& path) { directory = path; }
+    const std::string& getDirectory() const { return directory; }
+
+    // 64-bit hash of the files' contents followed by config; 0 if a file cannot be read
+    static std::uint64_t key(const std::vector<std::string>& files, const std::string& config);
+
+    std::string entryPath(std::uint64_t key) const;
+    // false when there is no valid entry for key; dataset is left untouched then
+    bool load(std::uint64_t key, FeatureDataset& dataset) const;
+    // writes to a temporary file and renames it, so readers never map a partial entry
+    bool store(std::uint64_t key, const FeatureDataset& dataset) const;
+
+private:
+    std::string directory;
+};
+
+#endif // !FEATURE_CACHE_H
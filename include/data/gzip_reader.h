@@ -0,0 +1,101 @@
+#pragma once
+#ifndef GZIP_READER_H
+#define GZIP_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// true when the file starts with the gzip magic bytes 1f 8b
+bool isGzipFile(const std::string& path);
+
+/* Streaming gzip (RFC 1952) / DEFLATE (RFC 1951) decoder with no external
+   dependency. The compressed file is read in large sequential blocks and
+   inflated on demand into the caller's buffer, so only the input block and
+   the 32 KB history window are held however large the data is. Huffman
+   codes are decoded through a lookup table indexed by the next bits of the
+   stream, which resolves almost every symbol in one probe; only codes longer
+   than the table width fall back to a canonical walk. Concatenated gzip
+   members are decoded back to back, and every member's CRC-32 and length
+   are checked at its end. */
+class GzipReader {
+public:
+    GzipReader();
+    ~GzipReader();
+
+    GzipReader(const GzipReader&) = delete;
+    GzipReader& operator=(const GzipReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    // decompresses up to size bytes into out; fewer only at the end of the data or on an error
+    std::size_t read(std::uint8_t* out, std::size_t size);
+    // back to the first decompressed byte
+    bool rewind();
+    // decodes and drops whatever is left, so the last member's CRC and length are checked; false on an error
+    bool finish();
+
+    bool isOpen() const { return fd >= 0; }
+    bool failed() const { return state == State::Error; }
+    bool finished() const { return state == State::Done; }
+
+    static constexpr int fastBits = 10;
+
+    /* Canonical Huffman code. fast[next fastBits stream bits] holds
+       symbol << 4 | code length for codes of up to fastBits bits and 0 for
+       the longer ones, which are decoded from count and symbols. */
+    struct HuffmanTable {
+        std::uint16_t fast[1 << fastBits];
+        std::uint16_t count[16];
+        std::uint16_t symbols[288];
+    };
+
+private:
+    enum class State { MemberHeader, BlockHeader, Stored, Codes, MemberTrailer, Done, Error };
+
+    int fd = -1;
+    std::string path;
+    State state = State::Done;
+
+    std::vector<std::uint8_t> input;
+    std::size_t inputPos = 0;
+    std::size_t inputEnd = 0;
+    bool inputExhausted = false;
+
+    std::uint64_t bitBuffer = 0;
+    unsigned int bitCount = 0;
+
+    std::vector<std::uint8_t> window;  // the last 32 KB of output, for back-references
+    std::size_t windowPos = 0;         // bytes written in this member
+
+    bool lastBlock = false;
+    std::size_t storedRemaining = 0;
+    std::size_t copyLength = 0;        // back-reference still to copy
+    std::size_t copyDistance = 0;
+
+    HuffmanTable literalCodes;
+    HuffmanTable distanceCodes;
+
+    std::uint32_t crc = 0;
+    std::size_t members = 0;           // gzip members decoded completely
+
+    void reset();
+    bool fail(const char* reason);
+
+    bool fillInput();
+    void refillBits();
+    bool needBits(unsigned int count);
+    std::uint32_t takeBits(unsigned int count);
+    bool readByte(std::uint8_t& byte);
+    int decodeSymbol(const HuffmanTable& table);
+
+    bool readMemberHeader();
+    bool readBlockHeader();
+    bool readDynamicTables();
+    bool readMemberTrailer();
+    bool decodeCodes(std::uint8_t* out, std::size_t size, std::size_t& produced);
+};
+
+#endif // !GZIP_READER_H
@@ -0,0 +1,50 @@
+#pragma once
+#ifndef IDX_FORMAT_H
+#define IDX_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+/* IDX header parsing shared by the mapped and the streaming MNIST readers.
+   An IDX file starts with a magic (two zero bytes, the element type, the
+   number of dimensions) and one big-endian 32-bit size per dimension. */
+
+constexpr std::size_t idxImageHeaderSize = 16;
+constexpr std::size_t idxLabelHeaderSize = 8;
+
+struct IDXImageHeader {
+    std::size_t count = 0;
+    int rows = 0;
+    int cols = 0;
+
+    std::size_t imageBytes() const { return static_cast<std::size_t>(rows) * cols; }
+};
+
+inline std::uint32_t readIDXInt(const std::uint8_t* bytes) {
+    return (static_cast<std::uint32_t>(bytes[0]) << 24) | (static_cast<std::uint32_t>(bytes[1]) << 16)
+        | (static_cast<std::uint32_t>(bytes[2]) << 8) | static_cast<std::uint32_t>(bytes[3]);
+}
+
+// unsigned-byte images in 3 dimensions (0x00000803); 16-bit sides keep every size product below 2^64
+inline bool parseIDXImageHeader(const std::uint8_t* bytes, IDXImageHeader& header) {
+    const std::uint32_t rows = readIDXInt(bytes + 8);
+    const std::uint32_t cols = readIDXInt(bytes + 12);
+    if (readIDXInt(bytes) != 0x00000803 || rows == 0 || cols == 0 || rows > 0xffff || cols > 0xffff) {
+        return false;
+    }
+    header.count = readIDXInt(bytes + 4);
+    header.rows = static_cast<int>(rows);
+    header.cols = static_cast<int>(cols);
+    return true;
+}
+
+// unsigned-byte labels in 1 dimension (0x00000801)
+inline bool parseIDXLabelHeader(const std::uint8_t* bytes, std::size_t& count) {
+    if (readIDXInt(bytes) != 0x00000801) {
+        return false;
+    }
+    count = readIDXInt(bytes + 4);
+    return true;
+}
+
+#endif // !IDX_FORMAT_H
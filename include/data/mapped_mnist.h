@@ -0,0 +1,55 @@
+#pragma once
+#ifndef MAPPED_MNIST_H
+#define MAPPED_MNIST_H
+
+#include "core/image_matrix.h"
+#include "core/span.h"
+#include "io/mapped_file.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/* One grayscale image inside a mapped IDX file: width * height bytes, row-major. */
+struct MNISTImageView {
+    const std::uint8_t* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+
+    std::uint8_t operator()(int y, int x) const { return pixels[y * width + x]; }
+    // the same pixels as a one-channel ImageView, for the preprocessing and feature code
+    ImageView view() const { return {pixels, width, height, 1}; }
+    // copies the pixels into image, reusing its buffer when the size already matches
+    void copyTo(ImageMatrix& image) const;
+};
+
+/* An IDX image/label file pair mapped read-only. Headers are validated on
+   open; images and labels are then views straight into the mappings, so
+   opening costs two mmap calls however large the files are, and the pages
+   are shared with every other process reading the same files. */
+class MappedMNISTDataset {
+public:
+    bool open(const std::string& imagePath, const std::string& labelPath);
+    void close();
+
+    bool isOpen() const { return imageFile.isOpen(); }
+    std::size_t size() const { return count; }
+    int imageWidth() const { return cols; }
+    int imageHeight() const { return rows; }
+
+    MNISTImageView image(std::size_t i) const {
+        return {pixels + i * static_cast<std::size_t>(rows) * cols, cols, rows};
+    }
+    Span<const std::uint8_t> labels() const { return {labelData, count}; }
+    int label(std::size_t i) const { return labelData[i]; }
+
+private:
+    MappedFile imageFile;
+    MappedFile labelFile;
+    const std::uint8_t* pixels = nullptr;
+    const std::uint8_t* labelData = nullptr;
+    std::size_t count = 0;
+    int rows = 0;
+    int cols = 0;
+};
+
+#endif // !MAPPED_MNIST_H
@@ -0,0 +1,97 @@
+#pragma once
+#ifndef MNIST_FEATURES_H
+#define MNIST_FEATURES_H
+
+#include "baselines/common/feature_dataset.h"
+#include "baselines/knn/feature_extractor.h"
+#include "core/image_view.h"
+#include "core/parallel_for.h"
+#include "data/mnist_stream.h"
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+enum class MNISTFeatureKind {
+    KNN,           // extractKNNFeatures
+    NeuralNetwork  // extractNeuralNetworkFeatures
+};
+
+/* Features of every image of an MNIST set, extracted in parallel into one
+   contiguous matrix. Images is any set with size(), imageWidth(),
+   imageHeight(), image(i) and label(i): MNISTDataset, MappedMNISTDataset or
+   MNISTChunk. threads = 0 -> hardware concurrency. */
+template <typename Images>
+FeatureDataset extractMNISTFeatures(
+    const Images& images,
+    const FeatureExtractor& extractor,
+    MNISTFeatureKind kind,
+    unsigned int threads = 0) {
+
+    // images per parallelFor chunk
+    constexpr std::size_t grain = 512;
+
+    if (images.size() == 0) {
+        return {};
+    }
+
+    const int width = images.imageWidth();
+    const int height = images.imageHeight();
+    const std::size_t dims = kind == MNISTFeatureKind::KNN
+        ? static_cast<std::size_t>(extractor.getKNNFeatureDimensions(width, height))
+        : static_cast<std::size_t>(width) * height;
+
+    // Workers write disjoint rows of the one preallocated matrix. It is not zeroed up front:
+    // a serial memset would fault in every page on one thread, each worker touches its own rows.
+    FeatureDataset dataset;
+    dataset.features = FeatureMatrix::uninitialized(images.size(), dims);
+    dataset.labels.resize(images.size());
+
+    parallelFor(images.size(), grain, threads, [&](std::size_t begin, std::size_t end, unsigned int) {
+        for (std::size_t i = begin; i < end; i++) {
+            // the extractor reads the pixels in place, wherever the set keeps them
+            const ImageView image = images.image(i).view();
+            float* row = dataset.features.row(i);
+            if (kind == MNISTFeatureKind::KNN) {
+                extractor.extractKNNFeaturesInto(image, row);
+            } else {
+                const std::vector<float> pixels = extractor.extractNeuralNetworkFeatures(image);
+                std::copy(pixels.begin(), pixels.end(), row);
+            }
+            std::fill(row + dims, row + dataset.features.stride(), 0.0f);
+            dataset.labels[i] = images.label(i);
+        }
+    });
+
+    return dataset;
+}
+
+/* The features of a streamed IDX pair, one FeatureDataset per reader chunk,
+   so training and evaluation hold a single chunk of images and features. */
+class MNISTFeatureStream : public FeatureChunkSource {
+public:
+    MNISTFeatureStream(
+        MNISTStreamReader& reader,
+        const FeatureExtractor& extractor,
+        MNISTFeatureKind kind,
+        unsigned int threads = 0)
+        : reader(reader), extractor(extractor), kind(kind), threads(threads) {}
+
+    bool next(FeatureDataset& chunk) override {
+        MNISTChunk images;
+        if (!reader.next(images)) {
+            return false;
+        }
+        chunk = extractMNISTFeatures(images, extractor, kind, threads);
+        return true;
+    }
+
+    void rewind() override { reader.rewind(); }
+
+private:
+    MNISTStreamReader& reader;
+    const FeatureExtractor& extractor;
+    MNISTFeatureKind kind;
+    unsigned int threads;
+};
+
+#endif // !MNIST_FEATURES_H
@@ -3,29 +3,67 @@
 #define MNIST_LOADER_H
 
 #include "core/image_matrix.h"
+#include "core/span.h"
+#include "data/mapped_mnist.h"
+#include "data/mnist_stream.h"
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
+// one image of an MNISTDataset; valid while the dataset is alive and unchanged
 struct MNISTImage {
-    ImageMatrix image;
+    MNISTImageView image;
     int label;
 };
 
+/* MNIST images of one size in a single N x H x W byte buffer, plus one label
+   byte per image. Indexing yields views into the buffer, so walking the set
+   is one linear scan instead of a pointer chase through per-image blocks. */
+class MNISTDataset {
+public:
+    // copies the mapped pixels and labels in two block copies
+    void assign(const MappedMNISTDataset& source);
+    // reads every chunk of an opened stream, e.g. a compressed IDX pair; false on a read error
+    bool assign(MNISTStreamReader& source);
+    void clear();
+
+    std::size_t size() const { return labelData.size(); }
+    bool empty() const { return labelData.empty(); }
+    int imageWidth() const { return width; }
+    int imageHeight() const { return height; }
+
+    MNISTImageView image(std::size_t i) const {
+        return {pixels.data() + i * static_cast<std::size_t>(width) * height, width, height};
+    }
+    int label(std::size_t i) const { return labelData[i]; }
+    Span<const std::uint8_t> labels() const { return {labelData.data(), labelData.size()}; }
+    // image i starts at pixelData() + i * width * height
+    const std::uint8_t* pixelData() const { return pixels.data(); }
+
+    MNISTImage operator[](std::size_t i) const { return {image(i), label(i)}; }
+
+private:
+    std::vector<std::uint8_t> pixels;
+    std::vector<std::uint8_t> labelData;
+    int width = 0;
+    int height = 0;
+};
+
 class MNISTLoader {
 public:
     MNISTLoader();
     bool loadTrainingData(const std::string& imagePath, const std::string& labelPath);
     bool loadTestData(const std::string& imagePath, const std::string& labelPath);
-    const std::vector<MNISTImage>& getTrainingData() const;
-    const std::vector<MNISTImage>& getTestData() const;
+    const MNISTDataset& getTrainingData() const;
+    const MNISTDataset& getTestData() const;
 
 private:
-    std::vector<MNISTImage> trainingData;
-    std::vector<MNISTImage> testData;
+    MNISTDataset trainingData;
+    MNISTDataset testData;
 
-    int reverseInt(int i);
-    bool loadImages(const std::string& imagePath, std::vector<MNISTImage>& data);
-    bool loadLabels(const std::string& labelPath, std::vector<MNISTImage>& data);
+    // copies the mapped IDX pair into data, or streams it in when either file is gzip-compressed
+    bool loadData(const std::string& imagePath, const std::string& labelPath, MNISTDataset& data);
 };
 
 
@@ -0,0 +1,113 @@
+#pragma once
+#ifndef MNIST_STREAM_H
+#define MNIST_STREAM_H
+
+#include "data/gzip_reader.h"
+#include "data/mapped_mnist.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Images [first, first + size()) of a streamed IDX pair. The pixels and
+   labels live in the reader's buffers and are overwritten by its next read. */
+struct MNISTChunk {
+    std::size_t first = 0;
+    std::size_t count = 0;
+    int width = 0;
+    int height = 0;
+    const std::uint8_t* pixels = nullptr;
+    const std::uint8_t* labels = nullptr;
+
+    std::size_t size() const { return count; }
+    int imageWidth() const { return width; }
+    int imageHeight() const { return height; }
+    MNISTImageView image(std::size_t i) const {
+        return {pixels + i * static_cast<std::size_t>(width) * height, width, height};
+    }
+    int label(std::size_t i) const { return labels[i]; }
+};
+
+/* Reads an IDX image/label pair front to back in chunks of a fixed number
+   of images, for corpora too large to load or map whole. Each chunk is one
+   large pread() per file into buffers reused for every chunk, so memory
+   stays at one chunk; the kernel is told the access is sequential and asked
+   to read the next chunk ahead while the current one is processed.
+   gzip-compressed files (told apart by their magic bytes) are inflated on
+   the fly by a GzipReader instead, still one chunk at a time. */
+class MNISTStreamReader {
+public:
+    explicit MNISTStreamReader(std::size_t chunkImages = 8192);
+    ~MNISTStreamReader();
+
+    MNISTStreamReader(const MNISTStreamReader&) = delete;
+    MNISTStreamReader& operator=(const MNISTStreamReader&) = delete;
+
+    bool open(const std::string& imagePath, const std::string& labelPath);
+    void close();
+
+    // the next chunk into chunk; false after the last one or on a read error (see failed())
+    bool next(MNISTChunk& chunk);
+    // back to the first image, e.g. for the next epoch
+    void rewind();
+    bool failed() const { return readFailed; }
+
+    // calls fn(const MNISTChunk&) for every chunk from the first; false on a read error
+    template <typename Fn>
+    bool forEachChunk(Fn&& fn) {
+        rewind();
+        MNISTChunk chunk;
+        while (next(chunk)) {
+            fn(static_cast<const MNISTChunk&>(chunk));
+        }
+        return !readFailed;
+    }
+
+    bool isOpen() const { return imageSource.isOpen(); }
+    std::size_t size() const { return count; }
+    std::size_t position() const { return nextImage; }
+    std::size_t chunkSize() const { return chunkImages; }
+    int imageWidth() const { return cols; }
+    int imageHeight() const { return rows; }
+    // false when a file is compressed and its header count is only checked as it is inflated
+    bool sizeChecked() const { return !imageSource.compressed && !labelSource.compressed; }
+
+private:
+    // one of the two files: read in place with pread(), or inflated in order when compressed
+    struct Source {
+        int fd = -1;
+        bool compressed = false;
+        GzipReader gzip;
+        std::size_t position = 0;  // decompressed bytes consumed so far
+
+        bool open(const std::string& path);
+        void close();
+        bool isOpen() const { return fd >= 0 || gzip.isOpen(); }
+        // size bytes at offset; a compressed source skips forward or restarts to get there
+        bool read(std::uint8_t* data, std::size_t size, std::size_t offset);
+        // size bytes at offset into buffer; a compressed source grows it as the bytes arrive,
+        // so a header claiming more than the file holds fails before a large allocation
+        bool read(std::vector<std::uint8_t>& buffer, std::size_t size, std::size_t offset);
+        // after the last read: a compressed source inflates the rest to check its CRC and length
+        bool finish();
+        // the file's length, 0 when it is compressed and only known once inflated
+        std::size_t fileSize() const;
+    };
+
+    std::size_t chunkImages;
+    Source imageSource;
+    Source labelSource;
+    std::size_t count = 0;
+    int rows = 0;
+    int cols = 0;
+    std::size_t nextImage = 0;
+    bool readFailed = false;
+
+    std::vector<std::uint8_t> pixelBuffer;
+    std::vector<std::uint8_t> labelBuffer;
+
+    // asks the kernel to start reading images [first, first + chunkImages)
+    void readAhead(std::size_t first) const;
+};
+
+#endif // !MNIST_STREAM_H
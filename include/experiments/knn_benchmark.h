@@ -0,0 +1,76 @@
+#pragma once
+
+#include "baselines/common/training_sample.h"
+#include "baselines/knn/knn_classifier.h"
+#include <string>
+#include <vector>
+
+struct KNNSearchReport {
+    std::string config;
+    double recall = 0.0;          // recall@k against the exact scan
+    double microsPerQuery = 0.0;
+    float accuracy = 0.0f;
+    double prunedFraction = 0.0;  // share of stored rows whose full distance was skipped (Exact/Pivot/Cascade)
+};
+
+class KNNBenchmark {
+public:
+    // exact scan first (ground truth), then the HNSW index at each efSearch value
+    static std::vector<KNNSearchReport> hnswRecallVsLatency(
+        KNNClassifier& classifier,
+        const std::vector<TrainingSample>& queries,
+        const std::vector<int>& efValues);
+
+    // exact scan first, then PQ search re-ranking each shortlist size (0 = ADC distances only)
+    static std::vector<KNNSearchReport> pqRecallVsRerank(
+        KNNClassifier& classifier,
+        const std::vector<TrainingSample>& queries,
+        const std::vector<int>& rerankValues);
+
+    // exact scan first, then the pivot index with each pivot count; reports the pruned fraction
+    static std::vector<KNNSearchReport> pivotPruning(
+        KNNClassifier& classifier,
+        const std::vector<TrainingSample>& queries,
+        const std::vector<int>& pivotCounts);
+
+    // exact scan first, then an IVF index built with the classifier's parameters, probed
+    // with each nprobe; prints the build time and index memory
+    static std::vector<KNNSearchReport> ivfRecallVsProbes(
+        KNNClassifier& classifier,
+        const std::vector<TrainingSample>& queries,
+        const std::vector<int>& probeCounts);
+
+    // exact scan first, then the zoning/projection cascade at each shortlist size
+    static std::vector<KNNSearchReport> cascadeRecallVsShortlist(
+        KNNClassifier& classifier,
+        const std::vector<TrainingSample>& queries,
+        const std::vector<int>& shortlistSizes);
+
+    // exact scan over the full features first, then a classifier trained with PCA at each
+    // output dimension (0 entries are skipped); prints fit time and explained variance
+    static std::vector<KNNSearchReport> pcaDimensions(
+        const std::vector<TrainingSample>& trainingData,
+        const std::vector<TrainingSample>& queries,
+        const std::vector<int>& componentCounts,
+        int k);
+
+    // float exact scan (ground truth, trained from trainingData) vs the classifier's
+    // compact store (Quantized or Binary mode); also prints the memory of both reference sets
+    static std::vector<KNNSearchReport> compactVsFloat(
+        const KNNClassifier& classifier,
+        const std::vector<TrainingSample>& trainingData,
+        const std::vector<TrainingSample>& queries);
+
+    static void printReport(const std::string& title, const std::vector<KNNSearchReport>& reports);
+    // appends to results/knn_<name>.csv
+    static void logReport(const std::string& name, const std::vector<KNNSearchReport>& reports);
+
+private:
+    // nearest rows of every query under the classifier's current search mode, plus timing and accuracy
+    static KNNSearchReport measure(
+        const KNNClassifier& classifier,
+        const std::vector<TrainingSample>& queries,
+        const std::vector<std::vector<int>>* groundTruth,
+        std::vector<std::vector<int>>* neighbors,
+        const std::string& config);
+};
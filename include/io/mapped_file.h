@@ -0,0 +1,33 @@
+#pragma once
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+/* Read-only memory mapping of a whole file. The pages are shared with the
+   page cache (and with other processes mapping the same file) and are only
+   read from disk when first touched. Move-only; unmaps on destruction. */
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return mapping != nullptr; }
+    const unsigned char* data() const { return static_cast<const unsigned char*>(mapping); }
+    std::size_t size() const { return length; }
+
+private:
+    void* mapping = nullptr;
+    std::size_t length = 0;
+};
+
+#endif // !MAPPED_FILE_H
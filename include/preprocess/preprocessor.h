@@ -11,17 +11,26 @@ struct BoundingBox {
 
 class Preprocessor {
 public:
+    // applyThreshold() keeps pixels strictly above this value
+    static constexpr unsigned char binaryThreshold = 128;
+
     Preprocessor();
 
+    // The ImageView overloads read their input in place, e.g. a region of a larger scan.
+
     // main preprocessing
     ImageMatrix preprocess(const ImageMatrix& input);
+    ImageMatrix preprocess(const ImageView& input);
 
-    // digit extraction from full image
+    // digit extraction from full image; each digit is resized straight from its box in the cleaned image
     std::vector<ImageMatrix> extractDigits(const ImageMatrix& image, int targetWidth = 28, int targetHeight = 28);
+    std::vector<ImageMatrix> extractDigits(const ImageView& image, int targetWidth = 28, int targetHeight = 28);
 
     // individual processing steps
     ImageMatrix applyGrayscale(const ImageMatrix& input);
+    ImageMatrix applyGrayscale(const ImageView& input);
     ImageMatrix applyThreshold(const ImageMatrix& input);
+    ImageMatrix applyThreshold(const ImageView& input);
     // ImageMatrix applyAdapriveThreshold(const ImageMatrix& input, int blockSize = 11, double constant = 2);
     ImageMatrix removeNoise(const ImageMatrix& input);
 
@@ -30,6 +39,7 @@ public:
 
     // utility methods
     ImageMatrix resizeDigit(const ImageMatrix& digit, int targetWidth = 20, int targetHeight = 20);
+    ImageMatrix resizeDigit(const ImageView& digit, int targetWidth = 20, int targetHeight = 20);
     ImageMatrix normalizeDigit(const ImageMatrix& digit);
 
 private:
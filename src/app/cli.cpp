@@ -39,7 +39,7 @@ void CLI::run() {
             realImageMenu();
             break;
         case 4:
-            pressAnyKeyToContinue();
+            performanceMenu();
             break;
         case 5:
             benchmarkMenu();
@@ -76,6 +76,14 @@ void CLI::trainingMenu() {
         std::cin >> algorithmChoice;
 
         currentAlgorithm = (algorithmChoice == 1 ? AlgorithmType::NN_SCALAR_AUTODIFF : AlgorithmType::KNN);
+        if (currentAlgorithm == AlgorithmType::KNN) {
+            chooseKNNSearchMode();
+
+            int components = 0;
+            std::cout << "PCA dimensions (0 = keep all features): ";
+            std::cin >> components;
+            ocr.setKNNPCAComponents(components);
+        }
 
         std::string dataPath;
         std::cout << "Enter path to MNIST data folder: ";
@@ -92,6 +100,9 @@ void CLI::trainingMenu() {
         std::cin >> algorithmChoice;
 
         currentAlgorithm = (algorithmChoice == 1 ? AlgorithmType::NN_SCALAR_AUTODIFF : AlgorithmType::KNN);
+        if (currentAlgorithm == AlgorithmType::KNN) {
+            chooseKNNSearchMode();
+        }
 
         std::string filename;
         std::cout << "Enter model filename (default: trained_model.dat): ";
@@ -122,7 +133,8 @@ void CLI::testingMenu() {
 
     std::cout << "1. Test on training data (self-consistency)\n";
     std::cout << "2. Test on test data (true performance)\n";
-    std::cout << "3. Back to main menu\n";
+    std::cout << "3. Test on an IDX file pair (streamed, any size)\n";
+    std::cout << "4. Back to main menu\n";
     std::cout << "Choose: ";
 
     unsigned short choice = 0;
@@ -148,6 +160,15 @@ void CLI::testingMenu() {
         } else {
             std::cout << "Poor performance - check feature extraction, preprocessing, or hyperparameters\n";
         }
+    } else if (choice == 3) {
+        std::string imagePath;
+        std::string labelPath;
+        std::cout << "Enter path to IDX image file: ";
+        std::cin >> imagePath;
+        std::cout << "Enter path to IDX label file: ";
+        std::cin >> labelPath;
+
+        ocr.evaluateStream(imagePath, labelPath, currentAlgorithm);
     }
 
     pressAnyKeyToContinue();
@@ -182,6 +203,21 @@ void CLI::realImageMenu() {
     std::cout << "Recognizing digits...\n";
     const std::string prediction = ocr.recognize(img, currentAlgorithm);
     std::cout << "Detected number: " << prediction << "\n";
+
+    // learning is opt-in, recognition alone never waits for a correction
+    if (currentAlgorithm == AlgorithmType::KNN) {
+        std::cout << "Correct the result and learn from this image? (y/n): ";
+        std::string answer;
+        std::cin >> answer;
+        if (answer == "y" || answer == "Y") {
+            std::cout << "Type the correct number: ";
+            std::string correction;
+            std::cin >> correction;
+            if (correction != prediction) {
+                ocr.learnDigits(img, correction);
+            }
+        }
+    }
     pressAnyKeyToContinue();
 }
 
@@ -189,13 +225,92 @@ void CLI::benchmarkMenu() {
     clearScreen();
     std::cout << "=== Testing Menu ===\n";
     std::cout << "1. Test KNN Algorithm\n";
+    std::cout << "2. Test Distance Kernel\n";
+    std::cout << "3. Run all tests\n";
 
     unsigned short choice = 0;
     std::cin >> choice;
 
     if (choice == 1) {
         testSuite.testKNN();
+    } else if (choice == 2) {
+        testSuite.testEuclideanDistance();
+    } else if (choice == 3) {
+        testSuite.runAllTests();
     }
 }
 
+void CLI::chooseKNNSearchMode() {
+    std::cout << "=== Choose KNN search ===\n";
+    std::cout << "1. Exact scan\n";
+    std::cout << "2. HNSW index (approximate)\n";
+    std::cout << "3. Product quantization (compressed)\n";
+    std::cout << "4. Integer features (exact)\n";
+    std::cout << "5. Binary pixels (Hamming distance)\n";
+    std::cout << "6. Pivot pruning (exact)\n";
+    std::cout << "7. Zoning cascade (coarse shortlist)\n";
+    std::cout << "8. IVF index (k-means cells)\n";
+
+    unsigned short searchChoice = 0;
+    std::cin >> searchChoice;
+
+    switch (searchChoice) {
+    case 2:
+        ocr.setKNNSearchMode(KNNSearchMode::HNSW);
+        break;
+    case 3:
+        ocr.setKNNSearchMode(KNNSearchMode::PQ);
+        break;
+    case 4:
+        ocr.setKNNSearchMode(KNNSearchMode::Quantized);
+        break;
+    case 5:
+        ocr.setKNNSearchMode(KNNSearchMode::Binary);
+        break;
+    case 6:
+        ocr.setKNNSearchMode(KNNSearchMode::Pivot);
+        break;
+    case 7:
+        ocr.setKNNSearchMode(KNNSearchMode::Cascade);
+        break;
+    case 8:
+        ocr.setKNNSearchMode(KNNSearchMode::IVF);
+        break;
+    default:
+        ocr.setKNNSearchMode(KNNSearchMode::Exact);
+        break;
+    }
+}
+
+void CLI::performanceMenu() {
+    clearScreen();
+    std::cout << "=== Benchmark Performance ===\n";
+
+    if (!ocr.isTrained(AlgorithmType::KNN)) {
+        std::cerr << "KNN model is not trained or loaded yet!\n";
+        pressAnyKeyToContinue();
+        return;
+    }
+
+    std::cout << "1. KNN search recall vs latency\n";
+    std::cout << "2. Prototype selection (shrink reference set)\n";
+    std::cout << "3. PCA dimension sweep\n";
+
+    unsigned short choice = 0;
+    std::cin >> choice;
+
+    std::string dataPath;
+    std::cout << "Enter path to MNIST data folder: ";
+    std::cin >> dataPath;
+
+    if (choice == 2) {
+        ocr.selectKNNPrototypes(dataPath);
+    } else if (choice == 3) {
+        ocr.benchmarkKNNPCA(dataPath);
+    } else {
+        ocr.benchmarkKNNSearch(dataPath);
+    }
+    pressAnyKeyToContinue();
+}
+
 void CLI::pressAnyKeyToContinue() {}
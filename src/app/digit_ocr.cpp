@@ -1,57 +1,138 @@
 #include "app/digit_ocr.h"
+#include "data/gzip_reader.h"
+#include "data/mnist_features.h"
+#include "experiments/knn_benchmark.h"
 
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <utility>
 
-DigitOCR::DigitOCR() : classifier(3), nnClassifier({784, 128, 64, 10}) {}
+namespace {
 
-std::vector<TrainingSample> DigitOCR::loadMNISTSamples(
-    const std::vector<MNISTImage>& data,
+MNISTFeatureKind featureKind(AlgorithmType algo) {
+    return algo == AlgorithmType::KNN ? MNISTFeatureKind::KNN : MNISTFeatureKind::NeuralNetwork;
+}
+
+// the path itself, or its .gz sibling when only the compressed file is there
+std::string resolveIDXPath(const std::string& path) {
+    std::error_code error;
+    if (!std::filesystem::exists(path, error) && std::filesystem::exists(path + ".gz", error)) {
+        return path + ".gz";
+    }
+    return path;
+}
+
+} // namespace
+
+DigitOCR::DigitOCR() : classifier(3), nnClassifier({784, 128, 64, 10}) {
+    // MNIST images and extractDigits() output are both 28x28
+    classifier.setFeatureLayout(featureExtractor.getKNNFeatureLayout(28, 28));
+    // MNIST pixels are binarized with the same cut as the real-image path
+    classifier.setBinaryThreshold(Preprocessor::binaryThreshold);
+}
+
+FeatureDataset DigitOCR::loadMNISTFeatures(
+    const std::string& idxImagePath,
+    const std::string& idxLabelPath,
     AlgorithmType algo) const {
-    std::vector<TrainingSample> samples;
-    samples.reserve(data.size());
+    const std::string imagePath = resolveIDXPath(idxImagePath);
+    const std::string labelPath = resolveIDXPath(idxLabelPath);
+    const std::string config = algo == AlgorithmType::KNN
+        ? featureExtractor.getKNNFeatureConfig()
+        : featureExtractor.getNeuralNetworkFeatureConfig();
+    const std::uint64_t key = FeatureCache::key({imagePath, labelPath}, config);
+
+    FeatureDataset dataset;
+    if (key != 0 && featureCache.load(key, dataset)) {
+        std::cout << "Feature cache hit: " << dataset.size() << " samples mapped from "
+                  << featureCache.entryPath(key) << "\n";
+        return dataset;
+    }
 
-    for (const auto& item : data) {
-        TrainingSample sample;
-        sample.features = (algo == AlgorithmType::KNN)
-            ? featureExtractor.extractKNNFeatures(item.image)
-            : featureExtractor.extractNeuralNetworkFeatures(item.image);
-        sample.label = item.label;
-        samples.push_back(std::move(sample));
+    const auto start = std::chrono::steady_clock::now();
+    if (isGzipFile(imagePath) || isGzipFile(labelPath)) {
+        // compressed files cannot be mapped; inflate them into memory once
+        MNISTLoader loader;
+        if (!loader.loadTestData(imagePath, labelPath)) {
+            return dataset;
+        }
+        std::cout << "Feature cache miss: extracting features from " << loader.getTestData().size() << " images...\n";
+        dataset = extractMNISTFeatures(loader.getTestData(), featureExtractor, featureKind(algo));
+    } else {
+        MappedMNISTDataset data;
+        if (!data.open(imagePath, labelPath)) {
+            return dataset;
+        }
+        std::cout << "Feature cache miss: extracting features from " << data.size() << " images...\n";
+        dataset = extractMNISTFeatures(data, featureExtractor, featureKind(algo));
     }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Features extracted in " << elapsed.count() << "s\n";
 
-    return samples;
+    if (key != 0 && featureCache.store(key, dataset)) {
+        std::cout << "Feature cache stored " << featureCache.entryPath(key) << "\n";
+    }
+    return dataset;
 }
 
-void DigitOCR::trainModel(const std::string& trainingDataPath, AlgorithmType algo) {
-    MNISTLoader loader;
+std::vector<TrainingSample> DigitOCR::loadMNISTSamples(
+    const std::string& imagePath,
+    const std::string& labelPath,
+    AlgorithmType algo) const {
+    return loadMNISTFeatures(imagePath, labelPath, algo).toSamples();
+}
 
+void DigitOCR::trainModel(const std::string& trainingDataPath, AlgorithmType algo) {
     const std::string trainImages = trainingDataPath + "/train-images-idx3-ubyte";
     const std::string trainLabels = trainingDataPath + "/train-labels-idx1-ubyte";
 
-    if (!loader.loadTrainingData(trainImages, trainLabels)) {
+    FeatureDataset trainingSet = loadMNISTFeatures(trainImages, trainLabels, algo);
+    if (trainingSet.empty()) {
         std::cerr << "Failed to load training data!\n";
         return;
     }
 
-    const auto& mnistData = loader.getTrainingData();
-    std::cout << "Extracting features from " << mnistData.size() << " training images...\n";
-
     if (algo == AlgorithmType::KNN) {
-        knnTrainingSamples = loadMNISTSamples(mnistData, algo);
+        knnTrainingSet = std::move(trainingSet);
 
         std::cout << "Training KNN classifier...\n";
-        classifier.train(&knnTrainingSamples);
+        const auto start = std::chrono::steady_clock::now();
+        classifier.train(knnTrainingSet);
         knnTrained = true;
 
-        std::cout << "KNN training completed with " << knnTrainingSamples.size() << " samples\n";
+        const KNNSearchMode mode = classifier.getSearchMode();
+        if (classifier.hasIndex()) {
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            const char* indexName = mode == KNNSearchMode::PQ ? "PQ codes"
+                : mode == KNNSearchMode::Quantized ? "Integer features"
+                : mode == KNNSearchMode::Binary ? "Binary features"
+                : mode == KNNSearchMode::Pivot ? "Pivot table"
+                : mode == KNNSearchMode::Cascade ? "Cascade coarse features"
+                : mode == KNNSearchMode::IVF ? "IVF index" : "HNSW index";
+            std::cout << indexName << " built in " << elapsed.count() << "s\n";
+
+            if (mode == KNNSearchMode::Pivot || mode == KNNSearchMode::Cascade || mode == KNNSearchMode::IVF) {
+                std::cout << "Index size: " << classifier.compressedBytes() / 1024 << " KB\n";
+            } else if (mode != KNNSearchMode::HNSW) {
+                const std::size_t floatBytes = classifier.size() * knnTrainingSet.cols() * sizeof(float);
+                std::cout << "Compressed reference set: " << classifier.compressedBytes() / 1024 << " KB (float features: "
+                          << floatBytes / 1024 << " KB)\n";
+            }
+        }
+
+        if (classifier.projectedDim() > 0) {
+            std::cout << "PCA: " << knnTrainingSet.cols() << " -> " << classifier.projectedDim()
+                      << " dimensions, " << classifier.explainedVariance() * 100.0 << "% of the variance kept\n";
+        }
+
+        std::cout << "KNN training completed with " << knnTrainingSet.size() << " samples\n";
         return;
     }
 
-    std::vector<TrainingSample> neuralSamples = loadMNISTSamples(mnistData, algo);
-
-    neuralSamples.resize(1000);
+    std::vector<TrainingSample> neuralSamples = trainingSet.toSamples(0, 1000);
 
     std::cout << "Training Neural Network...\n";
     nnClassifier.train(neuralSamples, 20, 0.075f);
@@ -65,20 +146,67 @@ std::string DigitOCR::recognize(const ImageMatrix& image, AlgorithmType algo) {
     const auto digits = preprocessor.extractDigits(image);
     std::string result;
 
-    for (const auto& digit : digits) {
-        const auto features = (algo == AlgorithmType::KNN)
-            ? featureExtractor.extractKNNFeatures(digit)
-            : featureExtractor.extractNeuralNetworkFeatures(digit);
+    if (algo == AlgorithmType::KNN) {
+        // all digits of the image share one pass over the training set
+        std::vector<std::vector<float>> queries;
+        queries.reserve(digits.size());
+        for (const auto& digit : digits) {
+            queries.push_back(featureExtractor.extractKNNFeatures(digit));
+        }
+
+        for (const int prediction : classifier.predictBatch(queries)) {
+            result += std::to_string(prediction);
+        }
+        return result;
+    }
 
-        const int prediction = (algo == AlgorithmType::KNN)
-            ? classifier.predict(features)
-            : nnClassifier.predict_digit(features);
+    for (const auto& digit : digits) {
+        const auto features = featureExtractor.extractNeuralNetworkFeatures(digit);
+        const int prediction = nnClassifier.predict_digit(features);
         result += std::to_string(prediction);
     }
 
     return result;
 }
 
+bool DigitOCR::learnDigits(const ImageMatrix& image, const std::string& labels) {
+    if (!isTrained(AlgorithmType::KNN)) {
+        std::cerr << "Error: KNN model is not trained yet!\n";
+        return false;
+    }
+
+    const auto digits = preprocessor.extractDigits(image);
+    if (digits.size() != labels.size()) {
+        std::cerr << "Found " << digits.size() << " digits but got " << labels.size() << " labels\n";
+        return false;
+    }
+
+    std::vector<TrainingSample> learned;
+    bool accepted = true;
+    for (std::size_t i = 0; i < digits.size() && accepted; i++) {
+        if (labels[i] < '0' || labels[i] > '9') {
+            continue;
+        }
+
+        TrainingSample sample{featureExtractor.extractKNNFeatures(digits[i]), labels[i] - '0'};
+        accepted = classifier.appendSample(sample);
+        if (accepted) {
+            learned.push_back(std::move(sample));
+        }
+    }
+
+    // kept for retraining when the search mode changes; a mapped model has no training set to extend
+    if (!knnTrainingSet.empty()) {
+        knnTrainingSet.append(learned);
+    }
+    if (!accepted) {
+        return false;
+    }
+
+    std::cout << "Learned " << learned.size() << " digits (" << classifier.appendedCount() << " since the last save)\n";
+    return true;
+}
+
 void DigitOCR::loadModel(const std::string& filename, AlgorithmType algo) {
     if (algo == AlgorithmType::NN_SCALAR_AUTODIFF) {
         if (!nnClassifier.load_model(filename)) {
@@ -91,32 +219,34 @@ void DigitOCR::loadModel(const std::string& filename, AlgorithmType algo) {
 
     std::cout << "Loading model from " << filename << "\n";
 
-    std::ifstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
-        std::cerr << "Cannot load model from " << filename << "\n";
+    if (KNNClassifier::isCompressedModel(filename)) {
+        knnTrainingSet.clear();
+        if (classifier.loadCompressedModel(filename)) {
+            knnTrained = true;
+            std::cout << "Compressed model loaded from " << filename << " with " << classifier.size() << " samples\n";
+        }
         return;
     }
 
-    knnTrainingSamples.clear();
-    size_t sampleCount = 0;
-    file.read(reinterpret_cast<char*>(&sampleCount), sizeof(sampleCount));
-
-    for (size_t i = 0; i < sampleCount; i++) {
-        TrainingSample sample;
-
-        file.read(reinterpret_cast<char*>(&sample.label), sizeof(sample.label));
-
-        size_t featuresCount = 0;
-        file.read(reinterpret_cast<char*>(&featuresCount), sizeof(featuresCount));
-        sample.features.resize(featuresCount);
-        file.read(reinterpret_cast<char*>(sample.features.data()), featuresCount * sizeof(float));
-
-        knnTrainingSamples.push_back(std::move(sample));
+    if (KNNClassifier::isModelFile(filename)) {
+        // the feature matrix is used straight from the mapped file, no per-sample copies
+        knnTrainingSet.clear();
+        if (!classifier.loadModel(filename)) {
+            return;
+        }
+        knnTrained = true;
+        std::cout << "Model mapped from " << filename << " with " << classifier.size() << " samples\n";
+    } else if (!loadLegacyModel(filename)) {
+        return;
     }
 
-    classifier.train(&knnTrainingSamples);
-    knnTrained = true;
-    std::cout << "Model loaded from " << filename << " with " << sampleCount << " samples\n";
+    // a saved graph next to the model avoids rebuilding it at startup
+    const std::string indexPath = filename + ".hnsw";
+    if (std::filesystem::exists(indexPath) && classifier.loadIndex(indexPath)) {
+        std::cout << "HNSW index loaded from " << indexPath << "\n";
+    } else {
+        classifier.buildIndex();
+    }
 }
 
 float DigitOCR::evaluateOnTestData(const std::string& testDataPath, AlgorithmType algo) {
@@ -125,39 +255,110 @@ float DigitOCR::evaluateOnTestData(const std::string& testDataPath, AlgorithmTyp
         return 0.0f;
     }
 
-    MNISTLoader loader;
     const std::string testImages = testDataPath + "/t10k-images-idx3-ubyte";
     const std::string testLabels = testDataPath + "/t10k-labels-idx1-ubyte";
 
-    if (!loader.loadTestData(testImages, testLabels)) {
+    const FeatureDataset testSet = loadMNISTFeatures(testImages, testLabels, algo);
+    if (testSet.empty()) {
         std::cerr << "Failed to load test data!\n";
         return 0.0f;
     }
 
-    const auto& testData = loader.getTestData();
-    std::cout << "Evaluating on " << testData.size() << " test samples...\n";
+    std::cout << "Evaluating on " << testSet.size() << " test samples...\n";
 
-    auto testSamples = loadMNISTSamples(testData, algo);
     if (algo == AlgorithmType::KNN) {
-        const float accuracy = classifier.evaluate(testSamples, 500, true);
+        const float accuracy = classifier.evaluate(testSet, 0, true);
         std::cout << "KNN Test Accuracy: " << accuracy * 100 << "%\n";
         return accuracy;
     }
 
+    auto testSamples = testSet.toSamples();
     const float accuracy = nnClassifier.evaluate(testSamples);
     std::cout << "Neural Network Test Accuracy: " << accuracy * 100 << "%\n";
     return accuracy;
 }
 
+float DigitOCR::evaluateStream(
+    const std::string& imagePath,
+    const std::string& labelPath,
+    AlgorithmType algo,
+    std::size_t chunkImages) {
+    if (!isTrained(algo)) {
+        std::cerr << "Error: Model is not trained yet!\n";
+        return 0.0f;
+    }
+
+    MNISTStreamReader reader(chunkImages);
+    if (!reader.open(imagePath, labelPath)) {
+        std::cerr << "Failed to open test data!\n";
+        return 0.0f;
+    }
+
+    std::cout << "Streaming " << reader.size() << " test samples in chunks of " << reader.chunkSize() << "...\n";
+
+    MNISTFeatureStream stream(reader, featureExtractor, featureKind(algo));
+    FeatureDataset chunk;
+    std::size_t correct = 0;
+    std::size_t evaluated = 0;
+    while (stream.next(chunk)) {
+        if (algo == AlgorithmType::KNN) {
+            correct += classifier.countCorrect(chunk);
+        } else {
+            correct += nnClassifier.countCorrect(chunk.toSamples());
+        }
+        evaluated += chunk.size();
+    }
+
+    if (reader.failed() || evaluated == 0) {
+        std::cerr << "Failed to read test data!\n";
+        return 0.0f;
+    }
+
+    const float accuracy = static_cast<float>(correct) / static_cast<float>(evaluated);
+    std::cout << (algo == AlgorithmType::KNN ? "KNN" : "Neural Network") << " Test Accuracy: " << accuracy * 100 << "%\n";
+    return accuracy;
+}
+
 float DigitOCR::evaluateOnTrainingData() {
-    if (knnTrainingSamples.empty()) {
+    if (knnTrainingSet.empty()) {
         return 0.0f;
     }
 
-    return classifier.evaluate(knnTrainingSamples);
+    return classifier.evaluate(knnTrainingSet);
 }
 
-void DigitOCR::confusionMatrix(const std::vector<MNISTImage>&, AlgorithmType) {}
+void DigitOCR::confusionMatrix(const MNISTDataset&, AlgorithmType) {}
+
+bool DigitOCR::loadLegacyModel(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Cannot load model from " << filename << "\n";
+        return false;
+    }
+
+    std::vector<TrainingSample> samples;
+    size_t sampleCount = 0;
+    file.read(reinterpret_cast<char*>(&sampleCount), sizeof(sampleCount));
+
+    for (size_t i = 0; i < sampleCount; i++) {
+        TrainingSample sample;
+
+        file.read(reinterpret_cast<char*>(&sample.label), sizeof(sample.label));
+
+        size_t featuresCount = 0;
+        file.read(reinterpret_cast<char*>(&featuresCount), sizeof(featuresCount));
+        sample.features.resize(featuresCount);
+        file.read(reinterpret_cast<char*>(sample.features.data()), featuresCount * sizeof(float));
+
+        samples.push_back(std::move(sample));
+    }
+
+    knnTrainingSet = FeatureDataset::fromSamples(samples);
+    classifier.train(knnTrainingSet, false);
+    knnTrained = true;
+    std::cout << "Model loaded from " << filename << " with " << sampleCount << " samples\n";
+    return true;
+}
 
 void DigitOCR::saveModel(const std::string& filename, AlgorithmType algo) {
     if (algo == AlgorithmType::NN_SCALAR_AUTODIFF) {
@@ -165,23 +366,34 @@ void DigitOCR::saveModel(const std::string& filename, AlgorithmType algo) {
         return;
     }
 
-    std::ofstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
-        std::cerr << "Cannot save model to " << filename << "\n";
-        return;
+    // loadModel() picks up any graph next to the model, so one from an earlier save must not outlive it
+    const std::string indexPath = filename + ".hnsw";
+    std::error_code removeError;
+    std::filesystem::remove(indexPath, removeError);
+
+    // learned digits become part of the saved reference set
+    // (Quantized/Binary models are written from knnTrainingSet, which has them too)
+    if (classifier.hasFeatures()) {
+        classifier.mergeAppendedSamples();
     }
 
-    const size_t sampleCount = knnTrainingSamples.size();
-    file.write(reinterpret_cast<const char*>(&sampleCount), sizeof(sampleCount));
+    // PQ mode keeps only the codes, the float features are not written
+    if (classifier.getSearchMode() == KNNSearchMode::PQ && classifier.hasIndex()) {
+        classifier.saveCompressedModel(filename);
+        return;
+    }
 
-    for (const auto& sample : knnTrainingSamples) {
-        file.write(reinterpret_cast<const char*>(&sample.label), sizeof(sample.label));
+    if (classifier.hasFeatures()) {
+        classifier.saveModel(filename);
+    } else {
+        // Quantized and Binary modes keep no float matrix: write one from the training samples
+        KNNClassifier floatModel(classifier.getK());
+        floatModel.train(knnTrainingSet, false);
+        floatModel.saveModel(filename);
+    }
 
-        const size_t featureCount = sample.features.size();
-        file.write(reinterpret_cast<const char*>(&featureCount), sizeof(featureCount));
-        file.write(
-            reinterpret_cast<const char*>(sample.features.data()),
-            static_cast<std::streamsize>(featureCount * sizeof(float)));
+    if (classifier.getSearchMode() == KNNSearchMode::HNSW && classifier.hasIndex()) {
+        classifier.saveIndex(indexPath);
     }
 }
 
@@ -192,3 +404,159 @@ bool DigitOCR::isTrained(AlgorithmType algo) const {
 
     return neuralNetworkTrained;
 }
+
+void DigitOCR::setKNNSearchMode(KNNSearchMode mode) {
+    // compact stores replace the float features, switching in or out of them re-encodes the samples
+    const KNNSearchMode previous = classifier.getSearchMode();
+    const bool storageChanged = mode != previous
+        && (!KNNClassifier::storesFloatFeatures(mode) || !KNNClassifier::storesFloatFeatures(previous));
+    classifier.setSearchMode(mode);
+
+    if (!knnTrained) {
+        return;
+    }
+
+    if (storageChanged && !knnTrainingSet.empty()) {
+        classifier.train(knnTrainingSet);
+    } else {
+        classifier.buildIndex();
+    }
+}
+
+void DigitOCR::setKNNPCAComponents(int components) {
+    PCAParams params = classifier.getPCAParams();
+    params.components = std::max(0, components);
+    classifier.setPCAParams(params);
+
+    if (knnTrained && !knnTrainingSet.empty()) {
+        classifier.train(knnTrainingSet);
+    }
+}
+
+void DigitOCR::benchmarkKNNPCA(const std::string& testDataPath, std::size_t maxQueries) {
+    if (!isTrained(AlgorithmType::KNN) || knnTrainingSet.empty()) {
+        std::cerr << "Error: KNN training samples are not available!\n";
+        return;
+    }
+
+    const std::string testImages = testDataPath + "/t10k-images-idx3-ubyte";
+    const std::string testLabels = testDataPath + "/t10k-labels-idx1-ubyte";
+
+    auto queries = loadMNISTSamples(testImages, testLabels, AlgorithmType::KNN);
+    if (queries.empty()) {
+        std::cerr << "Failed to load test data!\n";
+        return;
+    }
+
+    if (maxQueries > 0 && queries.size() > maxQueries) {
+        queries.resize(maxQueries);
+    }
+
+    const auto reports = KNNBenchmark::pcaDimensions(knnTrainingSet.toSamples(), queries, {30, 50, 80, 120}, classifier.getK());
+    KNNBenchmark::printReport("PCA dimension vs accuracy", reports);
+    KNNBenchmark::logReport("pca_dimensions", reports);
+}
+
+void DigitOCR::benchmarkKNNSearch(const std::string& testDataPath, std::size_t maxQueries) {
+    if (!isTrained(AlgorithmType::KNN)) {
+        std::cerr << "Error: KNN model is not trained yet!\n";
+        return;
+    }
+
+    const std::string testImages = testDataPath + "/t10k-images-idx3-ubyte";
+    const std::string testLabels = testDataPath + "/t10k-labels-idx1-ubyte";
+
+    auto queries = loadMNISTSamples(testImages, testLabels, AlgorithmType::KNN);
+    if (queries.empty()) {
+        std::cerr << "Failed to load test data!\n";
+        return;
+    }
+
+    if (maxQueries > 0 && queries.size() > maxQueries) {
+        queries.resize(maxQueries);
+    }
+
+    const KNNSearchMode mode = classifier.getSearchMode();
+    if (!KNNClassifier::storesFloatFeatures(mode)) {
+        const bool binary = mode == KNNSearchMode::Binary;
+        const auto reports = KNNBenchmark::compactVsFloat(classifier, knnTrainingSet.toSamples(), queries);
+        KNNBenchmark::printReport(binary ? "Binary vs float features" : "Integer vs float features", reports);
+        KNNBenchmark::logReport(binary ? "binary" : "quantized", reports);
+        return;
+    }
+
+    if (mode == KNNSearchMode::Pivot) {
+        const auto reports = KNNBenchmark::pivotPruning(classifier, queries, {8, 16, 32, 64});
+        KNNBenchmark::printReport("Pivot pruning (exact)", reports);
+        KNNBenchmark::logReport("pivot_pruning", reports);
+        return;
+    }
+
+    if (mode == KNNSearchMode::IVF) {
+        const auto reports = KNNBenchmark::ivfRecallVsProbes(classifier, queries, {1, 2, 4, 8, 16, 32});
+        KNNBenchmark::printReport("IVF recall vs nprobe", reports);
+        KNNBenchmark::logReport("ivf_nprobe", reports);
+        return;
+    }
+
+    if (mode == KNNSearchMode::Cascade) {
+        const auto reports = KNNBenchmark::cascadeRecallVsShortlist(classifier, queries, {32, 64, 128, 256, 512, 1024});
+        KNNBenchmark::printReport("Cascade recall vs shortlist", reports);
+        KNNBenchmark::logReport("cascade_shortlist", reports);
+        return;
+    }
+
+    if (classifier.getSearchMode() == KNNSearchMode::PQ) {
+        const auto reports = KNNBenchmark::pqRecallVsRerank(classifier, queries, {0, 16, 64, 256});
+        KNNBenchmark::printReport("PQ recall vs re-rank depth", reports);
+        KNNBenchmark::logReport("pq_recall", reports);
+        return;
+    }
+
+    const auto reports = KNNBenchmark::hnswRecallVsLatency(classifier, queries, {16, 32, 64, 128, 256});
+    KNNBenchmark::printReport("HNSW recall vs latency", reports);
+    KNNBenchmark::logReport("hnsw_recall", reports);
+}
+
+void DigitOCR::selectKNNPrototypes(const std::string& testDataPath) {
+    if (!isTrained(AlgorithmType::KNN) || knnTrainingSet.empty()) {
+        std::cerr << "Error: KNN training samples are not available!\n";
+        return;
+    }
+
+    const std::string testImages = testDataPath + "/t10k-images-idx3-ubyte";
+    const std::string testLabels = testDataPath + "/t10k-labels-idx1-ubyte";
+
+    const FeatureDataset testSamples = loadMNISTFeatures(testImages, testLabels, AlgorithmType::KNN);
+    if (testSamples.empty()) {
+        std::cerr << "Failed to load test data!\n";
+        return;
+    }
+
+    // accuracy and microseconds per query on the test set
+    auto measure = [&]() {
+        const auto start = std::chrono::steady_clock::now();
+        const float accuracy = classifier.evaluate(testSamples, 0, true);
+        const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        return std::make_pair(accuracy, elapsed.count() / static_cast<double>(testSamples.size()));
+    };
+
+    std::cout << "Evaluating the full reference set (" << knnTrainingSet.size() << " samples)...\n";
+    const auto before = measure();
+
+    PrototypeSelectionStats stats;
+    const std::vector<TrainingSample> samples = knnTrainingSet.toSamples();
+    const auto kept = classifier.trainPrototypes(&samples, {}, &stats);
+    knnTrainingSet = knnTrainingSet.subset(kept);
+
+    std::cout << "Prototype selection: " << stats.original << " -> " << stats.edited << " after editing -> "
+              << stats.condensed << " after condensing (" << stats.condensePasses << " passes, "
+              << stats.seconds << "s)\n";
+
+    std::cout << "Evaluating the prototypes...\n";
+    const auto after = measure();
+
+    std::cout << "Accuracy: " << before.first * 100.0f << "% -> " << after.first * 100.0f << "% ("
+              << (after.first - before.first) * 100.0f << " points)\n";
+    std::cout << "Latency: " << before.second << " -> " << after.second << " us/query\n";
+}
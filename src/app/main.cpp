@@ -1,6 +1,31 @@
 #include "app/cli.h"
+#include "baselines/knn/sharded_knn.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+    // shard worker: ocr_engine --knn-shard <model> <socket> [k] [threads]
+    if (argc >= 2 && std::string(argv[1]) == "--knn-shard") {
+        if (argc < 4) {
+            std::cerr << "Usage: " << argv[0] << " --knn-shard <model> <socket> [k] [threads]\n";
+            return 1;
+        }
+
+        KNNClassifier classifier(argc > 4 ? std::atoi(argv[4]) : 3);
+        if (!classifier.loadModel(argv[2])) {
+            return 1;
+        }
+
+        KNNShardServer server(classifier, argc > 5 ? static_cast<unsigned int>(std::atoi(argv[5])) : 0);
+        if (!server.listen(argv[3])) {
+            return 1;
+        }
+        std::cout << "Serving " << classifier.size() << " samples on " << argv[3] << "\n";
+        return server.serve() ? 0 : 1;
+    }
 
-int main() {
     CLI cli;
     cli.run();
     return 0;
@@ -4,6 +4,7 @@
 #include "baselines/nn_mlp_fast/neural_network_fast.h"
 #include "experiments/training_logger.h"
 
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <sstream>
@@ -22,12 +23,21 @@ int main() {
 
     FeatureExtractor fe;
 
-    std::vector<TrainingSample> trainSamples;
-    std::vector<TrainingSample> testSamples;
-
     const auto& trainData = loader.getTrainingData();
     const auto& testData = loader.getTestData();
 
+    // pixel features of the first limit images, scanned in order from the contiguous image buffer
+    auto extractPixels = [&fe](const MNISTDataset& data, std::size_t limit) {
+        const std::size_t count = std::min(limit, data.size());
+        FeatureDataset dataset(count, static_cast<std::size_t>(data.imageWidth()) * data.imageHeight());
+        for (std::size_t i = 0; i < count; i++) {
+            const std::vector<float> features = fe.extractNeuralNetworkFeatures(data.image(i).view());
+            std::copy(features.begin(), features.end(), dataset.features.row(i));
+            dataset.labels[i] = data.label(i);
+        }
+        return dataset;
+    };
+
     std::vector<RunConfig> runs = {
         {"fastnn_t5000_v500_lr0.02_b64_e10", 5000, 500, 0.02f, 64, 10},
         {"fastnn_t5000_v500_lr0.01_b64_e10", 5000, 500, 0.01f, 64, 10},
@@ -59,22 +69,8 @@ int main() {
         const int batchSize = run.batchSize;
         const int epochs = run.epochs;
         const std::string runName = run.runName;
-        trainSamples.reserve(trainLimit);
-        testSamples.reserve(testLimit);
-
-        for (size_t i = 0; i < trainLimit; i++) {
-            TrainingSample s;
-            s.features = fe.extractNeuralNetworkFeatures(trainData[i].image);
-            s.label = trainData[i].label;
-            trainSamples.push_back(std::move(s));
-        }
-
-        for (size_t i = 0; i < testLimit; i++) {
-            TrainingSample s;
-            s.features = fe.extractNeuralNetworkFeatures(testData[i].image);
-            s.label = testData[i].label;
-            testSamples.push_back(std::move(s));
-        }
+        const FeatureDataset trainSamples = extractPixels(trainData, trainLimit);
+        const FeatureDataset testSamples = extractPixels(testData, testLimit);
 
 
 
@@ -0,0 +1,72 @@
+#include "baselines/common/feature_dataset.h"
+
+#include <algorithm>
+#include <cstring>
+
+FeatureDataset::FeatureDataset() {}
+
+FeatureDataset::FeatureDataset(std::size_t rows, std::size_t cols) : features(rows, cols), labels(rows, 0) {}
+
+FeatureDataset FeatureDataset::fromSamples(const std::vector<TrainingSample>& samples) {
+    std::size_t cols = 0;
+    for (const auto& sample : samples) {
+        cols = std::max(cols, sample.features.size());
+    }
+
+    FeatureDataset dataset(samples.size(), cols);
+    for (std::size_t i = 0; i < samples.size(); i++) {
+        dataset.features.setRow(i, samples[i].features.data(), samples[i].features.size());
+        dataset.labels[i] = samples[i].label;
+    }
+    return dataset;
+}
+
+std::vector<TrainingSample> FeatureDataset::toSamples(std::size_t first, std::size_t count) const {
+    const std::size_t begin = std::min(first, size());
+    const std::size_t end = begin + std::min(count, size() - begin);
+
+    std::vector<TrainingSample> samples;
+    samples.reserve(end - begin);
+    for (std::size_t i = begin; i < end; i++) {
+        const float* row = features.row(i);
+        samples.push_back({std::vector<float>(row, row + cols()), labels[i]});
+    }
+    return samples;
+}
+
+FeatureDataset FeatureDataset::subset(const std::vector<std::size_t>& indices) const {
+    FeatureDataset result(indices.size(), cols());
+    for (std::size_t i = 0; i < indices.size(); i++) {
+        std::memcpy(result.features.row(i), features.row(indices[i]), features.stride() * sizeof(float));
+        result.labels[i] = labels[indices[i]];
+    }
+    return result;
+}
+
+void FeatureDataset::append(const std::vector<TrainingSample>& samples) {
+    if (samples.empty()) {
+        return;
+    }
+
+    if (empty()) {
+        *this = fromSamples(samples);
+        return;
+    }
+
+    const std::size_t oldRows = size();
+    FeatureMatrix grown(oldRows + samples.size(), cols());
+    // padded rows are contiguous, the old matrix moves over in one copy
+    std::memcpy(grown.row(0), features.row(0), oldRows * features.stride() * sizeof(float));
+    for (std::size_t i = 0; i < samples.size(); i++) {
+        grown.setRow(oldRows + i, samples[i].features.data(), samples[i].features.size());
+        labels.push_back(samples[i].label);
+    }
+    features = std::move(grown);
+    storage.reset();
+}
+
+void FeatureDataset::clear() {
+    features = FeatureMatrix();
+    labels.clear();
+    storage.reset();
+}
@@ -0,0 +1,104 @@
+#include "baselines/common/feature_matrix.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+void FeatureMatrix::AlignedDeleter::operator()(float* ptr) const {
+    std::free(ptr);
+}
+
+std::size_t FeatureMatrix::paddedSize(std::size_t cols) {
+    return (cols + rowPadding - 1) / rowPadding * rowPadding;
+}
+
+FeatureMatrix::FeatureMatrix() {}
+
+FeatureMatrix::FeatureMatrix(std::size_t rows, std::size_t cols) : FeatureMatrix(uninitialized(rows, cols)) {
+    if (rowData) {
+        std::memset(rowData, 0, rowCount * rowStride * sizeof(float));
+    }
+}
+
+FeatureMatrix FeatureMatrix::uninitialized(std::size_t rows, std::size_t cols) {
+    FeatureMatrix matrix;
+    matrix.rowCount = rows;
+    matrix.colCount = cols;
+    matrix.rowStride = paddedSize(cols);
+
+    const std::size_t bytes = rows * matrix.rowStride * sizeof(float);
+    if (bytes == 0) {
+        return matrix;
+    }
+
+    // stride is a multiple of the alignment, so bytes is too (aligned_alloc requirement)
+    float* raw = static_cast<float*>(std::aligned_alloc(alignment, bytes));
+    if (!raw) {
+        throw std::bad_alloc();
+    }
+
+    matrix.values.reset(raw);
+    matrix.rowData = raw;
+    return matrix;
+}
+
+FeatureMatrix::FeatureMatrix(const FeatureMatrix& other) : FeatureMatrix(other.rowCount, other.colCount) {
+    if (rowData) {
+        std::memcpy(rowData, other.rowData, rowCount * rowStride * sizeof(float));
+    }
+}
+
+FeatureMatrix FeatureMatrix::view(const float* data, std::size_t rows, std::size_t cols) {
+    FeatureMatrix matrix;
+    matrix.rowCount = rows;
+    matrix.colCount = cols;
+    matrix.rowStride = paddedSize(cols);
+    // row() hands out float* for owning matrices; views are only read through it
+    matrix.rowData = const_cast<float*>(data);
+    return matrix;
+}
+
+FeatureMatrix& FeatureMatrix::operator=(const FeatureMatrix& other) {
+    if (this != &other) {
+        FeatureMatrix copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+FeatureMatrix::FeatureMatrix(FeatureMatrix&& other) noexcept
+    : rowCount(other.rowCount),
+      colCount(other.colCount),
+      rowStride(other.rowStride),
+      values(std::move(other.values)),
+      rowData(other.rowData) {
+    other.rowCount = 0;
+    other.colCount = 0;
+    other.rowStride = 0;
+    other.rowData = nullptr;
+}
+
+FeatureMatrix& FeatureMatrix::operator=(FeatureMatrix&& other) noexcept {
+    if (this != &other) {
+        rowCount = other.rowCount;
+        colCount = other.colCount;
+        rowStride = other.rowStride;
+        values = std::move(other.values);
+        rowData = other.rowData;
+
+        other.rowCount = 0;
+        other.colCount = 0;
+        other.rowStride = 0;
+        other.rowData = nullptr;
+    }
+    return *this;
+}
+
+void FeatureMatrix::setRow(std::size_t r, const float* source, std::size_t count) {
+    float* dst = row(r);
+    const std::size_t n = std::min(count, colCount);
+
+    std::copy(source, source + n, dst);
+    std::fill(dst + n, dst + rowStride, 0.0f);
+}
@@ -0,0 +1,70 @@
+#include "baselines/knn/binary_store.h"
+#include "baselines/knn/distance_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// rows scored per kernel call, the distances stay on the stack
+constexpr std::size_t scanBlockRows = 256;
+
+} // namespace
+
+BinaryFeatureStore::BinaryFeatureStore() {}
+
+std::size_t BinaryFeatureStore::wordsFor(const KNNFeatureLayout& layout) {
+    return (static_cast<std::size_t>(std::max(0, layout.pixelCount())) + 63) / 64;
+}
+
+bool BinaryFeatureStore::reset(const KNNFeatureLayout& layout, std::size_t rows, int pixelThreshold) {
+    clear();
+    if (layout.pixelCount() <= 0) {
+        return false;
+    }
+
+    featureLayout = layout;
+    threshold = pixelThreshold;
+    words = wordsFor(layout);
+    rowCount = rows;
+    bits.assign(rowCount * words, 0);
+    return true;
+}
+
+void BinaryFeatureStore::clear() {
+    rowCount = 0;
+    bits.clear();
+    bits.shrink_to_fit();
+}
+
+void BinaryFeatureStore::setRow(std::size_t r, const float* features, std::size_t count) {
+    pack(features, count, bits.data() + r * words);
+}
+
+void BinaryFeatureStore::pack(const float* features, std::size_t count, std::uint64_t* out) const {
+    std::fill(out, out + words, 0);
+
+    const std::size_t pixels = std::min<std::size_t>(count, featureLayout.pixelCount());
+    for (std::size_t i = 0; i < pixels; i++) {
+        // features hold pixel / 255, compare on the original byte value
+        if (std::lround(features[i] * 255.0f) > threshold) {
+            out[i / 64] |= std::uint64_t{1} << (i % 64);
+        }
+    }
+}
+
+void BinaryFeatureStore::search(const std::uint64_t* query, NearestList& best) const {
+    best.clear();
+
+    Distance distances[scanBlockRows];
+    for (std::size_t start = 0; start < rowCount; start += scanBlockRows) {
+        const std::size_t count = std::min(scanBlockRows, rowCount - start);
+        hammingDistanceRows(query, bits.data() + start * words, words, count, distances);
+
+        for (std::size_t r = 0; r < count; r++) {
+            if (distances[r] < best.bound()) {
+                best.push(static_cast<int>(start + r), distances[r]);
+            }
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#include "baselines/knn/cascade_index.h"
+#include "baselines/knn/distance_kernels.h"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+CascadeIndex::CascadeIndex() {}
+
+void CascadeIndex::clear() {
+    coarseFeatures = FeatureMatrix();
+    coarseOffset = 0;
+}
+
+bool CascadeIndex::build(const FeatureMatrix& data, const KNNFeatureLayout& layout, const CascadeParams& buildParams) {
+    clear();
+    params = buildParams;
+
+    if (!layout.valid() || data.cols() != static_cast<std::size_t>(layout.dimensions())) {
+        std::cerr << "Feature layout does not match the training features, cascade index not built\n";
+        return false;
+    }
+
+    // zoning and projection features follow the pixels
+    coarseOffset = layout.pixelCount();
+    const std::size_t coarseCols = data.cols() - coarseOffset;
+
+    coarseFeatures = FeatureMatrix(data.rows(), coarseCols);
+    for (std::size_t i = 0; i < data.rows(); i++) {
+        coarseFeatures.setRow(i, data.row(i) + coarseOffset, coarseCols);
+    }
+    return true;
+}
+
+void CascadeIndex::search(
+    const FeatureMatrix& data,
+    const float* query,
+    KNearestList& result,
+    CascadeSearchScratch& scratch,
+    KNNSearchStats* stats) const {
+
+    result.clear();
+    const std::size_t rows = coarseFeatures.rows();
+    if (rows == 0) {
+        return;
+    }
+
+    FeatureMatrix& coarseQuery = scratch.coarseQuery;
+    if (coarseQuery.cols() != coarseFeatures.cols()) {
+        coarseQuery = FeatureMatrix(1, coarseFeatures.cols());
+    }
+    coarseQuery.setRow(0, query + coarseOffset, coarseFeatures.cols());
+
+    const std::size_t coarseStride = coarseFeatures.stride();
+    std::vector<float>& coarse = scratch.coarse;
+    coarse.resize(rows);
+    for (std::size_t i = 0; i < rows; i++) {
+        coarse[i] = squaredL2Distance(coarseQuery.row(0), coarseFeatures.row(i), coarseStride);
+    }
+
+    const std::size_t shortlist = std::clamp<std::size_t>(
+        static_cast<std::size_t>(std::max(params.shortlist, result.capacity())), 1, rows);
+    std::vector<int>& order = scratch.order;
+    order.resize(rows);
+    std::iota(order.begin(), order.end(), 0);
+
+    auto closer = [&coarse](int a, int b) { return coarse[a] < coarse[b] || (coarse[a] == coarse[b] && a < b); };
+    std::nth_element(order.begin(), order.begin() + (shortlist - 1), order.end(), closer);
+    // nearest first tightens the bound early, so the bounded kernel stops sooner on the rest
+    std::sort(order.begin(), order.begin() + shortlist, closer);
+
+    const std::size_t stride = data.stride();
+    for (std::size_t s = 0; s < shortlist; s++) {
+        const int row = order[s];
+        const float bound = result.bound();
+        const float distance = squaredL2DistanceBounded(query, data.row(row), stride, bound);
+        if (distance < bound) {
+            result.push(row, distance);
+        }
+    }
+
+    if (stats) {
+        stats->candidates += rows;
+        stats->fullDistances += shortlist;
+    }
+}
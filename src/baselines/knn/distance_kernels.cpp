@@ -0,0 +1,538 @@
+#include "baselines/knn/distance_kernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define KNN_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using SquaredL2Fn = float (*)(const float*, const float*, std::size_t);
+using SquaredL2BoundedFn = float (*)(const float*, const float*, std::size_t, float);
+using DotFn = float (*)(const float*, const float*, std::size_t);
+using DotRowsFn = void (*)(const float*, const float*, std::size_t, std::size_t, std::size_t, float*);
+using SquaredU8Fn = std::uint32_t (*)(const std::uint8_t*, const std::uint8_t*, std::size_t);
+using SquaredI16Fn = std::uint64_t (*)(const std::int16_t*, const std::int16_t*, std::size_t);
+using HammingRowsFn = void (*)(const std::uint64_t*, const std::uint64_t*, std::size_t, std::size_t, std::uint32_t*);
+
+std::uint32_t squaredU8Scalar(const std::uint8_t* a, const std::uint8_t* b, std::size_t n) {
+    std::uint32_t distance = 0;
+
+    for (std::size_t i = 0; i < n; i++) {
+        const int diff = static_cast<int>(a[i]) - static_cast<int>(b[i]);
+        distance += static_cast<std::uint32_t>(diff * diff);
+    }
+
+    return distance;
+}
+
+std::uint64_t squaredI16Scalar(const std::int16_t* a, const std::int16_t* b, std::size_t n) {
+    std::uint64_t distance = 0;
+
+    for (std::size_t i = 0; i < n; i++) {
+        const std::int64_t diff = static_cast<std::int64_t>(a[i]) - b[i];
+        distance += static_cast<std::uint64_t>(diff * diff);
+    }
+
+    return distance;
+}
+
+// without the popcnt instruction __builtin_popcountll is a bit-twiddling sequence
+void hammingRowsScalar(
+    const std::uint64_t* query,
+    const std::uint64_t* rows,
+    std::size_t words,
+    std::size_t rowCount,
+    std::uint32_t* out) {
+
+    for (std::size_t r = 0; r < rowCount; r++, rows += words) {
+        std::uint32_t distance = 0;
+        for (std::size_t w = 0; w < words; w++) {
+            distance += static_cast<std::uint32_t>(__builtin_popcountll(query[w] ^ rows[w]));
+        }
+        out[r] = distance;
+    }
+}
+
+#ifndef KNN_X86_KERNELS
+
+float squaredL2BoundedScalar(const float* a, const float* b, std::size_t n, float bound) {
+    float distance = 0.0f;
+
+    for (std::size_t i = 0; i < n; i++) {
+        const float diff = a[i] - b[i];
+        distance += diff * diff;
+        if ((i & 63) == 63 && distance > bound) {
+            return distance;
+        }
+    }
+
+    return distance;
+}
+
+float dotScalar(const float* a, const float* b, std::size_t n) {
+    float sum = 0.0f;
+
+    for (std::size_t i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+
+    return sum;
+}
+
+void dotRowsScalar(
+    const float* query,
+    const float* rows,
+    std::size_t stride,
+    std::size_t rowCount,
+    std::size_t n,
+    float* out) {
+
+    for (std::size_t r = 0; r < rowCount; r++) {
+        out[r] = dotScalar(query, rows + r * stride, n);
+    }
+}
+
+#endif // !KNN_X86_KERNELS
+
+#ifdef KNN_X86_KERNELS
+
+float squaredL2Sse2(const float* a, const float* b, std::size_t n) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    std::size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        const __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        const __m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4));
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(d0, d0));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(d1, d1));
+    }
+
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, _mm_add_ps(acc0, acc1));
+    float distance = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+    for (; i < n; i++) {
+        const float diff = a[i] - b[i];
+        distance += diff * diff;
+    }
+
+    return distance;
+}
+
+float squaredL2BoundedSse2(const float* a, const float* b, std::size_t n, float bound) {
+    float distance = 0.0f;
+    std::size_t i = 0;
+
+    // check the bound once per 64 floats so the horizontal sum stays off the hot loop
+    for (; i + 64 <= n; i += 64) {
+        distance += squaredL2Sse2(a + i, b + i, 64);
+        if (distance > bound) {
+            return distance;
+        }
+    }
+
+    return distance + squaredL2Sse2(a + i, b + i, n - i);
+}
+
+float dotSse2(const float* a, const float* b, std::size_t n) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    std::size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, _mm_add_ps(acc0, acc1));
+    float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+
+    return sum;
+}
+
+void dotRowsSse2(
+    const float* query,
+    const float* rows,
+    std::size_t stride,
+    std::size_t rowCount,
+    std::size_t n,
+    float* out) {
+
+    for (std::size_t r = 0; r < rowCount; r++) {
+        out[r] = dotSse2(query, rows + r * stride, n);
+    }
+}
+
+// |a - b| per byte via two saturating subtractions, then widened to int16 so
+// pmaddwd squares and pair-sums it (pmaddubsw would need a signed operand)
+std::uint32_t squaredU8Sse2(const std::uint8_t* a, const std::uint8_t* b, std::size_t n) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    std::size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        const __m128i diff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+        const __m128i lo = _mm_unpacklo_epi8(diff, zero);
+        const __m128i hi = _mm_unpackhi_epi8(diff, zero);
+        acc = _mm_add_epi32(acc, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+    }
+
+    alignas(16) std::uint32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + squaredU8Scalar(a + i, b + i, n - i);
+}
+
+std::uint64_t squaredI16Sse2(const std::int16_t* a, const std::int16_t* b, std::size_t n) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128(); // two uint64 lanes
+    std::size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        const __m128i diff = _mm_sub_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        // pair sums are non-negative, widen them to 64 bits before they can overflow
+        const __m128i squares = _mm_madd_epi16(diff, diff);
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(squares, zero));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(squares, zero));
+    }
+
+    alignas(16) std::uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    return lanes[0] + lanes[1] + squaredI16Scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+inline float horizontalSumAvx2(__m256 v) {
+    const __m128 half = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    const __m128 quad = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    return _mm_cvtss_f32(_mm_add_ss(quad, _mm_shuffle_ps(quad, quad, 1)));
+}
+
+__attribute__((target("avx2,fma")))
+float dotAvx2(const float* a, const float* b, std::size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    std::size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+
+    float sum = horizontalSumAvx2(_mm256_add_ps(acc0, acc1));
+
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+
+    return sum;
+}
+
+// one row in the same order as a lane of the 4-row pass, so a row's dot product
+// does not depend on where it falls in the tile
+__attribute__((target("avx2,fma")))
+float dotRowAvx2(const float* query, const float* row, std::size_t n) {
+    __m256 acc = _mm256_setzero_ps();
+    std::size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(query + i), _mm256_loadu_ps(row + i), acc);
+    }
+
+    float sum = horizontalSumAvx2(acc);
+
+    for (; i < n; i++) {
+        sum += query[i] * row[i];
+    }
+
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+void dotRowsAvx2(
+    const float* query,
+    const float* rows,
+    std::size_t stride,
+    std::size_t rowCount,
+    std::size_t n,
+    float* out) {
+
+    std::size_t r = 0;
+
+    // 4 rows per pass: each query load feeds four FMAs
+    for (; r + 4 <= rowCount; r += 4) {
+        const float* t0 = rows + r * stride;
+        const float* t1 = t0 + stride;
+        const float* t2 = t1 + stride;
+        const float* t3 = t2 + stride;
+
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps();
+        __m256 acc3 = _mm256_setzero_ps();
+        std::size_t i = 0;
+
+        for (; i + 8 <= n; i += 8) {
+            const __m256 q = _mm256_loadu_ps(query + i);
+            acc0 = _mm256_fmadd_ps(q, _mm256_loadu_ps(t0 + i), acc0);
+            acc1 = _mm256_fmadd_ps(q, _mm256_loadu_ps(t1 + i), acc1);
+            acc2 = _mm256_fmadd_ps(q, _mm256_loadu_ps(t2 + i), acc2);
+            acc3 = _mm256_fmadd_ps(q, _mm256_loadu_ps(t3 + i), acc3);
+        }
+
+        float s0 = horizontalSumAvx2(acc0);
+        float s1 = horizontalSumAvx2(acc1);
+        float s2 = horizontalSumAvx2(acc2);
+        float s3 = horizontalSumAvx2(acc3);
+
+        for (; i < n; i++) {
+            s0 += query[i] * t0[i];
+            s1 += query[i] * t1[i];
+            s2 += query[i] * t2[i];
+            s3 += query[i] * t3[i];
+        }
+
+        out[r] = s0;
+        out[r + 1] = s1;
+        out[r + 2] = s2;
+        out[r + 3] = s3;
+    }
+
+    for (; r < rowCount; r++) {
+        out[r] = dotRowAvx2(query, rows + r * stride, n);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+float squaredL2Avx2(const float* a, const float* b, std::size_t n) {
+    // four independent accumulators hide the FMA latency
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    std::size_t i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        const __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        const __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+        const __m256 d2 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16));
+        const __m256 d3 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+        acc2 = _mm256_fmadd_ps(d2, d2, acc2);
+        acc3 = _mm256_fmadd_ps(d3, d3, acc3);
+    }
+
+    for (; i + 8 <= n; i += 8) {
+        const __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        acc0 = _mm256_fmadd_ps(d, d, acc0);
+    }
+
+    const __m256 acc = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+    float distance = horizontalSumAvx2(acc);
+
+    for (; i < n; i++) {
+        const float diff = a[i] - b[i];
+        distance += diff * diff;
+    }
+
+    return distance;
+}
+
+__attribute__((target("avx2,fma")))
+float squaredL2BoundedAvx2(const float* a, const float* b, std::size_t n, float bound) {
+    float distance = 0.0f;
+    std::size_t i = 0;
+
+    for (; i + 64 <= n; i += 64) {
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+
+        for (std::size_t j = i; j < i + 64; j += 16) {
+            const __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(b + j));
+            const __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + j + 8), _mm256_loadu_ps(b + j + 8));
+            acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+            acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+        }
+
+        distance += horizontalSumAvx2(_mm256_add_ps(acc0, acc1));
+        if (distance > bound) {
+            return distance;
+        }
+    }
+
+    return distance + squaredL2Avx2(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+std::uint32_t squaredU8Avx2(const std::uint8_t* a, const std::uint8_t* b, std::size_t n) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    std::size_t i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        const __m256i diff = _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+        const __m256i lo = _mm256_unpacklo_epi8(diff, zero);
+        const __m256i hi = _mm256_unpackhi_epi8(diff, zero);
+        acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(lo, lo));
+        acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(hi, hi));
+    }
+
+    const __m256i acc = _mm256_add_epi32(acc0, acc1);
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return static_cast<std::uint32_t>(_mm_cvtsi128_si32(sum)) + squaredU8Sse2(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+std::uint64_t squaredI16Avx2(const std::int16_t* a, const std::int16_t* b, std::size_t n) {
+    __m256i acc = _mm256_setzero_si256(); // four uint64 lanes
+    std::size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        const __m256i diff = _mm256_sub_epi16(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        const __m256i squares = _mm256_madd_epi16(diff, diff);
+        acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(squares)));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(squares, 1)));
+    }
+
+    alignas(32) std::uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + squaredI16Sse2(a + i, b + i, n - i);
+}
+
+__attribute__((target("popcnt")))
+void hammingRowsPopcnt(
+    const std::uint64_t* query,
+    const std::uint64_t* rows,
+    std::size_t words,
+    std::size_t rowCount,
+    std::uint32_t* out) {
+
+    for (std::size_t r = 0; r < rowCount; r++, rows += words) {
+        // two partial sums keep the popcnt chain short
+        std::uint64_t even = 0;
+        std::uint64_t odd = 0;
+        std::size_t w = 0;
+
+        for (; w + 2 <= words; w += 2) {
+            even += static_cast<std::uint64_t>(__builtin_popcountll(query[w] ^ rows[w]));
+            odd += static_cast<std::uint64_t>(__builtin_popcountll(query[w + 1] ^ rows[w + 1]));
+        }
+        if (w < words) {
+            even += static_cast<std::uint64_t>(__builtin_popcountll(query[w] ^ rows[w]));
+        }
+
+        out[r] = static_cast<std::uint32_t>(even + odd);
+    }
+}
+
+#endif // KNN_X86_KERNELS
+
+struct KernelChoice {
+    SquaredL2Fn squaredL2;
+    SquaredL2BoundedFn squaredL2Bounded;
+    DotFn dot;
+    DotRowsFn dotRows;
+    SquaredU8Fn squaredU8;
+    SquaredI16Fn squaredI16;
+    HammingRowsFn hammingRows;
+    const char* name;
+};
+
+KernelChoice selectKernel() {
+#ifdef KNN_X86_KERNELS
+    __builtin_cpu_init();
+    const HammingRowsFn hammingRows = __builtin_cpu_supports("popcnt") ? hammingRowsPopcnt : hammingRowsScalar;
+
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return {squaredL2Avx2, squaredL2BoundedAvx2, dotAvx2, dotRowsAvx2, squaredU8Avx2, squaredI16Avx2, hammingRows, "avx2"};
+    }
+    return {squaredL2Sse2, squaredL2BoundedSse2, dotSse2, dotRowsSse2, squaredU8Sse2, squaredI16Sse2, hammingRows, "sse2"};
+#else
+    return {squaredL2DistanceScalar, squaredL2BoundedScalar, dotScalar, dotRowsScalar, squaredU8Scalar, squaredI16Scalar,
+            hammingRowsScalar, "scalar"};
+#endif
+}
+
+const KernelChoice& kernel() {
+    static const KernelChoice choice = selectKernel();
+    return choice;
+}
+
+} // namespace
+
+float squaredL2DistanceScalar(const float* a, const float* b, std::size_t n) {
+    float distance = 0.0f;
+
+    for (std::size_t i = 0; i < n; i++) {
+        const float diff = a[i] - b[i];
+        distance += diff * diff;
+    }
+
+    return distance;
+}
+
+float squaredL2Distance(const float* a, const float* b, std::size_t n) {
+    return kernel().squaredL2(a, b, n);
+}
+
+float squaredL2DistanceBounded(const float* a, const float* b, std::size_t n, float bound) {
+    return kernel().squaredL2Bounded(a, b, n, bound);
+}
+
+float dotProduct(const float* a, const float* b, std::size_t n) {
+    return kernel().dot(a, b, n);
+}
+
+void dotProductRows(
+    const float* query,
+    const float* rows,
+    std::size_t stride,
+    std::size_t rowCount,
+    std::size_t n,
+    float* out) {
+    kernel().dotRows(query, rows, stride, rowCount, n, out);
+}
+
+std::uint32_t squaredDistanceU8(const std::uint8_t* a, const std::uint8_t* b, std::size_t n) {
+    return kernel().squaredU8(a, b, n);
+}
+
+std::uint64_t squaredDistanceI16(const std::int16_t* a, const std::int16_t* b, std::size_t n) {
+    return kernel().squaredI16(a, b, n);
+}
+
+void hammingDistanceRows(
+    const std::uint64_t* query,
+    const std::uint64_t* rows,
+    std::size_t words,
+    std::size_t rowCount,
+    std::uint32_t* out) {
+    kernel().hammingRows(query, rows, words, rowCount, out);
+}
+
+const char* distanceKernelName() {
+    return kernel().name;
+}
@@ -1,24 +1,112 @@
 #include "baselines/knn/feature_extractor.h"
 
+#include <algorithm>
+#include <array>
+
+namespace {
+
+// v / 255.0f for every pixel value, the exact floats the per-group extractors produce
+const std::array<float, 256>& normalizedPixels() {
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> values{};
+        for (int v = 0; v < 256; v++) {
+            values[v] = v / 255.0f;
+        }
+        return values;
+    }();
+    return table;
+}
+
+} // namespace
+
 FeatureExtractor::FeatureExtractor() {}
 
 std::vector<float> FeatureExtractor::extractKNNFeatures(const ImageMatrix& digit) const {
-    std::vector<float> features;
+    return extractKNNFeatures(digit.view());
+}
 
-    // Combine multiple feature types
-    auto pixelFeatures = extractPixelFeatures(digit);
-    auto zoningFeatures = extractZoningFeatures(digit);
-    auto projectionFeatures = extractProjectionFeatures(digit);
+std::vector<float> FeatureExtractor::extractKNNFeatures(const ImageView& digit) const {
+    std::vector<float> features(getKNNFeatureDimensions(digit.width, digit.height));
+    extractKNNFeaturesInto(digit, features.data());
+    return features;
+}
 
-    features.reserve(pixelFeatures.size() + zoningFeatures.size() + projectionFeatures.size());
-    features.insert(features.end(), pixelFeatures.begin(), pixelFeatures.end());
-    features.insert(features.end(), zoningFeatures.begin(), zoningFeatures.end());
-    features.insert(features.end(), projectionFeatures.begin(), projectionFeatures.end());
+void FeatureExtractor::extractKNNFeaturesInto(const ImageMatrix& digit, float* out) const {
+    extractKNNFeaturesInto(digit.view(), out);
+}
 
-    return features;
+void FeatureExtractor::extractKNNFeaturesInto(const ImageView& digit, float* out) const {
+    const int width = digit.width;
+    const int height = digit.height;
+    const int channels = digit.channels;
+    const int zones = zoningGridSize;
+    const int zoneHeight = height / zones;
+    const int zoneWidth = width / zones;
+    // pixels past the last full zone (size not divisible by the grid) belong to no zone
+    const int zonedRows = zoneHeight > 0 && zoneWidth > 0 ? zones * zoneHeight : 0;
+
+    float* pixels = out;
+    float* zoneSums = pixels + width * height;
+    float* rowSums = zoneSums + zones * zones;
+    float* columnSums = rowSums + height;
+
+    std::fill(zoneSums, columnSums + width, 0.0f);
+
+    const std::array<float, 256>& normalized = normalizedPixels();
+
+    // every sum is accumulated in the same order as the per-group extractors,
+    // so the result matches extractPixel/Zoning/ProjectionFeatures bit for bit
+    for (int y = 0; y < height; y++) {
+        float rowSum = 0.0f;
+        float* zoneRow = y < zonedRows ? zoneSums + (y / zoneHeight) * zones : nullptr;
+        const unsigned char* source = digit.row(y);
+
+        for (int x = 0; x < width; x++, source += channels) {
+            const float value = normalized[*source];
+            *pixels++ = value;
+            rowSum += value;
+            columnSums[x] += value;
+        }
+
+        if (zoneRow) {
+            const float* rowPixels = pixels - width;
+            for (int j = 0; j < zones; j++) {
+                for (int x = j * zoneWidth; x < (j + 1) * zoneWidth; x++) {
+                    zoneRow[j] += rowPixels[x];
+                }
+            }
+        }
+
+        rowSums[y] = rowSum / width;
+    }
+
+    if (zonedRows > 0) {
+        const int zonePixels = zoneHeight * zoneWidth;
+        for (int z = 0; z < zones * zones; z++) {
+            zoneSums[z] /= zonePixels;
+        }
+    }
+
+    for (int x = 0; x < width; x++) {
+        columnSums[x] /= height;
+    }
+}
+
+void FeatureExtractor::extractKNNFeaturesBatch(
+    const std::vector<ImageMatrix>& digits,
+    float* out,
+    std::size_t stride) const {
+
+    for (std::size_t i = 0; i < digits.size(); i++) {
+        extractKNNFeaturesInto(digits[i], out + i * stride);
+    }
 }
 
 std::vector<float> FeatureExtractor::extractPixelFeatures(const ImageMatrix& digit) const {
+    return extractPixelFeatures(digit.view());
+}
+
+std::vector<float> FeatureExtractor::extractPixelFeatures(const ImageView& digit) const {
     std::vector<float> features;
     features.reserve(digit.width * digit.height);
 
@@ -33,6 +121,10 @@ std::vector<float> FeatureExtractor::extractPixelFeatures(const ImageMatrix& dig
 }
 
 std::vector<float> FeatureExtractor::extractZoningFeatures(const ImageMatrix& digit) const {
+    return extractZoningFeatures(digit.view());
+}
+
+std::vector<float> FeatureExtractor::extractZoningFeatures(const ImageView& digit) const {
     const int zones = zoningGridSize;    // default=4x4 grid
     const int zoneHeight = digit.height / zones;
     const int zoneWidth = digit.width / zones;
@@ -65,6 +157,10 @@ std::vector<float> FeatureExtractor::extractZoningFeatures(const ImageMatrix& di
 }
 
 std::vector<float> FeatureExtractor::extractProjectionFeatures(const ImageMatrix& digit) const {
+    return extractProjectionFeatures(digit.view());
+}
+
+std::vector<float> FeatureExtractor::extractProjectionFeatures(const ImageView& digit) const {
     std::vector<float> features;
     features.reserve(digit.height + digit.width);
 
@@ -96,6 +192,22 @@ int FeatureExtractor::getKNNFeatureDimensions(int width, int height) const {
     return width * height + zoningGridSize * zoningGridSize + width + height;
 }
 
+KNNFeatureLayout FeatureExtractor::getKNNFeatureLayout(int width, int height) const {
+    return {width, height, zoningGridSize};
+}
+
+std::string FeatureExtractor::getKNNFeatureConfig() const {
+    return "knn-v" + std::to_string(featureVersion) + "-zoning" + std::to_string(zoningGridSize);
+}
+
+std::string FeatureExtractor::getNeuralNetworkFeatureConfig() const {
+    return "pixels-v" + std::to_string(featureVersion);
+}
+
 std::vector<float> FeatureExtractor::extractNeuralNetworkFeatures(const ImageMatrix& digit) const {
+    return extractPixelFeatures(digit.view());
+}
+
+std::vector<float> FeatureExtractor::extractNeuralNetworkFeatures(const ImageView& digit) const {
     return extractPixelFeatures(digit);
 }
@@ -0,0 +1,429 @@
+#include "baselines/knn/hnsw_index.h"
+#include "baselines/knn/distance_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <random>
+
+namespace {
+
+constexpr std::uint32_t hnswMagic = 0x57534e48; // "HNSW"
+constexpr std::uint32_t hnswVersion = 1;
+// far above any useful M, and keeps 2 * M + 1 links per node in int range
+constexpr std::int32_t maxStoredM = 1 << 16;
+
+struct HNSWFileHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t rows;
+    std::uint64_t cols;
+    std::int32_t M;
+    std::int32_t efConstruction;
+    std::int32_t efSearch;
+    std::int32_t maxLevel;
+    std::int32_t entryPoint;
+    std::uint32_t seed;
+};
+
+// visit marks reused across searches on the same thread; bumping the tag clears them
+struct VisitedList {
+    std::vector<unsigned int> tags;
+    unsigned int current = 0;
+
+    void reset(std::size_t n) {
+        if (tags.size() < n) {
+            tags.assign(n, 0);
+            current = 0;
+        }
+        if (++current == 0) {
+            std::fill(tags.begin(), tags.end(), 0);
+            current = 1;
+        }
+    }
+
+    // true the first time a node is seen since reset()
+    bool visit(int node) {
+        if (tags[node] == current) {
+            return false;
+        }
+        tags[node] = current;
+        return true;
+    }
+};
+
+VisitedList& visitedList() {
+    thread_local VisitedList visited;
+    return visited;
+}
+
+} // namespace
+
+HNSWIndex::HNSWIndex() {}
+
+void HNSWIndex::clear() {
+    maxLevel = -1;
+    entryPoint = -1;
+    dataCols = 0;
+    nodeLevels.clear();
+    baseLinks.clear();
+    upperLinks.clear();
+}
+
+int* HNSWIndex::links(int node, int level) {
+    if (level == 0) {
+        return baseLinks.data() + static_cast<std::size_t>(node) * (maxLinks(0) + 1);
+    }
+    return upperLinks[node].data() + static_cast<std::size_t>(level - 1) * (maxLinks(level) + 1);
+}
+
+const int* HNSWIndex::links(int node, int level) const {
+    if (level == 0) {
+        return baseLinks.data() + static_cast<std::size_t>(node) * (maxLinks(0) + 1);
+    }
+    return upperLinks[node].data() + static_cast<std::size_t>(level - 1) * (maxLinks(level) + 1);
+}
+
+int HNSWIndex::greedyClosest(const FeatureMatrix& data, const float* query, int entry, int fromLevel, int toLevel) const {
+    const std::size_t stride = data.stride();
+    int current = entry;
+    float currentDistance = squaredL2Distance(query, data.row(current), stride);
+
+    for (int level = fromLevel; level > toLevel; level--) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            const int* nodeLinks = links(current, level);
+
+            for (int i = 1; i <= nodeLinks[0]; i++) {
+                const int candidate = nodeLinks[i];
+                const float distance = squaredL2Distance(query, data.row(candidate), stride);
+                if (distance < currentDistance) {
+                    currentDistance = distance;
+                    current = candidate;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    return current;
+}
+
+std::vector<HNSWIndex::Candidate> HNSWIndex::searchLayer(
+    const FeatureMatrix& data,
+    const float* query,
+    int entry,
+    int ef,
+    int level) const {
+
+    const std::size_t stride = data.stride();
+    VisitedList& visited = visitedList();
+    visited.reset(nodeLevels.size());
+
+    // candidates: closest first; results: farthest first, capped at ef
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+    std::priority_queue<Candidate> results;
+
+    const float entryDistance = squaredL2Distance(query, data.row(entry), stride);
+    candidates.emplace(entryDistance, entry);
+    results.emplace(entryDistance, entry);
+    visited.visit(entry);
+
+    while (!candidates.empty()) {
+        const Candidate closest = candidates.top();
+        if (closest.first > results.top().first && static_cast<int>(results.size()) >= ef) {
+            break;
+        }
+        candidates.pop();
+
+        const int* nodeLinks = links(closest.second, level);
+        for (int i = 1; i <= nodeLinks[0]; i++) {
+            const int neighbor = nodeLinks[i];
+            if (!visited.visit(neighbor)) {
+                continue;
+            }
+
+            const float bound = results.top().first;
+            const bool full = static_cast<int>(results.size()) >= ef;
+            const float distance = full
+                ? squaredL2DistanceBounded(query, data.row(neighbor), stride, bound)
+                : squaredL2Distance(query, data.row(neighbor), stride);
+
+            if (!full || distance < bound) {
+                candidates.emplace(distance, neighbor);
+                results.emplace(distance, neighbor);
+                if (static_cast<int>(results.size()) > ef) {
+                    results.pop();
+                }
+            }
+        }
+    }
+
+    std::vector<Candidate> found(results.size());
+    for (std::size_t i = found.size(); i > 0; i--) {
+        found[i - 1] = results.top();
+        results.pop();
+    }
+
+    return found;
+}
+
+std::vector<int> HNSWIndex::selectNeighbors(
+    const FeatureMatrix& data,
+    const std::vector<Candidate>& candidates,
+    int maxCount) const {
+
+    // keep a candidate only if it is closer to the query than to every neighbour
+    // picked so far, which spreads links in different directions
+    std::vector<int> selected;
+    selected.reserve(maxCount);
+
+    for (const auto& [distance, node] : candidates) {
+        if (static_cast<int>(selected.size()) >= maxCount) {
+            break;
+        }
+
+        bool keep = true;
+        for (const int other : selected) {
+            if (squaredL2Distance(data.row(node), data.row(other), data.stride()) < distance) {
+                keep = false;
+                break;
+            }
+        }
+
+        if (keep) {
+            selected.push_back(node);
+        }
+    }
+
+    return selected;
+}
+
+void HNSWIndex::connect(const FeatureMatrix& data, int node, int neighbor, int level) {
+    int* neighborLinks = links(neighbor, level);
+    const int capacity = maxLinks(level);
+
+    if (neighborLinks[0] < capacity) {
+        neighborLinks[++neighborLinks[0]] = node;
+        return;
+    }
+
+    // list is full: re-select among the old links plus the new node
+    std::vector<Candidate> candidates;
+    candidates.reserve(capacity + 1);
+    const float* origin = data.row(neighbor);
+
+    candidates.emplace_back(squaredL2Distance(origin, data.row(node), data.stride()), node);
+    for (int i = 1; i <= neighborLinks[0]; i++) {
+        candidates.emplace_back(squaredL2Distance(origin, data.row(neighborLinks[i]), data.stride()), neighborLinks[i]);
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    const std::vector<int> selected = selectNeighbors(data, candidates, capacity);
+    neighborLinks[0] = static_cast<int>(selected.size());
+    std::copy(selected.begin(), selected.end(), neighborLinks + 1);
+}
+
+void HNSWIndex::build(const FeatureMatrix& data, const HNSWParams& buildParams) {
+    clear();
+    params = buildParams;
+    params.M = std::max(2, params.M);
+    params.efConstruction = std::max(params.efConstruction, params.M);
+
+    const int rows = static_cast<int>(data.rows());
+    if (rows == 0) {
+        return;
+    }
+
+    dataCols = data.cols();
+    nodeLevels.resize(rows);
+    baseLinks.assign(static_cast<std::size_t>(rows) * (maxLinks(0) + 1), 0);
+    upperLinks.resize(rows);
+
+    std::mt19937 rng(params.seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    const double levelScale = 1.0 / std::log(static_cast<double>(params.M));
+
+    for (int node = 0; node < rows; node++) {
+        const int level = static_cast<int>(-std::log(1.0 - uniform(rng)) * levelScale);
+        nodeLevels[node] = level;
+        if (level > 0) {
+            upperLinks[node].assign(static_cast<std::size_t>(level) * (maxLinks(1) + 1), 0);
+        }
+
+        if (entryPoint < 0) {
+            entryPoint = node;
+            maxLevel = level;
+            continue;
+        }
+
+        const float* query = data.row(node);
+        int entry = greedyClosest(data, query, entryPoint, maxLevel, level);
+
+        for (int lc = std::min(level, maxLevel); lc >= 0; lc--) {
+            const std::vector<Candidate> candidates = searchLayer(data, query, entry, params.efConstruction, lc);
+            const std::vector<int> neighbors = selectNeighbors(data, candidates, params.M);
+
+            int* nodeLinks = links(node, lc);
+            nodeLinks[0] = static_cast<int>(neighbors.size());
+            std::copy(neighbors.begin(), neighbors.end(), nodeLinks + 1);
+
+            for (const int neighbor : neighbors) {
+                connect(data, node, neighbor, lc);
+            }
+
+            entry = candidates.front().second;
+        }
+
+        if (level > maxLevel) {
+            maxLevel = level;
+            entryPoint = node;
+        }
+    }
+}
+
+void HNSWIndex::search(const FeatureMatrix& data, const float* query, int k, KNearestList& result) const {
+    result.clear();
+    if (empty()) {
+        return;
+    }
+
+    const int entry = greedyClosest(data, query, entryPoint, maxLevel, 0);
+    const std::vector<Candidate> found = searchLayer(data, query, entry, std::max(params.efSearch, k), 0);
+
+    for (const auto& [distance, node] : found) {
+        result.push(node, distance);
+    }
+}
+
+bool HNSWIndex::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Cannot save HNSW index to " << path << "\n";
+        return false;
+    }
+
+    HNSWFileHeader header{};
+    header.magic = hnswMagic;
+    header.version = hnswVersion;
+    header.rows = nodeLevels.size();
+    header.cols = dataCols;
+    header.M = params.M;
+    header.efConstruction = params.efConstruction;
+    header.efSearch = params.efSearch;
+    header.maxLevel = maxLevel;
+    header.entryPoint = entryPoint;
+    header.seed = params.seed;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(nodeLevels.data()), nodeLevels.size() * sizeof(int));
+    file.write(reinterpret_cast<const char*>(baseLinks.data()), baseLinks.size() * sizeof(int));
+    for (const auto& nodeLinks : upperLinks) {
+        file.write(reinterpret_cast<const char*>(nodeLinks.data()), nodeLinks.size() * sizeof(int));
+    }
+
+    return static_cast<bool>(file);
+}
+
+bool HNSWIndex::load(const std::string& path, const FeatureMatrix& data) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    HNSWFileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.magic != hnswMagic || header.version != hnswVersion) {
+        std::cerr << "Not an HNSW index file: " << path << "\n";
+        return false;
+    }
+
+    if (header.rows != data.rows() || header.cols != data.cols()) {
+        std::cerr << "HNSW index " << path << " was built for a different reference set\n";
+        return false;
+    }
+
+    // every count and id below comes from the file: a corrupt or stale one must fail the load
+    // here, not size an allocation or index out of bounds in a later search
+    auto corrupt = [this, &path]() {
+        std::cerr << "Corrupt HNSW index file: " << path << "\n";
+        clear();
+        return false;
+    };
+
+    file.seekg(0, std::ios::end);
+    const std::uint64_t payloadBytes = static_cast<std::uint64_t>(file.tellg()) - sizeof(header);
+    file.seekg(sizeof(header));
+
+    const std::size_t rows = header.rows;
+    const bool emptyGraph = rows == 0 && header.entryPoint == -1 && header.maxLevel == -1;
+    const bool validShape = header.M > 0 && header.M <= maxStoredM && (emptyGraph
+        || (header.entryPoint >= 0 && static_cast<std::size_t>(header.entryPoint) < rows && header.maxLevel >= 0));
+    if (!validShape || rows > payloadBytes / ((2 * static_cast<std::uint64_t>(header.M) + 2) * sizeof(int))) {
+        return corrupt();
+    }
+
+    clear();
+    params.M = header.M;
+    params.efConstruction = header.efConstruction;
+    params.efSearch = header.efSearch;
+    params.seed = header.seed;
+    maxLevel = header.maxLevel;
+    entryPoint = header.entryPoint;
+    dataCols = header.cols;
+
+    nodeLevels.resize(rows);
+    baseLinks.resize(rows * (maxLinks(0) + 1));
+    upperLinks.resize(rows);
+
+    file.read(reinterpret_cast<char*>(nodeLevels.data()), rows * sizeof(int));
+    file.read(reinterpret_cast<char*>(baseLinks.data()), baseLinks.size() * sizeof(int));
+
+    std::uint64_t upperInts = 0;
+    for (const int level : nodeLevels) {
+        if (level < 0 || level > maxLevel) {
+            return corrupt();
+        }
+        upperInts += static_cast<std::uint64_t>(level) * (maxLinks(1) + 1);
+    }
+    if (!emptyGraph && nodeLevels[entryPoint] != maxLevel) {
+        return corrupt();
+    }
+    if ((rows * (maxLinks(0) + 2) + upperInts) * sizeof(int) > payloadBytes) {
+        return corrupt();
+    }
+
+    for (std::size_t node = 0; node < rows; node++) {
+        if (nodeLevels[node] > 0) {
+            upperLinks[node].resize(static_cast<std::size_t>(nodeLevels[node]) * (maxLinks(1) + 1));
+            file.read(reinterpret_cast<char*>(upperLinks[node].data()), upperLinks[node].size() * sizeof(int));
+        }
+    }
+
+    if (!file) {
+        std::cerr << "Truncated HNSW index file: " << path << "\n";
+        clear();
+        return false;
+    }
+
+    // link lists: a count within the layer's capacity, then that many row ids
+    for (std::size_t node = 0; node < rows; node++) {
+        for (int level = 0; level <= nodeLevels[node]; level++) {
+            const int* nodeLinks = links(static_cast<int>(node), level);
+            if (nodeLinks[0] < 0 || nodeLinks[0] > maxLinks(level)) {
+                return corrupt();
+            }
+            for (int i = 1; i <= nodeLinks[0]; i++) {
+                if (nodeLinks[i] < 0 || static_cast<std::size_t>(nodeLinks[i]) >= rows) {
+                    return corrupt();
+                }
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,144 @@
+#include "baselines/knn/ivf_index.h"
+#include "baselines/knn/distance_kernels.h"
+#include "core/parallel_for.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+namespace {
+
+// rows per parallelFor chunk when assigning rows to cells
+constexpr std::size_t assignGrain = 256;
+
+} // namespace
+
+IVFIndex::IVFIndex() {}
+
+void IVFIndex::clear() {
+    centroids = KMeansResult();
+    lists.clear();
+    rowStride = 0;
+    rowCount = 0;
+}
+
+std::size_t IVFIndex::memoryBytes() const {
+    std::size_t bytes = centroids.centroids.size() * sizeof(float);
+    for (const auto& list : lists) {
+        bytes += list.rows.size() * sizeof(int) + list.features.size() * sizeof(float);
+    }
+    return bytes;
+}
+
+void IVFIndex::build(const FeatureMatrix& data, const IVFParams& buildParams) {
+    clear();
+    params = buildParams;
+
+    const std::size_t rows = data.rows();
+    if (rows == 0) {
+        return;
+    }
+
+    rowStride = data.stride();
+
+    // centroids are fitted on a random subset, padded rows and all
+    const std::size_t trainRows = std::min<std::size_t>(rows, std::max(params.trainingSamples, params.lists));
+    FeatureMatrix subset;
+    const float* training = data.row(0);
+    if (trainRows < rows) {
+        std::vector<std::size_t> order(rows);
+        std::iota(order.begin(), order.end(), 0);
+        std::mt19937 rng(params.seed);
+        std::shuffle(order.begin(), order.end(), rng);
+
+        subset = FeatureMatrix(trainRows, data.cols());
+        for (std::size_t i = 0; i < trainRows; i++) {
+            subset.setRow(i, data.row(order[i]), data.cols());
+        }
+        training = subset.row(0);
+    }
+
+    centroids = kmeans(
+        training, trainRows, rowStride, rowStride,
+        static_cast<std::size_t>(std::max(1, params.lists)), params.iterations, params.seed, params.threads);
+
+    std::vector<std::size_t> assignment(rows);
+    parallelFor(rows, assignGrain, params.threads, [&](std::size_t begin, std::size_t end, unsigned int) {
+        for (std::size_t i = begin; i < end; i++) {
+            assignment[i] = nearestList(data.row(i));
+        }
+    });
+
+    lists.resize(centroids.clusters);
+    std::vector<std::size_t> counts(centroids.clusters, 0);
+    for (const std::size_t list : assignment) {
+        counts[list]++;
+    }
+    for (std::size_t c = 0; c < lists.size(); c++) {
+        lists[c].rows.reserve(counts[c]);
+        lists[c].features.reserve(counts[c] * rowStride);
+    }
+
+    for (std::size_t i = 0; i < rows; i++) {
+        InvertedList& list = lists[assignment[i]];
+        list.rows.push_back(static_cast<int>(i));
+        list.features.insert(list.features.end(), data.row(i), data.row(i) + rowStride);
+    }
+
+    rowCount = rows;
+}
+
+std::size_t IVFIndex::nearestList(const float* features) const {
+    return nearestCentroid(centroids, features);
+}
+
+void IVFIndex::insert(const float* features, int row) {
+    if (empty()) {
+        return;
+    }
+
+    InvertedList& list = lists[nearestList(features)];
+    list.rows.push_back(row);
+    list.features.insert(list.features.end(), features, features + rowStride);
+    rowCount++;
+}
+
+void IVFIndex::search(const float* query, KNearestList& result, KNNSearchStats* stats) const {
+    result.clear();
+    if (empty()) {
+        return;
+    }
+
+    const std::size_t listTotal = lists.size();
+    std::vector<float> centroidDistances(listTotal);
+    for (std::size_t c = 0; c < listTotal; c++) {
+        centroidDistances[c] = squaredL2Distance(query, centroids.centroids.data() + c * rowStride, rowStride);
+    }
+
+    const std::size_t probes = std::clamp<std::size_t>(static_cast<std::size_t>(std::max(1, params.nprobe)), 1, listTotal);
+    std::vector<int> order(listTotal);
+    std::iota(order.begin(), order.end(), 0);
+    std::partial_sort(order.begin(), order.begin() + probes, order.end(), [&](int a, int b) {
+        return centroidDistances[a] < centroidDistances[b];
+    });
+
+    std::size_t scanned = 0;
+    for (std::size_t p = 0; p < probes; p++) {
+        const InvertedList& list = lists[order[p]];
+        const float* row = list.features.data();
+
+        for (std::size_t r = 0; r < list.rows.size(); r++, row += rowStride) {
+            const float bound = result.bound();
+            const float distance = squaredL2DistanceBounded(query, row, rowStride, bound);
+            if (distance < bound) {
+                result.push(list.rows[r], distance);
+            }
+        }
+        scanned += list.rows.size();
+    }
+
+    if (stats) {
+        stats->candidates += rowCount;
+        stats->fullDistances += scanned;
+    }
+}
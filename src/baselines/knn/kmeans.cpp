@@ -0,0 +1,118 @@
+#include "baselines/knn/kmeans.h"
+#include "baselines/knn/distance_kernels.h"
+#include "core/parallel_for.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <numeric>
+#include <random>
+
+namespace {
+
+// rows per parallelFor chunk in the assignment step
+constexpr std::size_t assignGrain = 256;
+
+} // namespace
+
+std::size_t nearestCentroid(const KMeansResult& model, const float* vector) {
+    std::size_t best = 0;
+    float bestDistance = std::numeric_limits<float>::max();
+
+    for (std::size_t c = 0; c < model.clusters; c++) {
+        // past the best so far the exact value does not matter
+        const float distance = squaredL2DistanceBounded(vector, model.centroids.data() + c * model.dim, model.dim, bestDistance);
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            best = c;
+        }
+    }
+
+    return best;
+}
+
+KMeansResult kmeans(
+    const float* data,
+    std::size_t rows,
+    std::size_t dim,
+    std::size_t stride,
+    std::size_t clusters,
+    int iterations,
+    unsigned int seed,
+    unsigned int threads) {
+
+    KMeansResult model;
+    model.dim = dim;
+    model.clusters = std::min(clusters, rows);
+    if (model.clusters == 0 || dim == 0) {
+        model.clusters = 0;
+        return model;
+    }
+
+    std::mt19937 rng(seed);
+    model.centroids.resize(model.clusters * dim);
+
+    // initial centroids: distinct random samples
+    std::vector<std::size_t> order(rows);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), rng);
+    for (std::size_t c = 0; c < model.clusters; c++) {
+        const float* sample = data + order[c] * stride;
+        std::copy(sample, sample + dim, model.centroids.begin() + c * dim);
+    }
+
+    std::vector<std::size_t> assignment(rows, 0);
+    std::vector<double> sums(model.clusters * dim);
+    std::vector<std::size_t> counts(model.clusters);
+    std::uniform_int_distribution<std::size_t> pickRow(0, rows - 1);
+
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        std::atomic<bool> changed{false};
+        parallelFor(rows, assignGrain, threads, [&](std::size_t begin, std::size_t end, unsigned int) {
+            bool chunkChanged = false;
+            for (std::size_t i = begin; i < end; i++) {
+                const std::size_t cluster = nearestCentroid(model, data + i * stride);
+                chunkChanged = chunkChanged || cluster != assignment[i];
+                assignment[i] = cluster;
+            }
+            if (chunkChanged) {
+                changed.store(true, std::memory_order_relaxed);
+            }
+        });
+
+        // the update stays serial: it is cheap next to the assignment, and a fixed
+        // summation order keeps the centroids independent of the thread count
+        if (!changed.load() && iteration > 0) {
+            break;
+        }
+
+        std::fill(sums.begin(), sums.end(), 0.0);
+        std::fill(counts.begin(), counts.end(), 0);
+
+        for (std::size_t i = 0; i < rows; i++) {
+            const float* sample = data + i * stride;
+            double* sum = sums.data() + assignment[i] * dim;
+            for (std::size_t d = 0; d < dim; d++) {
+                sum[d] += sample[d];
+            }
+            counts[assignment[i]]++;
+        }
+
+        for (std::size_t c = 0; c < model.clusters; c++) {
+            float* centroid = model.centroids.data() + c * dim;
+
+            if (counts[c] == 0) {
+                // empty cluster: restart it from a random sample
+                const float* sample = data + pickRow(rng) * stride;
+                std::copy(sample, sample + dim, centroid);
+                continue;
+            }
+
+            for (std::size_t d = 0; d < dim; d++) {
+                centroid[d] = static_cast<float>(sums[c * dim + d] / static_cast<double>(counts[c]));
+            }
+        }
+    }
+
+    return model;
+}
@@ -1,123 +1,1179 @@
 #include "baselines/knn/knn_classifier.h"
+#include "baselines/knn/distance_kernels.h"
+#include "baselines/knn/k_nearest_list.h"
+#include "core/parallel_for.h"
 #include <algorithm>
-#include <map>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <limits>
+#include <mutex>
+
+namespace {
+
+// queries packed per block in the batch path
+constexpr std::size_t queryBlockSize = 32;
+// training rows per tile, sized so a tile stays resident in L2 while the block streams over it
+constexpr std::size_t trainingTileBytes = 256 * 1024;
+// training rows per parallelFor chunk when projecting them with PCA
+constexpr std::size_t projectionGrain = 256;
+
+// digit labels fit the stack tallies in vote(), larger label ids fall back to the heap
+constexpr int inlineLabelCount = 16;
+
+constexpr std::uint32_t compressedModelMagic = 0x51504e4b; // "KNPQ"
+constexpr std::uint32_t compressedModelVersion = 2; // 2: PCA projection after the labels
+
+constexpr std::uint32_t modelMagic = 0x4d4e4e4b; // "KNNM"
+constexpr std::uint32_t modelVersion = 2;        // 2: adds projectionOffset
+
+struct ModelFileHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t rows;
+    std::uint64_t cols;
+    std::uint64_t stride;         // floats per stored row
+    std::uint64_t labelOffset;    // rows x int32
+    std::uint64_t normOffset;     // rows x float, squared L2 norms
+    std::uint64_t featureOffset;  // rows x stride floats, FeatureMatrix::alignment aligned
+    std::uint64_t projectionOffset; // PCAProjection::write() output, 0 = features are not projected
+};
+
+// version 1 headers end before projectionOffset
+constexpr std::size_t modelHeaderV1Size = offsetof(ModelFileHeader, projectionOffset);
+
+std::uint64_t alignOffset(std::uint64_t offset) {
+    return (offset + FeatureMatrix::alignment - 1) / FeatureMatrix::alignment * FeatureMatrix::alignment;
+}
+
+struct CompressedModelHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t rows;
+    std::uint64_t featureDim;
+};
+
+} // namespace
 
 KNNClassifier::KNNClassifier(int k) : k(k) {}
 
-void KNNClassifier::train(const std::vector<TrainingSample>* trainingData) {
-    this->trainingData = trainingData;
+void KNNClassifier::train(const std::vector<TrainingSample>* trainingData, bool buildSearchIndex) {
+    clearModel();
+
+    if (!trainingData || trainingData->empty()) {
+        return;
+    }
+
+    for (const auto& sample : *trainingData) {
+        featureDim = std::max(featureDim, sample.features.size());
+    }
+
+    // the integer and binary stores replace the float matrix entirely
+    if (!storesFloatFeatures(searchMode) && canUseCompactStore()) {
+        resetCompactStore(trainingData->size());
+        referenceLabels.reserve(trainingData->size());
+
+        for (std::size_t i = 0; i < trainingData->size(); i++) {
+            const auto& sample = (*trainingData)[i];
+            setCompactRow(i, sample.features.data(), sample.features.size());
+            referenceLabels.push_back(sample.label);
+        }
+        appended.reset(queryDim());
+        return;
+    }
+
+    referenceFeatures = FeatureMatrix(trainingData->size(), featureDim);
+    referenceLabels.reserve(trainingData->size());
+
+    for (std::size_t i = 0; i < trainingData->size(); i++) {
+        const auto& sample = (*trainingData)[i];
+        referenceFeatures.setRow(i, sample.features.data(), sample.features.size());
+        referenceLabels.push_back(sample.label);
+    }
+
+    prepareReferenceRows(buildSearchIndex);
 }
 
-float KNNClassifier::euclideanDistance(const std::vector<float>& a, const std::vector<float>& b) const {
-    float distance = 0.0f;
-    const std::size_t n = std::min(a.size(), b.size());
+void KNNClassifier::train(const FeatureDataset& trainingData, bool buildSearchIndex) {
+    clearModel();
 
-    for (size_t i = 0; i < n; i++) {
-        const float diff = a[i] - b[i];
-        distance += diff * diff;
+    if (trainingData.empty()) {
+        return;
     }
 
-    // intentionally remove std::sqrt() for speed purposes
-    return distance;
+    featureDim = trainingData.cols();
+    referenceLabels = trainingData.labels;
+
+    if (!storesFloatFeatures(searchMode) && canUseCompactStore()) {
+        resetCompactStore(trainingData.size());
+        for (std::size_t i = 0; i < trainingData.size(); i++) {
+            setCompactRow(i, trainingData.features.row(i), featureDim);
+        }
+        appended.reset(queryDim());
+        return;
+    }
+
+    // same padded layout: one copy of the whole matrix
+    referenceFeatures = trainingData.features;
+    prepareReferenceRows(buildSearchIndex);
 }
 
-std::vector<std::pair<int, float>> KNNClassifier::findKNearest(const std::vector<float>& features) const {
-    std::vector<std::pair<int, float>> distances;
+void KNNClassifier::clearModel() {
+    referenceFeatures = FeatureMatrix();
+    modelFile.close();
+    referenceLabels.clear();
+    referenceNorms.clear();
+    hnswIndex.clear();
+    pqIndex.clear();
+    pivotIndex.clear();
+    cascadeIndex.clear();
+    ivfIndex.clear();
+    quantizedStore.clear();
+    binaryStore.clear();
+    projection.clear();
+    appended.reset(0);
+    featureDim = 0;
+}
 
-    if (!trainingData || trainingData->empty()) {
-        return distances;
+void KNNClassifier::prepareReferenceRows(bool buildSearchIndex) {
+    if (pcaParams.components > 0) {
+        if (projection.fit(referenceFeatures, pcaParams)) {
+            FeatureMatrix projected(referenceFeatures.rows(), projection.outputDim());
+            parallelFor(projected.rows(), projectionGrain, pcaParams.threads, [&](std::size_t begin, std::size_t end, unsigned int) {
+                for (std::size_t i = begin; i < end; i++) {
+                    projection.project(referenceFeatures.row(i), featureDim, projected.row(i));
+                }
+            });
+            referenceFeatures = std::move(projected);
+        } else {
+            std::cerr << "PCA needs 0 < components < " << featureDim << ", keeping the full features\n";
+        }
     }
+    appended.reset(queryDim());
 
-    distances.reserve(trainingData->size());
+    // ||t||^2 for the batch path
+    referenceNorms.resize(referenceFeatures.rows());
+    for (std::size_t i = 0; i < referenceFeatures.rows(); i++) {
+        const float* row = referenceFeatures.row(i);
+        referenceNorms[i] = dotProduct(row, row, referenceFeatures.stride());
+    }
 
-    for (const auto& sample : *trainingData) {
-        const float distance = euclideanDistance(features, sample.features);
-        distances.emplace_back(sample.label, distance);
+    if (buildSearchIndex) {
+        buildIndex();
+    }
+}
+
+bool KNNClassifier::addSamples(const std::vector<TrainingSample>& samples) {
+    if (samples.empty()) {
+        return true;
+    }
+
+    if (referenceLabels.empty()) {
+        train(&samples);
+        return true;
+    }
+
+    if (referenceFeatures.empty()) {
+        std::cerr << "Samples can only be added to a model that keeps its float features\n";
+        return false;
     }
 
-    if (static_cast<int>(distances.size()) <= k) {
-        return distances;
+    FeatureMatrix encoded(samples.size(), queryDim());
+    std::vector<int> labels;
+    labels.reserve(samples.size());
+    for (std::size_t i = 0; i < samples.size(); i++) {
+        encodeQuery(samples[i].features, encoded, i);
+        labels.push_back(samples[i].label);
     }
 
-    // Sort by distance
-    std::nth_element(
-        distances.begin(),
-        distances.begin() + k,
-        distances.end(),
-        [](const auto& a, const auto& b) {
-            return a.second < b.second;
-        });
+    appendRows(encoded, labels);
+    return true;
+}
+
+bool KNNClassifier::appendSample(const TrainingSample& sample) {
+    if (referenceLabels.empty() || appended.cols() == 0) {
+        std::cerr << "Train or load a KNN model before appending samples\n";
+        return false;
+    }
+
+    if (searchMode == KNNSearchMode::Binary) {
+        std::cerr << "Binary mode ranks by Hamming distance, appended samples need another search mode\n";
+        return false;
+    }
+
+    FeatureMatrix row(1, appended.cols());
+    encodeQuery(sample.features, row, 0);
+    appended.append(row.row(0), sample.label);
+    return true;
+}
+
+bool KNNClassifier::mergeAppendedSamples() {
+    const auto snapshot = appended.snapshot();
+    if (snapshot->rows == 0) {
+        return true;
+    }
+
+    if (referenceFeatures.empty()) {
+        std::cerr << "Appended samples can only be merged into a model that keeps its float features\n";
+        return false;
+    }
+
+    FeatureMatrix rows(snapshot->rows, appended.cols());
+    std::vector<int> labels(snapshot->rows);
+    for (std::size_t r = 0; r < snapshot->rows; r++) {
+        rows.setRow(r, snapshot->row(r), appended.cols());
+        labels[r] = snapshot->label(r);
+    }
+
+    appended.reset(queryDim());
+    appendRows(rows, labels);
+    return true;
+}
+
+void KNNClassifier::appendRows(const FeatureMatrix& rows, const std::vector<int>& labels) {
+    // one grown copy of the matrix; a mapped model becomes an owned one
+    const std::size_t oldRows = referenceFeatures.rows();
+    const std::size_t stride = referenceFeatures.stride();
+    FeatureMatrix grown(oldRows + rows.rows(), referenceFeatures.cols());
+    std::memcpy(grown.row(0), referenceFeatures.row(0), oldRows * stride * sizeof(float));
+    std::memcpy(grown.row(oldRows), rows.row(0), rows.rows() * stride * sizeof(float));
+
+    for (std::size_t i = 0; i < rows.rows(); i++) {
+        referenceLabels.push_back(labels[i]);
+        referenceNorms.push_back(dotProduct(rows.row(i), rows.row(i), stride));
+    }
+
+    referenceFeatures = std::move(grown);
+    modelFile.close();
+
+    for (std::size_t r = oldRows; r < referenceFeatures.rows(); r++) {
+        ivfIndex.insert(referenceFeatures.row(r), static_cast<int>(r));
+    }
+
+    hnswIndex.clear();
+    pqIndex.clear();
+    pivotIndex.clear();
+    cascadeIndex.clear();
+    quantizedStore.clear();
+    binaryStore.clear();
+    buildIndex();
+}
+
+std::vector<std::size_t> KNNClassifier::trainPrototypes(
+    const std::vector<TrainingSample>* trainingData,
+    const PrototypeSelectionParams& params,
+    PrototypeSelectionStats* stats) {
+
+    if (!trainingData) {
+        train(nullptr);
+        return {};
+    }
+
+    const std::vector<std::size_t> kept = selectPrototypes(*trainingData, params, stats);
+
+    std::vector<TrainingSample> prototypes;
+    prototypes.reserve(kept.size());
+    for (const std::size_t index : kept) {
+        prototypes.push_back((*trainingData)[index]);
+    }
+
+    train(&prototypes);
+    return kept;
+}
+
+void KNNClassifier::setSearchMode(KNNSearchMode mode) {
+    searchMode = mode;
+}
+
+void KNNClassifier::setHNSWParams(const HNSWParams& params) {
+    hnswParams = params;
+    hnswIndex.setEfSearch(params.efSearch);
+}
+
+void KNNClassifier::setHNSWEfSearch(int efSearch) {
+    hnswParams.efSearch = efSearch;
+    hnswIndex.setEfSearch(efSearch);
+}
+
+void KNNClassifier::setPQParams(const PQParams& params) {
+    pqParams = params;
+    pqIndex.setRerankCount(params.rerankCount);
+}
+
+void KNNClassifier::setPQRerankCount(int count) {
+    pqParams.rerankCount = count;
+    pqIndex.setRerankCount(count);
+}
 
-    distances.resize(k);
-    return distances;
+void KNNClassifier::setPivotParams(const PivotParams& params) {
+    pivotParams = params;
+    pivotIndex.clear();
+    buildIndex();
+}
+
+void KNNClassifier::setCascadeShortlist(int shortlist) {
+    cascadeParams.shortlist = shortlist;
+    cascadeIndex.setShortlist(shortlist);
+}
+
+void KNNClassifier::setIVFParams(const IVFParams& params) {
+    ivfParams = params;
+    ivfIndex.clear();
+    buildIndex();
+}
+
+void KNNClassifier::setIVFProbes(int nprobe) {
+    ivfParams.nprobe = nprobe;
+    ivfIndex.setProbes(nprobe);
+}
+
+void KNNClassifier::buildIndex() {
+    if (referenceFeatures.empty()) {
+        return;
+    }
+
+    if (searchMode == KNNSearchMode::HNSW && hnswIndex.empty()) {
+        hnswIndex.build(referenceFeatures, hnswParams);
+    } else if (searchMode == KNNSearchMode::PQ && pqIndex.empty()) {
+        pqIndex.build(referenceFeatures, pqParams);
+    } else if (searchMode == KNNSearchMode::Pivot && pivotIndex.empty()) {
+        pivotIndex.build(referenceFeatures, pivotParams);
+    } else if (searchMode == KNNSearchMode::Cascade && cascadeIndex.empty()) {
+        cascadeIndex.build(referenceFeatures, featureLayout, cascadeParams);
+    } else if (searchMode == KNNSearchMode::IVF && ivfIndex.empty()) {
+        ivfIndex.build(referenceFeatures, ivfParams);
+    } else if (!storesFloatFeatures(searchMode) && !usesIndex() && canUseCompactStore()) {
+        resetCompactStore(referenceFeatures.rows());
+        for (std::size_t i = 0; i < referenceFeatures.rows(); i++) {
+            setCompactRow(i, referenceFeatures.row(i), referenceFeatures.cols());
+        }
+    }
+}
+
+bool KNNClassifier::storesFloatFeatures(KNNSearchMode mode) {
+    return mode != KNNSearchMode::Quantized && mode != KNNSearchMode::Binary;
+}
+
+bool KNNClassifier::canUseCompactStore() const {
+    const bool supported = searchMode == KNNSearchMode::Binary || QuantizedFeatureStore::supports(featureLayout);
+    if (supported && featureLayout.valid() && featureDim == static_cast<std::size_t>(featureLayout.dimensions())) {
+        return true;
+    }
+
+    std::cerr << "Feature layout does not match the training features, using float features\n";
+    return false;
+}
+
+void KNNClassifier::resetCompactStore(std::size_t rows) {
+    // only one compact store is kept at a time
+    if (searchMode == KNNSearchMode::Binary) {
+        quantizedStore.clear();
+        binaryStore.reset(featureLayout, rows, binaryThreshold);
+    } else {
+        binaryStore.clear();
+        quantizedStore.reset(featureLayout, rows);
+    }
+}
+
+void KNNClassifier::setCompactRow(std::size_t r, const float* features, std::size_t count) {
+    if (searchMode == KNNSearchMode::Binary) {
+        binaryStore.setRow(r, features, count);
+    } else {
+        quantizedStore.setRow(r, features, count);
+    }
+}
+
+std::size_t KNNClassifier::compressedBytes() const {
+    switch (searchMode) {
+    case KNNSearchMode::Quantized:
+        return quantizedStore.memoryBytes();
+    case KNNSearchMode::Binary:
+        return binaryStore.memoryBytes();
+    case KNNSearchMode::Pivot:
+        return pivotIndex.memoryBytes();
+    case KNNSearchMode::Cascade:
+        return cascadeIndex.memoryBytes();
+    case KNNSearchMode::IVF:
+        return ivfIndex.memoryBytes();
+    default:
+        return pqIndex.memoryBytes();
+    }
+}
+
+bool KNNClassifier::hasIndex() const {
+    return usesIndex();
+}
+
+bool KNNClassifier::saveIndex(const std::string& path) const {
+    return !hnswIndex.empty() && hnswIndex.save(path);
+}
+
+bool KNNClassifier::loadIndex(const std::string& path) {
+    if (!hnswIndex.load(path, referenceFeatures)) {
+        return false;
+    }
+
+    hnswParams = hnswIndex.parameters();
+    return true;
+}
+
+bool KNNClassifier::saveModel(const std::string& path) const {
+    if (referenceFeatures.empty()) {
+        std::cerr << "No float features to save\n";
+        return false;
+    }
+
+    return writeModel(path, 0, referenceFeatures.rows());
+}
+
+std::vector<std::string> KNNClassifier::saveShardModels(const std::string& pathPrefix, int shards) const {
+    if (referenceFeatures.empty() || shards <= 0) {
+        std::cerr << "No float features to shard\n";
+        return {};
+    }
+
+    const std::size_t rows = referenceFeatures.rows();
+    const std::size_t shardCount = static_cast<std::size_t>(shards);
+    std::vector<std::string> paths;
+
+    for (std::size_t s = 0; s < shardCount; s++) {
+        // contiguous ranges keep global row order = shard order, which the merge tie-break relies on
+        const std::size_t begin = rows * s / shardCount;
+        const std::size_t end = rows * (s + 1) / shardCount;
+        const std::string path = pathPrefix + ".shard" + std::to_string(s) + ".knn";
+        if (!writeModel(path, begin, end - begin)) {
+            return {};
+        }
+        paths.push_back(path);
+    }
+
+    return paths;
+}
+
+bool KNNClassifier::writeModel(const std::string& path, std::size_t firstRow, std::size_t rowCount) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Cannot save model to " << path << "\n";
+        return false;
+    }
+
+    const std::uint64_t rows = rowCount;
+    ModelFileHeader header{};
+    header.magic = modelMagic;
+    header.version = modelVersion;
+    header.rows = rows;
+    header.cols = referenceFeatures.cols();
+    header.stride = referenceFeatures.stride();
+    header.labelOffset = alignOffset(sizeof(header));
+    header.normOffset = alignOffset(header.labelOffset + rows * sizeof(std::int32_t));
+    header.featureOffset = alignOffset(header.normOffset + rows * sizeof(float));
+    header.projectionOffset = projection.empty() ? 0 : header.featureOffset + rows * header.stride * sizeof(float);
+
+    auto padTo = [&file](std::uint64_t offset) {
+        static const char zeros[FeatureMatrix::alignment] = {};
+        const std::uint64_t position = static_cast<std::uint64_t>(file.tellp());
+        file.write(zeros, static_cast<std::streamsize>(offset - position));
+    };
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    padTo(header.labelOffset);
+    for (std::size_t r = firstRow; r < firstRow + rowCount; r++) {
+        const std::int32_t stored = referenceLabels[r];
+        file.write(reinterpret_cast<const char*>(&stored), sizeof(stored));
+    }
+    padTo(header.normOffset);
+    file.write(reinterpret_cast<const char*>(referenceNorms.data() + firstRow), rows * sizeof(float));
+    padTo(header.featureOffset);
+    // rows are contiguous with their padding, one write for the whole range
+    if (rows > 0) {
+        file.write(reinterpret_cast<const char*>(referenceFeatures.row(firstRow)), rows * header.stride * sizeof(float));
+    }
+    if (!projection.empty()) {
+        projection.write(file);
+    }
+
+    return static_cast<bool>(file);
+}
+
+bool KNNClassifier::loadModel(const std::string& path) {
+    MappedFile mapped;
+    if (!mapped.open(path)) {
+        return false;
+    }
+
+    ModelFileHeader header{};
+    if (mapped.size() >= modelHeaderV1Size) {
+        std::memcpy(&header, mapped.data(), modelHeaderV1Size);
+    }
+    if (header.version == modelVersion && mapped.size() >= sizeof(header)) {
+        std::memcpy(&header, mapped.data(), sizeof(header));
+    }
+
+    // offsets ordered and in the file first, then each section's row count bounded by the
+    // space it has, so no corrupt value can wrap the arithmetic around; cols is bounded
+    // before stride * sizeof(float) is taken
+    const std::uint64_t fileSize = mapped.size();
+    const bool valid = header.magic == modelMagic
+        && (header.version == 1 || header.version == modelVersion)
+        && header.cols <= fileSize / sizeof(float)
+        && header.stride != 0
+        && header.stride == FeatureMatrix::paddedSize(header.cols)
+        && header.featureOffset % FeatureMatrix::alignment == 0
+        && header.labelOffset <= header.normOffset
+        && header.normOffset <= header.featureOffset
+        && header.featureOffset <= fileSize
+        && header.rows <= (header.normOffset - header.labelOffset) / sizeof(std::int32_t)
+        && header.rows <= (header.featureOffset - header.normOffset) / sizeof(float)
+        && header.rows <= (fileSize - header.featureOffset) / (header.stride * sizeof(float))
+        && (header.projectionOffset == 0
+            || (header.projectionOffset >= header.featureOffset + header.rows * header.stride * sizeof(float)
+                && header.projectionOffset < fileSize));
+    if (!valid) {
+        std::cerr << "Not a KNN model file or unsupported version: " << path << "\n";
+        return false;
+    }
+
+    // the projection is small and read into memory
+    PCAProjection loadedProjection;
+    if (header.projectionOffset != 0) {
+        std::ifstream file(path, std::ios::binary);
+        file.seekg(static_cast<std::streamoff>(header.projectionOffset));
+        if (!loadedProjection.read(file, fileSize - header.projectionOffset, 0, header.cols) || loadedProjection.empty()) {
+            std::cerr << "Corrupted PCA projection in model file: " << path << "\n";
+            return false;
+        }
+    }
+
+    train(nullptr);
+
+    // labels and norms are small, the feature matrix stays in the mapping
+    const auto* labels = reinterpret_cast<const std::int32_t*>(mapped.data() + header.labelOffset);
+    const auto* norms = reinterpret_cast<const float*>(mapped.data() + header.normOffset);
+    referenceLabels.assign(labels, labels + header.rows);
+    referenceNorms.assign(norms, norms + header.rows);
+    projection = std::move(loadedProjection);
+    featureDim = projection.empty() ? header.cols : projection.inputDim();
+    appended.reset(queryDim());
+
+    modelFile = std::move(mapped);
+    referenceFeatures = FeatureMatrix::view(
+        reinterpret_cast<const float*>(modelFile.data() + header.featureOffset), header.rows, header.cols);
+    return true;
+}
+
+bool KNNClassifier::isModelFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::uint32_t magic = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    return file && magic == modelMagic;
+}
+
+bool KNNClassifier::saveCompressedModel(const std::string& path) const {
+    if (pqIndex.empty()) {
+        std::cerr << "No product-quantized index to save\n";
+        return false;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Cannot save model to " << path << "\n";
+        return false;
+    }
+
+    const CompressedModelHeader header{compressedModelMagic, compressedModelVersion, referenceLabels.size(), featureDim};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(referenceLabels.data()), referenceLabels.size() * sizeof(int));
+    projection.write(file);
+
+    return pqIndex.write(file);
+}
+
+bool KNNClassifier::loadCompressedModel(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Cannot load model from " << path << "\n";
+        return false;
+    }
+
+    CompressedModelHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.magic != compressedModelMagic || header.version != compressedModelVersion) {
+        std::cerr << "Not a compressed KNN model: " << path << "\n";
+        return false;
+    }
+
+    // the labels must fit in the file before they are allocated
+    file.seekg(0, std::ios::end);
+    const std::uint64_t fileSize = static_cast<std::uint64_t>(file.tellg());
+    file.seekg(sizeof(header));
+    if (!file || header.rows > (fileSize - sizeof(header)) / sizeof(int)) {
+        std::cerr << "Corrupted compressed KNN model: " << path << "\n";
+        return false;
+    }
+
+    std::vector<int> labels(header.rows);
+    file.read(reinterpret_cast<char*>(labels.data()), labels.size() * sizeof(int));
+
+    PCAProjection loadedProjection;
+    const std::uint64_t projectionBytes = fileSize - sizeof(header) - header.rows * sizeof(int);
+    if (!loadedProjection.read(file, projectionBytes, header.featureDim)) {
+        std::cerr << "Corrupted compressed KNN model: " << path << "\n";
+        return false;
+    }
+    const std::size_t codedDim = loadedProjection.empty() ? header.featureDim : loadedProjection.outputDim();
+
+    PQIndex index;
+    if (!file || !index.read(file) || index.size() != header.rows || index.dimensions() != codedDim) {
+        std::cerr << "Corrupted compressed KNN model: " << path << "\n";
+        return false;
+    }
+
+    // codes only: there are no float features to re-rank against
+    referenceFeatures = FeatureMatrix();
+    modelFile.close();
+    referenceNorms.clear();
+    hnswIndex.clear();
+    pivotIndex.clear();
+    cascadeIndex.clear();
+    ivfIndex.clear();
+    projection = std::move(loadedProjection);
+    referenceLabels = std::move(labels);
+    featureDim = header.featureDim;
+    appended.reset(queryDim());
+    pqIndex = std::move(index);
+    pqParams = pqIndex.parameters();
+    searchMode = KNNSearchMode::PQ;
+    return true;
+}
+
+bool KNNClassifier::isCompressedModel(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::uint32_t magic = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    return file && magic == compressedModelMagic;
+}
+
+bool KNNClassifier::usesIndex() const {
+    switch (searchMode) {
+    case KNNSearchMode::HNSW:
+        return !hnswIndex.empty();
+    case KNNSearchMode::PQ:
+        return !pqIndex.empty();
+    case KNNSearchMode::Quantized:
+        return !quantizedStore.empty();
+    case KNNSearchMode::Binary:
+        return !binaryStore.empty();
+    case KNNSearchMode::Pivot:
+        return !pivotIndex.empty();
+    case KNNSearchMode::Cascade:
+        return !cascadeIndex.empty();
+    case KNNSearchMode::IVF:
+        return !ivfIndex.empty();
+    default:
+        return false;
+    }
+}
+
+void KNNClassifier::searchNearest(const float* query, KNearestList& best, SearchScratch& scratch, KNNSearchStats* stats) const {
+    if (usesIndex() && searchMode == KNNSearchMode::HNSW) {
+        hnswIndex.search(referenceFeatures, query, k, best);
+        return;
+    }
+
+    if (usesIndex() && searchMode == KNNSearchMode::PQ) {
+        const int rerankCount = pqIndex.parameters().rerankCount;
+        if (rerankCount <= k || referenceFeatures.empty()) {
+            pqIndex.search(query, best);
+            return;
+        }
+
+        // approximate shortlist, then exact distances on the few survivors
+        KNearestList shortlist(rerankCount);
+        pqIndex.search(query, shortlist);
+
+        best.clear();
+        for (const auto& candidate : shortlist) {
+            const int row = candidate.first;
+            best.push(row, squaredL2Distance(query, referenceFeatures.row(row), referenceFeatures.stride()));
+        }
+        return;
+    }
+
+    if (usesIndex() && searchMode == KNNSearchMode::Quantized) {
+        quantizedSearch(query, best);
+        return;
+    }
+
+    if (usesIndex() && searchMode == KNNSearchMode::Binary) {
+        binarySearch(query, best);
+        return;
+    }
+
+    if (usesIndex() && searchMode == KNNSearchMode::Pivot) {
+        pivotIndex.search(referenceFeatures, query, best, scratch.pivot, stats);
+        return;
+    }
+
+    if (usesIndex() && searchMode == KNNSearchMode::Cascade) {
+        cascadeIndex.search(referenceFeatures, query, best, scratch.cascade, stats);
+        return;
+    }
+
+    if (usesIndex() && searchMode == KNNSearchMode::IVF) {
+        ivfIndex.search(query, best, stats);
+        return;
+    }
+
+    exactSearch(query, best);
+    if (stats) {
+        stats->candidates += referenceFeatures.rows();
+        stats->fullDistances += referenceFeatures.rows();
+    }
+}
+
+void KNNClassifier::quantizedSearch(const float* query, KNearestList& best) const {
+    std::vector<std::uint8_t> encoded(quantizedStore.rowBytes());
+    quantizedStore.quantize(query, featureDim, encoded.data());
+
+    QuantizedFeatureStore::NearestList nearest(best.capacity());
+    quantizedStore.search(encoded.data(), nearest);
+
+    // neighbors come out sorted, the float distances only feed the vote tie-break
+    best.clear();
+    for (const auto& [row, distance] : nearest) {
+        best.push(row, quantizedStore.toFloatDistance(distance));
+    }
+}
+
+void KNNClassifier::binarySearch(const float* query, KNearestList& best) const {
+    std::vector<std::uint64_t> packed(binaryStore.wordsPerRow());
+    binaryStore.pack(query, featureDim, packed.data());
+
+    BinaryFeatureStore::NearestList nearest(best.capacity());
+    binaryStore.search(packed.data(), nearest);
+
+    best.clear();
+    for (const auto& [row, distance] : nearest) {
+        best.push(row, static_cast<float>(distance));
+    }
+}
+
+void KNNClassifier::exactSearch(const float* query, KNearestList& best) const {
+    const std::size_t rows = referenceFeatures.rows();
+    const std::size_t stride = referenceFeatures.stride();
+    best.clear();
+
+    for (std::size_t i = 0; i < rows; i++) {
+        // the current k-th distance lets the kernel abandon far-away samples early;
+        // squared distance: std::sqrt() is intentionally skipped, the ordering is the same
+        const float bound = best.bound();
+        const float distance = squaredL2DistanceBounded(query, referenceFeatures.row(i), stride, bound);
+        if (distance < bound) {
+            best.push(static_cast<int>(i), distance);
+        }
+    }
+}
+
+void KNNClassifier::searchAppended(
+    const OnlineReferenceStore::Snapshot& snapshot,
+    const float* query,
+    KNearestList& best,
+    KNNSearchStats* stats) const {
+
+    const std::size_t baseRows = referenceLabels.size();
+    const std::size_t stride = FeatureMatrix::paddedSize(appended.cols());
+
+    for (std::size_t r = 0; r < snapshot.rows; r++) {
+        const float bound = best.bound();
+        const float distance = squaredL2DistanceBounded(query, snapshot.row(r), stride, bound);
+        if (distance < bound) {
+            best.push(static_cast<int>(baseRows + r), distance);
+        }
+    }
+
+    if (stats) {
+        stats->candidates += snapshot.rows;
+        stats->fullDistances += snapshot.rows;
+    }
+}
+
+std::vector<std::pair<int, float>> KNNClassifier::labelNeighbors(
+    const KNearestList& best,
+    const OnlineReferenceStore::Snapshot& snapshot) const {
+
+    const std::size_t baseRows = referenceLabels.size();
+    std::vector<std::pair<int, float>> neighbors;
+    neighbors.reserve(best.size());
+
+    for (const auto& [row, distance] : best) {
+        const std::size_t r = static_cast<std::size_t>(row);
+        neighbors.emplace_back(r < baseRows ? referenceLabels[r] : snapshot.label(r - baseRows), distance);
+    }
+
+    return neighbors;
+}
+
+std::size_t KNNClassifier::queryDim() const {
+    return projection.empty() ? featureDim : projection.outputDim();
+}
+
+void KNNClassifier::encodeQuery(const std::vector<float>& features, FeatureMatrix& block, std::size_t r) const {
+    encodeQuery(features.data(), features.size(), block, r);
+}
+
+void KNNClassifier::encodeQuery(const float* features, std::size_t count, FeatureMatrix& block, std::size_t r) const {
+    if (projection.empty()) {
+        block.setRow(r, features, count);
+    } else {
+        projection.project(features, count, block.row(r));
+    }
+}
+
+std::vector<std::pair<int, float>> KNNClassifier::findKNearest(const std::vector<float>& features) const {
+    if (referenceLabels.empty()) {
+        return {};
+    }
+
+    // copy the query into the same padded layout as the stored rows
+    FeatureMatrix query(1, queryDim());
+    encodeQuery(features, query, 0);
+
+    // one snapshot per query: rows appended meanwhile are neither searched nor labelled
+    const auto snapshot = appended.snapshot();
+    KNearestList best(k);
+    SearchScratch scratch;
+    searchNearest(query.row(0), best, scratch);
+    searchAppended(*snapshot, query.row(0), best);
+    return labelNeighbors(best, *snapshot);
+}
+
+std::vector<int> KNNClassifier::nearestRows(const std::vector<float>& features, KNNSearchStats* stats) const {
+    std::vector<int> rows;
+    if (referenceLabels.empty()) {
+        return rows;
+    }
+
+    FeatureMatrix query(1, queryDim());
+    encodeQuery(features, query, 0);
+
+    const auto snapshot = appended.snapshot();
+    KNearestList best(k);
+    SearchScratch scratch;
+    searchNearest(query.row(0), best, scratch, stats);
+    searchAppended(*snapshot, query.row(0), best, stats);
+
+    for (const auto& neighbor : best) {
+        rows.push_back(neighbor.first);
+    }
+    return rows;
 }
 
 int KNNClassifier::predict(const std::vector<float>& features) const {
-    const auto neighbors = findKNearest(features);
+    return vote(findKNearest(features));
+}
 
+int KNNClassifier::vote(const std::vector<std::pair<int, float>>& neighbors) {
     if (neighbors.empty()) {
         return -1;
     }
 
-    // Count votes + distance tie-break
-    std::map<int, int> votes;
-    std::map<int, float> distanceSums;
+    // slots run from the smallest label up, so negative labels index in bounds too
+    int firstLabel = neighbors.front().first;
+    int lastLabel = firstLabel;
+    for (const auto& neighbor : neighbors) {
+        firstLabel = std::min(firstLabel, neighbor.first);
+        lastLabel = std::max(lastLabel, neighbor.first);
+    }
+    const int labelCount = lastLabel - firstLabel + 1;
+
+    // Count votes + distance tie-break in flat per-label arrays
+    std::array<int, inlineLabelCount> inlineVotes{};
+    std::array<float, inlineLabelCount> inlineDistanceSums{};
+    std::vector<int> heapVotes;
+    std::vector<float> heapDistanceSums;
+
+    int* votes = inlineVotes.data();
+    float* distanceSums = inlineDistanceSums.data();
+    if (labelCount > inlineLabelCount) {
+        heapVotes.assign(labelCount, 0);
+        heapDistanceSums.assign(labelCount, 0.0f);
+        votes = heapVotes.data();
+        distanceSums = heapDistanceSums.data();
+    }
 
     for (const auto& [label, dist] : neighbors) {
-        votes[label]++;
-        distanceSums[label] += dist;
+        votes[label - firstLabel]++;
+        distanceSums[label - firstLabel] += dist;
     }
 
-    // Find label with most votes
+    // Find label with most votes, ascending label order keeps the old tie-break
     int predictedLabel = -1;
     int maxVotes = -1;
     float bestDistanceSum = std::numeric_limits<float>::max();
 
-    for (const auto& [label, count] : votes) {
-        const float distSum = distanceSums[label];
+    for (int slot = 0; slot < labelCount; slot++) {
+        const int count = votes[slot];
+        if (count == 0) {
+            continue;
+        }
 
-        if (count > maxVotes || (count == maxVotes && distSum < bestDistanceSum)) {
+        if (count > maxVotes || (count == maxVotes && distanceSums[slot] < bestDistanceSum)) {
             maxVotes = count;
-            bestDistanceSum = distSum;
-            predictedLabel = label;
+            bestDistanceSum = distanceSums[slot];
+            predictedLabel = firstLabel + slot;
         }
     }
 
     return predictedLabel;
 }
 
+std::vector<int> KNNClassifier::predictBatch(const std::vector<std::vector<float>>& queries, unsigned int threads) const {
+    std::vector<int> predictions(queries.size(), -1);
+
+    if (referenceLabels.empty()) {
+        return predictions;
+    }
+
+    // one query block and one set of search buffers per worker
+    std::vector<FeatureMatrix> blocks(resolveThreadCount(threads));
+    std::vector<SearchScratch> scratch(blocks.size());
+
+    parallelFor(queries.size(), queryBlockSize, threads, [&](std::size_t begin, std::size_t end, unsigned int worker) {
+        FeatureMatrix& block = blocks[worker];
+        if (block.empty()) {
+            block = FeatureMatrix(queryBlockSize, queryDim());
+        }
+
+        for (std::size_t q = begin; q < end; q++) {
+            encodeQuery(queries[q], block, q - begin);
+        }
+
+        predictBlock(block, end - begin, predictions.data() + begin, scratch[worker]);
+    });
+
+    return predictions;
+}
+
+std::vector<std::vector<KNNNeighbor>> KNNClassifier::neighborsBatch(
+    const std::vector<std::vector<float>>& queries,
+    unsigned int threads) const {
+
+    std::vector<std::vector<KNNNeighbor>> neighbors(queries.size());
+
+    if (referenceLabels.empty()) {
+        return neighbors;
+    }
+
+    std::vector<FeatureMatrix> blocks(resolveThreadCount(threads));
+    std::vector<SearchScratch> scratch(blocks.size());
+
+    parallelFor(queries.size(), queryBlockSize, threads, [&](std::size_t begin, std::size_t end, unsigned int worker) {
+        FeatureMatrix& block = blocks[worker];
+        if (block.empty()) {
+            block = FeatureMatrix(queryBlockSize, queryDim());
+        }
+
+        for (std::size_t q = begin; q < end; q++) {
+            encodeQuery(queries[q], block, q - begin);
+        }
+
+        const auto snapshot = appended.snapshot();
+        std::vector<KNearestList> best(end - begin, KNearestList(k));
+        searchBlock(block, end - begin, *snapshot, best, scratch[worker]);
+
+        const std::size_t baseRows = referenceLabels.size();
+        for (std::size_t q = begin; q < end; q++) {
+            for (const auto& [row, distance] : best[q - begin]) {
+                const std::size_t r = static_cast<std::size_t>(row);
+                const int label = r < baseRows ? referenceLabels[r] : snapshot->label(r - baseRows);
+                neighbors[q].push_back({row, label, distance});
+            }
+        }
+    });
+
+    return neighbors;
+}
+
+void KNNClassifier::predictBlock(
+    const FeatureMatrix& queries,
+    std::size_t count,
+    int* predictions,
+    SearchScratch& scratch) const {
+
+    const auto snapshot = appended.snapshot();
+    std::vector<KNearestList> best(count, KNearestList(k));
+    searchBlock(queries, count, *snapshot, best, scratch);
+
+    for (std::size_t q = 0; q < count; q++) {
+        predictions[q] = vote(labelNeighbors(best[q], *snapshot));
+    }
+}
+
+void KNNClassifier::searchBlock(
+    const FeatureMatrix& queries,
+    std::size_t count,
+    const OnlineReferenceStore::Snapshot& snapshot,
+    std::vector<KNearestList>& best,
+    SearchScratch& scratch) const {
+
+    if (usesIndex() || referenceFeatures.empty()) {
+        // index searches touch few rows per query, nothing to share across the block
+        for (std::size_t q = 0; q < count; q++) {
+            searchNearest(queries.row(q), best[q], scratch);
+            searchAppended(snapshot, queries.row(q), best[q]);
+        }
+        return;
+    }
+
+    const std::size_t rows = referenceFeatures.rows();
+    const std::size_t stride = referenceFeatures.stride();
+    const std::size_t tileRows = std::max<std::size_t>(4, trainingTileBytes / (stride * sizeof(float)));
+
+    std::vector<float> queryNorms(count);
+
+    for (std::size_t q = 0; q < count; q++) {
+        queryNorms[q] = dotProduct(queries.row(q), queries.row(q), stride);
+    }
+
+    std::vector<float> dots(tileRows);
+
+    // every training tile is loaded once and reused by all queries of the block
+    for (std::size_t tileStart = 0; tileStart < rows; tileStart += tileRows) {
+        const std::size_t tileCount = std::min(tileRows, rows - tileStart);
+        const float* tile = referenceFeatures.row(tileStart);
+
+        for (std::size_t q = 0; q < count; q++) {
+            dotProductRows(queries.row(q), tile, stride, tileCount, stride, dots.data());
+
+            for (std::size_t r = 0; r < tileCount; r++) {
+                // ||q - t||^2 = ||q||^2 - 2 q.t + ||t||^2, clamped against rounding below zero
+                const float distance = std::max(
+                    0.0f, queryNorms[q] - 2.0f * dots[r] + referenceNorms[tileStart + r]);
+                best[q].push(static_cast<int>(tileStart + r), distance);
+            }
+        }
+    }
+
+    for (std::size_t q = 0; q < count; q++) {
+        searchAppended(snapshot, queries.row(q), best[q]);
+    }
+}
+
 float KNNClassifier::evaluate(
     const std::vector<TrainingSample>& testData,
     std::size_t maxSamples,
-    bool showProgress) const {
+    bool showProgress,
+    unsigned int threads) const {
 
-    if (!trainingData || trainingData->empty() || testData.empty()) {
-        return 0.0f;
-    }
+    const std::size_t limit = (maxSamples == 0) ? testData.size() : std::min(maxSamples, testData.size());
+    const std::size_t correct = evaluateQueries(
+        limit,
+        [&](std::size_t q, FeatureMatrix& block, std::size_t r) { encodeQuery(testData[q].features, block, r); },
+        [&](std::size_t q) { return testData[q].label; },
+        showProgress,
+        threads);
+    return limit == 0 ? 0.0f : static_cast<float>(correct) / static_cast<float>(limit);
+}
+
+float KNNClassifier::evaluate(
+    const FeatureDataset& testData,
+    std::size_t maxSamples,
+    bool showProgress,
+    unsigned int threads) const {
+
+    const std::size_t limit = (maxSamples == 0) ? testData.size() : std::min(maxSamples, testData.size());
+    const std::size_t correct = countCorrect(testData, maxSamples, showProgress, threads);
+    return limit == 0 ? 0.0f : static_cast<float>(correct) / static_cast<float>(limit);
+}
+
+std::size_t KNNClassifier::countCorrect(
+    const FeatureDataset& testData,
+    std::size_t maxSamples,
+    bool showProgress,
+    unsigned int threads) const {
 
     const std::size_t limit = (maxSamples == 0) ? testData.size() : std::min(maxSamples, testData.size());
+    return evaluateQueries(
+        limit,
+        [&](std::size_t q, FeatureMatrix& block, std::size_t r) {
+            encodeQuery(testData.features.row(q), testData.cols(), block, r);
+        },
+        [&](std::size_t q) { return testData.labels[q]; },
+        showProgress,
+        threads);
+}
+
+template <typename EncodeQuery, typename LabelOf>
+std::size_t KNNClassifier::evaluateQueries(
+    std::size_t limit,
+    EncodeQuery encode,
+    LabelOf labelOf,
+    bool showProgress,
+    unsigned int threads) const {
+
+    if (referenceLabels.empty() || limit == 0) {
+        return 0;
+    }
 
-    int correct = 0;
     const std::size_t progressStep = std::max<std::size_t>(1, limit / 20);
 
-    for (std::size_t i = 0; i < limit; i++) {
-        const int prediction = predict(testData[i].features);
-        if (prediction == testData[i].label) {
-            correct++;
+    std::atomic<std::size_t> correct{0};
+    std::atomic<std::size_t> done{0};
+    std::mutex progressMutex;
+    std::size_t printed = 0; // guarded by progressMutex
+
+    struct Scratch {
+        FeatureMatrix block;
+        int predictions[queryBlockSize];
+        SearchScratch search;
+    };
+    std::vector<Scratch> scratch(resolveThreadCount(threads));
+
+    parallelFor(limit, queryBlockSize, threads, [&](std::size_t begin, std::size_t end, unsigned int worker) {
+        Scratch& local = scratch[worker];
+        if (local.block.empty()) {
+            local.block = FeatureMatrix(queryBlockSize, queryDim());
+        }
+
+        const std::size_t count = end - begin;
+        for (std::size_t q = 0; q < count; q++) {
+            encode(begin + q, local.block, q);
+        }
+
+        predictBlock(local.block, count, local.predictions, local.search);
+
+        std::size_t blockCorrect = 0;
+        for (std::size_t q = 0; q < count; q++) {
+            if (local.predictions[q] == labelOf(begin + q)) {
+                blockCorrect++;
+            }
         }
+        correct.fetch_add(blockCorrect, std::memory_order_relaxed);
 
-        if (showProgress && ((i + 1) % progressStep == 0 || i + 1 == limit)) {
-            const float progress = 100.0f * static_cast<float>(i + 1) / static_cast<float>(limit);
-            std::cout << "\rKNN eval progress: " << (i + 1) << "/" << limit
+        const std::size_t finished = done.fetch_add(count) + count;
+        const bool crossedStep = finished / progressStep != (finished - count) / progressStep;
+        if (!showProgress || !(crossedStep || finished == limit)) {
+            return;
+        }
+
+        // workers finish out of order: print the shared count, never a smaller one than before
+        std::lock_guard<std::mutex> lock(progressMutex);
+        const std::size_t shown = done.load();
+        if (shown > printed) {
+            printed = shown;
+            const float progress = 100.0f * static_cast<float>(shown) / static_cast<float>(limit);
+            std::cout << "\rKNN eval progress: " << shown << "/" << limit
                       << " (" << static_cast<int>(progress) << "%)" << std::flush;
         }
-    }
+    });
 
     if (showProgress) {
         std::cout << "\n";
     }
 
-    return static_cast<float>(correct) / static_cast<float>(limit);
+    return correct.load();
 }
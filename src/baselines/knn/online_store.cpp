@@ -0,0 +1,43 @@
+#include "baselines/knn/online_store.h"
+#include "baselines/knn/distance_kernels.h"
+
+#include <atomic>
+
+OnlineReferenceStore::Segment::Segment(std::size_t cols)
+    : features(segmentRows, cols), labels(segmentRows, 0), norms(segmentRows, 0.0f) {}
+
+OnlineReferenceStore::OnlineReferenceStore() {
+    reset(0);
+}
+
+void OnlineReferenceStore::reset(std::size_t cols) {
+    std::lock_guard<std::mutex> lock(appendMutex);
+    columnCount = cols;
+    std::atomic_store(&published, std::shared_ptr<const Snapshot>(std::make_shared<Snapshot>()));
+}
+
+void OnlineReferenceStore::append(const float* row, int label) {
+    std::lock_guard<std::mutex> lock(appendMutex);
+    const std::shared_ptr<const Snapshot> current = std::atomic_load(&published);
+
+    auto next = std::make_shared<Snapshot>(*current);
+    const std::size_t r = current->rows;
+    if (r % segmentRows == 0) {
+        next->segments.push_back(std::make_shared<Segment>(columnCount));
+    }
+
+    // the row is past every published count, no reader looks at it yet
+    Segment& segment = *next->segments.back();
+    const std::size_t slot = r % segmentRows;
+    segment.features.setRow(slot, row, columnCount);
+    segment.labels[slot] = label;
+    const float* stored = segment.features.row(slot);
+    segment.norms[slot] = dotProduct(stored, stored, segment.features.stride());
+
+    next->rows = r + 1;
+    std::atomic_store(&published, std::shared_ptr<const Snapshot>(std::move(next)));
+}
+
+std::shared_ptr<const OnlineReferenceStore::Snapshot> OnlineReferenceStore::snapshot() const {
+    return std::atomic_load(&published);
+}
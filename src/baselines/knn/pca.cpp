@@ -0,0 +1,406 @@
+#include "baselines/knn/pca.h"
+#include "baselines/knn/distance_kernels.h"
+#include "core/parallel_for.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <numeric>
+#include <ostream>
+#include <random>
+
+namespace {
+
+// covariance columns per tile: a tile of centered columns stays in L2 while another column streams over it
+constexpr std::size_t covarianceTile = 64;
+// samples per dot product; partial sums are carried in double across chunks
+constexpr std::size_t sampleChunk = 1024;
+
+// Householder reduction of the symmetric matrix in v (n x n, row-major) to tridiagonal
+// form: diagonal in d, subdiagonal in e[1..n-1]; v is replaced by the orthogonal transform.
+void tred2(std::vector<double>& v, std::vector<double>& d, std::vector<double>& e, std::size_t n) {
+    auto V = [&v, n](std::size_t row, std::size_t col) -> double& { return v[row * n + col]; };
+
+    for (std::size_t j = 0; j < n; j++) {
+        d[j] = V(n - 1, j);
+    }
+
+    for (std::size_t i = n - 1; i > 0; i--) {
+        double scale = 0.0;
+        double h = 0.0;
+        for (std::size_t k = 0; k < i; k++) {
+            scale += std::fabs(d[k]);
+        }
+
+        if (scale == 0.0) {
+            e[i] = d[i - 1];
+            for (std::size_t j = 0; j < i; j++) {
+                d[j] = V(i - 1, j);
+                V(i, j) = 0.0;
+                V(j, i) = 0.0;
+            }
+        } else {
+            for (std::size_t k = 0; k < i; k++) {
+                d[k] /= scale;
+                h += d[k] * d[k];
+            }
+
+            double f = d[i - 1];
+            double g = f > 0 ? -std::sqrt(h) : std::sqrt(h);
+            e[i] = scale * g;
+            h -= f * g;
+            d[i - 1] = f - g;
+            for (std::size_t j = 0; j < i; j++) {
+                e[j] = 0.0;
+            }
+
+            for (std::size_t j = 0; j < i; j++) {
+                f = d[j];
+                V(j, i) = f;
+                g = e[j] + V(j, j) * f;
+                for (std::size_t k = j + 1; k < i; k++) {
+                    g += V(k, j) * d[k];
+                    e[k] += V(k, j) * f;
+                }
+                e[j] = g;
+            }
+
+            f = 0.0;
+            for (std::size_t j = 0; j < i; j++) {
+                e[j] /= h;
+                f += e[j] * d[j];
+            }
+
+            const double hh = f / (h + h);
+            for (std::size_t j = 0; j < i; j++) {
+                e[j] -= hh * d[j];
+            }
+
+            for (std::size_t j = 0; j < i; j++) {
+                f = d[j];
+                g = e[j];
+                for (std::size_t k = j; k < i; k++) {
+                    V(k, j) -= f * e[k] + g * d[k];
+                }
+                d[j] = V(i - 1, j);
+                V(i, j) = 0.0;
+            }
+        }
+        d[i] = h;
+    }
+
+    // accumulate the transformations
+    for (std::size_t i = 0; i + 1 < n; i++) {
+        V(n - 1, i) = V(i, i);
+        V(i, i) = 1.0;
+        const double h = d[i + 1];
+        if (h != 0.0) {
+            for (std::size_t k = 0; k <= i; k++) {
+                d[k] = V(k, i + 1) / h;
+            }
+            for (std::size_t j = 0; j <= i; j++) {
+                double g = 0.0;
+                for (std::size_t k = 0; k <= i; k++) {
+                    g += V(k, i + 1) * V(k, j);
+                }
+                for (std::size_t k = 0; k <= i; k++) {
+                    V(k, j) -= g * d[k];
+                }
+            }
+        }
+        for (std::size_t k = 0; k <= i; k++) {
+            V(k, i + 1) = 0.0;
+        }
+    }
+
+    for (std::size_t j = 0; j < n; j++) {
+        d[j] = V(n - 1, j);
+        V(n - 1, j) = 0.0;
+    }
+    V(n - 1, n - 1) = 1.0;
+    e[0] = 0.0;
+}
+
+// Implicit QL iterations on the tridiagonal matrix from tred2(). Eigenvalues end up in d;
+// w holds the transform transposed (eigenvectors as rows), so every rotation walks two
+// contiguous rows instead of two strided columns.
+void tql2(std::vector<double>& w, std::vector<double>& d, std::vector<double>& e, std::size_t n) {
+    for (std::size_t i = 1; i < n; i++) {
+        e[i - 1] = e[i];
+    }
+    e[n - 1] = 0.0;
+
+    double f = 0.0;
+    double tst1 = 0.0;
+    const double eps = std::numeric_limits<double>::epsilon();
+
+    for (std::size_t l = 0; l < n; l++) {
+        tst1 = std::max(tst1, std::fabs(d[l]) + std::fabs(e[l]));
+        std::size_t m = l;
+        while (m < n && std::fabs(e[m]) > eps * tst1) {
+            m++;  // e[n - 1] is zero, so this stops at n - 1
+        }
+
+        if (m > l) {
+            do {
+                double g = d[l];
+                double p = (d[l + 1] - g) / (2.0 * e[l]);
+                double r = std::hypot(p, 1.0);
+                if (p < 0) {
+                    r = -r;
+                }
+                d[l] = e[l] / (p + r);
+                d[l + 1] = e[l] * (p + r);
+                const double dl1 = d[l + 1];
+                double h = g - d[l];
+                for (std::size_t i = l + 2; i < n; i++) {
+                    d[i] -= h;
+                }
+                f += h;
+
+                p = d[m];
+                double c = 1.0;
+                double c2 = c;
+                double c3 = c;
+                const double el1 = e[l + 1];
+                double s = 0.0;
+                double s2 = 0.0;
+
+                for (std::size_t i = m; i-- > l;) {
+                    c3 = c2;
+                    c2 = c;
+                    s2 = s;
+                    g = c * e[i];
+                    h = c * p;
+                    r = std::hypot(p, e[i]);
+                    e[i + 1] = s * r;
+                    s = e[i] / r;
+                    c = p / r;
+                    p = c * d[i] - s * g;
+                    d[i + 1] = h + s * (c * g + s * d[i]);
+
+                    double* rowI = w.data() + i * n;
+                    double* rowNext = rowI + n;
+                    for (std::size_t k = 0; k < n; k++) {
+                        const double next = rowNext[k];
+                        rowNext[k] = s * rowI[k] + c * next;
+                        rowI[k] = c * rowI[k] - s * next;
+                    }
+                }
+
+                p = -s * s2 * c3 * el1 * e[l] / dl1;
+                e[l] = s * p;
+                d[l] = c * p;
+            } while (std::fabs(e[l]) > eps * tst1);
+        }
+
+        d[l] += f;
+        e[l] = 0.0;
+    }
+}
+
+} // namespace
+
+PCAProjection::PCAProjection() {}
+
+void PCAProjection::clear() {
+    components = FeatureMatrix();
+    meanProjection.clear();
+    keptVariance = 0.0;
+}
+
+bool PCAProjection::fit(const FeatureMatrix& data, const PCAParams& params) {
+    clear();
+
+    const std::size_t dim = data.cols();
+    if (data.rows() < 2 || params.components <= 0 || static_cast<std::size_t>(params.components) >= dim) {
+        return false;
+    }
+
+    // training subset
+    std::vector<std::size_t> order(data.rows());
+    std::iota(order.begin(), order.end(), 0);
+    std::mt19937 rng(params.seed);
+    std::shuffle(order.begin(), order.end(), rng);
+    const std::size_t samples = std::min<std::size_t>(data.rows(), std::max(2, params.trainingSamples));
+
+    std::vector<double> mean(dim, 0.0);
+    for (std::size_t s = 0; s < samples; s++) {
+        const float* row = data.row(order[s]);
+        for (std::size_t j = 0; j < dim; j++) {
+            mean[j] += row[j];
+        }
+    }
+    for (double& value : mean) {
+        value /= static_cast<double>(samples);
+    }
+
+    // centered subset, transposed so every feature is one contiguous column
+    FeatureMatrix columns(dim, samples);
+    for (std::size_t s = 0; s < samples; s++) {
+        const float* row = data.row(order[s]);
+        for (std::size_t j = 0; j < dim; j++) {
+            columns.row(j)[s] = static_cast<float>(row[j] - mean[j]);
+        }
+    }
+
+    // upper-triangle tile pairs, each filled (and mirrored) by one worker
+    const std::size_t tiles = (dim + covarianceTile - 1) / covarianceTile;
+    std::vector<std::pair<std::size_t, std::size_t>> tilePairs;
+    for (std::size_t a = 0; a < tiles; a++) {
+        for (std::size_t b = a; b < tiles; b++) {
+            tilePairs.emplace_back(a, b);
+        }
+    }
+
+    std::vector<double> covariance(dim * dim, 0.0);
+    const double normalization = 1.0 / static_cast<double>(samples - 1);
+
+    parallelFor(tilePairs.size(), 1, params.threads, [&](std::size_t begin, std::size_t end, unsigned int) {
+        std::vector<float> dots(covarianceTile);
+        std::vector<double> sums(covarianceTile * covarianceTile);
+
+        for (std::size_t p = begin; p < end; p++) {
+            const std::size_t rowStart = tilePairs[p].first * covarianceTile;
+            const std::size_t colStart = tilePairs[p].second * covarianceTile;
+            const std::size_t rowCount = std::min(covarianceTile, dim - rowStart);
+            const std::size_t colCount = std::min(covarianceTile, dim - colStart);
+            std::fill(sums.begin(), sums.end(), 0.0);
+
+            for (std::size_t chunk = 0; chunk < samples; chunk += sampleChunk) {
+                const std::size_t length = std::min(sampleChunk, samples - chunk);
+                for (std::size_t i = 0; i < rowCount; i++) {
+                    dotProductRows(columns.row(rowStart + i) + chunk, columns.row(colStart) + chunk,
+                                   columns.stride(), colCount, length, dots.data());
+                    for (std::size_t j = 0; j < colCount; j++) {
+                        sums[i * covarianceTile + j] += dots[j];
+                    }
+                }
+            }
+
+            for (std::size_t i = 0; i < rowCount; i++) {
+                for (std::size_t j = 0; j < colCount; j++) {
+                    const double value = sums[i * covarianceTile + j] * normalization;
+                    covariance[(rowStart + i) * dim + colStart + j] = value;
+                    covariance[(colStart + j) * dim + rowStart + i] = value;
+                }
+            }
+        }
+    });
+
+    std::vector<double> eigenvalues(dim);
+    std::vector<double> offDiagonal(dim);
+    tred2(covariance, eigenvalues, offDiagonal, dim);
+
+    // the transform's columns become rows for tql2
+    for (std::size_t i = 0; i < dim; i++) {
+        for (std::size_t j = i + 1; j < dim; j++) {
+            std::swap(covariance[i * dim + j], covariance[j * dim + i]);
+        }
+    }
+    tql2(covariance, eigenvalues, offDiagonal, dim);
+
+    std::vector<std::size_t> ranking(dim);
+    std::iota(ranking.begin(), ranking.end(), 0);
+    std::sort(ranking.begin(), ranking.end(), [&eigenvalues](std::size_t a, std::size_t b) {
+        return eigenvalues[a] > eigenvalues[b];
+    });
+
+    double totalVariance = 0.0;
+    for (const double value : eigenvalues) {
+        totalVariance += std::max(0.0, value);
+    }
+
+    const std::size_t outputDim = params.components;
+    components = FeatureMatrix(outputDim, dim);
+    meanProjection.assign(outputDim, 0.0f);
+    double kept = 0.0;
+
+    for (std::size_t c = 0; c < outputDim; c++) {
+        const double* vector = covariance.data() + ranking[c] * dim;
+        kept += std::max(0.0, eigenvalues[ranking[c]]);
+
+        // eigenvectors are defined up to sign: make the largest entry positive so refits agree
+        const double* largest = std::max_element(vector, vector + dim, [](double a, double b) {
+            return std::fabs(a) < std::fabs(b);
+        });
+        const double sign = *largest < 0 ? -1.0 : 1.0;
+
+        float* out = components.row(c);
+        double offset = 0.0;
+        for (std::size_t j = 0; j < dim; j++) {
+            out[j] = static_cast<float>(sign * vector[j]);
+            offset += out[j] * mean[j];
+        }
+        meanProjection[c] = static_cast<float>(offset);
+    }
+
+    keptVariance = totalVariance > 0.0 ? kept / totalVariance : 0.0;
+    return true;
+}
+
+void PCAProjection::project(const float* features, std::size_t count, float* out) const {
+    dotProductRows(features, components.row(0), components.stride(), outputDim(), std::min(count, inputDim()), out);
+    for (std::size_t c = 0; c < outputDim(); c++) {
+        out[c] -= meanProjection[c];
+    }
+}
+
+bool PCAProjection::write(std::ostream& out) const {
+    const std::uint64_t header[2] = {outputDim(), inputDim()};
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(&keptVariance), sizeof(keptVariance));
+    out.write(reinterpret_cast<const char*>(meanProjection.data()), meanProjection.size() * sizeof(float));
+    for (std::size_t c = 0; c < outputDim(); c++) {
+        out.write(reinterpret_cast<const char*>(components.row(c)), inputDim() * sizeof(float));
+    }
+    return static_cast<bool>(out);
+}
+
+bool PCAProjection::read(std::istream& in, std::uint64_t bytes, std::size_t inputDim, std::size_t outputDim) {
+    clear();
+
+    std::uint64_t header[2] = {};
+    double variance = 0.0;
+    constexpr std::uint64_t headerBytes = sizeof(header) + sizeof(variance);
+    if (bytes < headerBytes) {
+        return false;
+    }
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    in.read(reinterpret_cast<char*>(&variance), sizeof(variance));
+    if (!in || header[0] > header[1]) {
+        return false;
+    }
+
+    if (header[0] == 0) {
+        return true;  // written without a projection
+    }
+
+    // outputDim rows of inputDim floats plus one offset per row, within the block
+    const std::uint64_t left = bytes - headerBytes;
+    const bool valid = (inputDim == 0 || header[1] == inputDim)
+        && (outputDim == 0 || header[0] == outputDim)
+        && header[1] <= left / sizeof(float)
+        && header[0] <= left / ((header[1] + 1) * sizeof(float));
+    if (!valid) {
+        return false;
+    }
+
+    FeatureMatrix loaded(header[0], header[1]);
+    std::vector<float> offsets(header[0]);
+    in.read(reinterpret_cast<char*>(offsets.data()), offsets.size() * sizeof(float));
+    for (std::size_t c = 0; c < header[0]; c++) {
+        in.read(reinterpret_cast<char*>(loaded.row(c)), header[1] * sizeof(float));
+    }
+
+    if (!in) {
+        return false;
+    }
+
+    components = std::move(loaded);
+    meanProjection = std::move(offsets);
+    keptVariance = variance;
+    return true;
+}
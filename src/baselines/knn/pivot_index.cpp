@@ -0,0 +1,160 @@
+#include "baselines/knn/pivot_index.h"
+#include "baselines/knn/distance_kernels.h"
+#include "core/parallel_for.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+
+namespace {
+
+// rows per parallelFor chunk when filling a pivot column
+constexpr std::size_t buildGrain = 1024;
+// float rounding of the stored and query-side distances, relative to the largest query-pivot distance;
+// bounds are lowered by it so a true neighbor is never pruned
+constexpr float boundSlack = 1e-4f;
+
+// the triangle inequality needs the true distance, not its square
+float euclideanDistance(const float* a, const float* b, std::size_t n) {
+    return std::sqrt(squaredL2Distance(a, b, n));
+}
+
+} // namespace
+
+PivotIndex::PivotIndex() {}
+
+void PivotIndex::clear() {
+    rowCount = 0;
+    pivotRows.clear();
+    pivotDistances.clear();
+}
+
+void PivotIndex::build(const FeatureMatrix& data, const PivotParams& buildParams) {
+    clear();
+    params = buildParams;
+
+    const std::size_t rows = data.rows();
+    const std::size_t pivots = std::min<std::size_t>(std::max(0, params.pivots), rows);
+    if (rows == 0 || pivots == 0) {
+        return;
+    }
+
+    const std::size_t stride = data.stride();
+    std::vector<float> nearestPivot(rows, std::numeric_limits<float>::infinity());
+    pivotDistances.reserve(pivots * rows);
+
+    // farthest-first: every new pivot is the row furthest from all pivots so far
+    std::mt19937 rng(params.seed);
+    std::size_t next = rng() % rows;
+
+    while (pivotRows.size() < pivots) {
+        const float* pivot = data.row(next);
+        pivotRows.push_back(static_cast<int>(next));
+        pivotDistances.resize(pivotRows.size() * rows);
+        float* column = pivotDistances.data() + (pivotRows.size() - 1) * rows;
+
+        parallelFor(rows, buildGrain, 0, [&](std::size_t begin, std::size_t end, unsigned int) {
+            for (std::size_t i = begin; i < end; i++) {
+                column[i] = euclideanDistance(data.row(i), pivot, stride);
+                nearestPivot[i] = std::min(nearestPivot[i], column[i]);
+            }
+        });
+
+        next = static_cast<std::size_t>(std::max_element(nearestPivot.begin(), nearestPivot.end()) - nearestPivot.begin());
+        if (nearestPivot[next] <= 0.0f) {
+            break;  // every row coincides with a pivot
+        }
+    }
+
+    rowCount = rows;
+}
+
+void PivotIndex::search(
+    const FeatureMatrix& data,
+    const float* query,
+    KNearestList& result,
+    PivotSearchScratch& scratch,
+    KNNSearchStats* stats) const {
+
+    result.clear();
+    if (rowCount == 0) {
+        return;
+    }
+
+    constexpr float scored = std::numeric_limits<float>::infinity();
+    const std::size_t stride = data.stride();
+    const std::size_t pivots = pivotRows.size();
+    std::size_t fullDistances = 0;
+
+    // bounds[i] = max over pivots of |d(q, p) - d(x_i, p)|; `scored` marks rows already in the result
+    std::vector<float>& bounds = scratch.bounds;
+    bounds.assign(rowCount, 0.0f);
+    float largestDistance = 0.0f;
+
+    for (std::size_t j = 0; j < pivots; j++) {
+        const float squared = squaredL2Distance(query, data.row(pivotRows[j]), stride);
+        const float distance = std::sqrt(squared);
+        largestDistance = std::max(largestDistance, distance);
+
+        const float* column = pivotDistances.data() + j * rowCount;
+        for (std::size_t i = 0; i < rowCount; i++) {
+            bounds[i] = std::max(bounds[i], std::fabs(distance - column[i]));
+        }
+
+        result.push(pivotRows[j], squared);
+        fullDistances++;
+    }
+
+    for (const int pivot : pivotRows) {
+        bounds[pivot] = scored;
+    }
+
+    const float slack = boundSlack * largestDistance;
+
+    // the rows with the smallest bounds are the likely neighbors: scoring them first
+    // tightens the k-th distance before the scan
+    const std::size_t seedCount = std::min<std::size_t>(
+        rowCount, static_cast<std::size_t>(std::max(0, params.seedFactor)) * result.capacity());
+    if (seedCount > 0) {
+        std::vector<int>& order = scratch.order;
+        order.resize(rowCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::nth_element(order.begin(), order.begin() + (seedCount - 1), order.end(),
+                         [&](int a, int b) { return bounds[a] < bounds[b]; });
+
+        for (std::size_t s = 0; s < seedCount; s++) {
+            const int row = order[s];
+            if (bounds[row] == scored) {
+                continue;
+            }
+
+            result.push(row, squaredL2Distance(query, data.row(row), stride));
+            bounds[row] = scored;
+            fullDistances++;
+        }
+    }
+
+    float bound = result.bound();
+    float radius = std::sqrt(bound);
+
+    for (std::size_t i = 0; i < rowCount; i++) {
+        if (bounds[i] - slack >= radius) {
+            continue;  // also skips the rows scored above
+        }
+
+        const float distance = squaredL2DistanceBounded(query, data.row(i), stride, bound);
+        fullDistances++;
+        if (distance < bound) {
+            result.push(static_cast<int>(i), distance);
+            bound = result.bound();
+            radius = std::sqrt(bound);
+        }
+    }
+
+    if (stats) {
+        stats->candidates += rowCount;
+        stats->fullDistances += fullDistances;
+    }
+}
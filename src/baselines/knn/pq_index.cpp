@@ -0,0 +1,180 @@
+#include "baselines/knn/pq_index.h"
+#include "baselines/knn/distance_kernels.h"
+#include "baselines/knn/kmeans.h"
+
+#include <algorithm>
+#include <istream>
+#include <numeric>
+#include <ostream>
+#include <random>
+
+PQIndex::PQIndex() {}
+
+void PQIndex::clear() {
+    rowCount = 0;
+    dim = 0;
+    subDim = 0;
+    codebooks.clear();
+    codes.clear();
+}
+
+std::size_t PQIndex::memoryBytes() const {
+    return codes.size() + codebooks.size() * sizeof(float);
+}
+
+void PQIndex::build(const FeatureMatrix& data, const PQParams& buildParams) {
+    clear();
+    params = buildParams;
+    params.subspaces = std::max(1, params.subspaces);
+
+    if (data.empty()) {
+        return;
+    }
+
+    rowCount = data.rows();
+    dim = data.cols();
+    subDim = (dim + params.subspaces - 1) / params.subspaces;
+
+    const std::size_t subspaces = params.subspaces;
+    const std::size_t paddedDim = subspaces * subDim;
+
+    // training subset, copied into a zero-padded buffer so every chunk has subDim values
+    std::vector<std::size_t> order(rowCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::mt19937 rng(params.seed);
+    std::shuffle(order.begin(), order.end(), rng);
+
+    const std::size_t trainRows = std::min<std::size_t>(rowCount, std::max(params.trainingSamples, centroidCount));
+    std::vector<float> training(trainRows * paddedDim, 0.0f);
+    for (std::size_t i = 0; i < trainRows; i++) {
+        const float* row = data.row(order[i]);
+        std::copy(row, row + dim, training.begin() + i * paddedDim);
+    }
+
+    codebooks.assign(subspaces * centroidCount * subDim, 0.0f);
+    std::vector<KMeansResult> quantizers(subspaces);
+
+    for (std::size_t s = 0; s < subspaces; s++) {
+        quantizers[s] = kmeans(
+            training.data() + s * subDim, trainRows, subDim, paddedDim,
+            centroidCount, params.iterations, params.seed + static_cast<unsigned int>(s));
+        std::copy(
+            quantizers[s].centroids.begin(), quantizers[s].centroids.end(),
+            codebooks.begin() + s * centroidCount * subDim);
+    }
+
+    // encode every row
+    codes.assign(rowCount * subspaces, 0);
+    std::vector<float> padded(paddedDim, 0.0f);
+
+    for (std::size_t i = 0; i < rowCount; i++) {
+        const float* row = data.row(i);
+        std::copy(row, row + dim, padded.begin());
+
+        for (std::size_t s = 0; s < subspaces; s++) {
+            codes[i * subspaces + s] = static_cast<std::uint8_t>(
+                nearestCentroid(quantizers[s], padded.data() + s * subDim));
+        }
+    }
+}
+
+void PQIndex::buildDistanceTable(const float* query, std::vector<float>& table) const {
+    const std::size_t subspaces = params.subspaces;
+    std::vector<float> padded(subspaces * subDim, 0.0f);
+    std::copy(query, query + dim, padded.begin());
+
+    table.resize(subspaces * centroidCount);
+    for (std::size_t s = 0; s < subspaces; s++) {
+        const float* chunk = padded.data() + s * subDim;
+        const float* centroids = codebooks.data() + s * centroidCount * subDim;
+
+        for (int c = 0; c < centroidCount; c++) {
+            table[s * centroidCount + c] = squaredL2Distance(chunk, centroids + c * subDim, subDim);
+        }
+    }
+}
+
+void PQIndex::search(const float* query, KNearestList& result) const {
+    result.clear();
+    if (empty()) {
+        return;
+    }
+
+    std::vector<float> table;
+    buildDistanceTable(query, table);
+
+    const std::size_t subspaces = params.subspaces;
+    const std::uint8_t* code = codes.data();
+
+    for (std::size_t i = 0; i < rowCount; i++, code += subspaces) {
+        const float bound = result.bound();
+        float distance = 0.0f;
+
+        // one table lookup per code byte; stop once the row cannot make the list
+        for (std::size_t s = 0; s < subspaces && distance < bound; s++) {
+            distance += table[s * centroidCount + code[s]];
+        }
+
+        if (distance < bound) {
+            result.push(static_cast<int>(i), distance);
+        }
+    }
+}
+
+bool PQIndex::write(std::ostream& out) const {
+    const std::uint64_t header[4] = {rowCount, dim, static_cast<std::uint64_t>(params.subspaces), subDim};
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(codebooks.data()), codebooks.size() * sizeof(float));
+    out.write(reinterpret_cast<const char*>(codes.data()), codes.size());
+    return static_cast<bool>(out);
+}
+
+bool PQIndex::read(std::istream& in) {
+    clear();
+
+    std::uint64_t header[4] = {};
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!in) {
+        return false;
+    }
+
+    // every size comes from the file: bound each one by the bytes that are left, dividing
+    // rather than multiplying so that no corrupt value can wrap around, before allocating
+    const std::istream::pos_type start = in.tellg();
+    in.seekg(0, std::ios::end);
+    const std::istream::pos_type end = in.tellg();
+    in.seekg(start);
+    if (start < 0 || end < start) {
+        return false;
+    }
+    const std::uint64_t left = static_cast<std::uint64_t>(end - start);
+    const std::uint64_t codebookRowBytes = centroidCount * sizeof(float);
+
+    const std::uint64_t subspaces = header[2];
+    const bool valid = subspaces != 0
+        && subspaces <= left / codebookRowBytes
+        && header[3] != 0
+        && header[3] <= left / (subspaces * codebookRowBytes)
+        && header[1] <= subspaces * header[3]
+        && header[0] <= (left - subspaces * codebookRowBytes * header[3]) / subspaces;
+    if (!valid) {
+        return false;
+    }
+
+    rowCount = header[0];
+    dim = header[1];
+    params.subspaces = static_cast<int>(subspaces);
+    subDim = header[3];
+
+    codebooks.resize(params.subspaces * centroidCount * subDim);
+    codes.resize(rowCount * params.subspaces);
+    in.read(reinterpret_cast<char*>(codebooks.data()), codebooks.size() * sizeof(float));
+    in.read(reinterpret_cast<char*>(codes.data()), codes.size());
+
+    if (!in) {
+        clear();
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,219 @@
+#include "baselines/knn/prototype_selection.h"
+#include "baselines/common/feature_matrix.h"
+#include "baselines/knn/distance_kernels.h"
+#include "baselines/knn/k_nearest_list.h"
+#include "baselines/knn/knn_classifier.h"
+#include "core/parallel_for.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <unordered_set>
+
+namespace {
+
+// queries per parallelFor chunk for the full leave-one-out scans
+constexpr std::size_t editGrain = 16;
+
+FeatureMatrix toMatrix(const std::vector<TrainingSample>& samples) {
+    std::size_t featureDim = 0;
+    for (const auto& sample : samples) {
+        featureDim = std::max(featureDim, sample.features.size());
+    }
+
+    FeatureMatrix matrix(samples.size(), featureDim);
+    for (std::size_t i = 0; i < samples.size(); i++) {
+        matrix.setRow(i, samples[i].features.data(), samples[i].features.size());
+    }
+    return matrix;
+}
+
+// Wilson editing: keep a sample only if the vote of its k nearest other samples agrees with its label
+std::vector<std::size_t> editSamples(
+    const std::vector<TrainingSample>& samples,
+    const FeatureMatrix& features,
+    int k,
+    unsigned int threads) {
+
+    const std::size_t rows = features.rows();
+    const std::size_t stride = features.stride();
+    std::vector<char> keep(rows, 0);
+
+    parallelFor(rows, editGrain, threads, [&](std::size_t begin, std::size_t end, unsigned int) {
+        KNearestList best(k);
+        std::vector<std::pair<int, float>> neighbors;
+
+        for (std::size_t i = begin; i < end; i++) {
+            const float* query = features.row(i);
+            best.clear();
+
+            for (std::size_t j = 0; j < rows; j++) {
+                if (j == i) {
+                    continue;
+                }
+
+                const float bound = best.bound();
+                const float distance = squaredL2DistanceBounded(query, features.row(j), stride, bound);
+                if (distance < bound) {
+                    best.push(static_cast<int>(j), distance);
+                }
+            }
+
+            neighbors.clear();
+            for (const auto& [row, distance] : best) {
+                neighbors.emplace_back(samples[row].label, distance);
+            }
+            keep[i] = KNNClassifier::vote(neighbors) == samples[i].label;
+        }
+    });
+
+    std::vector<std::size_t> kept;
+    for (std::size_t i = 0; i < rows; i++) {
+        if (keep[i]) {
+            kept.push_back(i);
+        }
+    }
+    return kept;
+}
+
+// Hart's condensed nearest neighbour. Candidates are classified in batches against
+// the store as it was at the start of the batch (in parallel); the serial step then
+// only has to look at the rows added earlier in the same batch.
+std::vector<std::size_t> condenseSamples(
+    const std::vector<TrainingSample>& samples,
+    const FeatureMatrix& features,
+    const std::vector<std::size_t>& candidates,
+    const PrototypeSelectionParams& params,
+    int& passes) {
+
+    const std::size_t stride = features.stride();
+
+    std::vector<std::size_t> order = candidates;
+    std::mt19937 rng(params.seed);
+    std::shuffle(order.begin(), order.end(), rng);
+
+    FeatureMatrix store(order.size(), features.cols());
+    std::vector<int> storeLabels;
+    std::vector<std::size_t> kept;
+
+    auto addToStore = [&](std::size_t sample) {
+        store.setRow(kept.size(), features.row(sample), features.cols());
+        storeLabels.push_back(samples[sample].label);
+        kept.push_back(sample);
+    };
+
+    // seed the store with one sample of every class
+    std::unordered_set<int> seenLabels;
+    std::vector<std::size_t> pending;
+    for (const std::size_t sample : order) {
+        if (seenLabels.insert(samples[sample].label).second) {
+            addToStore(sample);
+        } else {
+            pending.push_back(sample);
+        }
+    }
+
+    const std::size_t batchSize = std::max<std::size_t>(1, params.batchSize);
+    std::vector<float> nearestDistance(batchSize);
+    std::vector<int> nearestLabel(batchSize);
+
+    for (passes = 0; passes < params.maxCondensePasses && !pending.empty();) {
+        passes++;
+        std::vector<std::size_t> absorbed;
+        std::size_t added = 0;
+
+        for (std::size_t batchStart = 0; batchStart < pending.size(); batchStart += batchSize) {
+            const std::size_t count = std::min(batchSize, pending.size() - batchStart);
+            const std::size_t fixedRows = kept.size();
+
+            parallelFor(count, editGrain, params.threads, [&](std::size_t begin, std::size_t end, unsigned int) {
+                for (std::size_t q = begin; q < end; q++) {
+                    const float* query = features.row(pending[batchStart + q]);
+                    float best = std::numeric_limits<float>::infinity();
+                    int label = -1;
+
+                    for (std::size_t r = 0; r < fixedRows; r++) {
+                        const float distance = squaredL2DistanceBounded(query, store.row(r), stride, best);
+                        if (distance < best) {
+                            best = distance;
+                            label = storeLabels[r];
+                        }
+                    }
+
+                    nearestDistance[q] = best;
+                    nearestLabel[q] = label;
+                }
+            });
+
+            for (std::size_t q = 0; q < count; q++) {
+                const std::size_t sample = pending[batchStart + q];
+                const float* query = features.row(sample);
+                float best = nearestDistance[q];
+                int label = nearestLabel[q];
+
+                for (std::size_t r = fixedRows; r < kept.size(); r++) {
+                    const float distance = squaredL2DistanceBounded(query, store.row(r), stride, best);
+                    if (distance < best) {
+                        best = distance;
+                        label = storeLabels[r];
+                    }
+                }
+
+                if (label != samples[sample].label) {
+                    addToStore(sample);
+                    added++;
+                } else {
+                    absorbed.push_back(sample);
+                }
+            }
+        }
+
+        pending = std::move(absorbed);
+        if (added == 0) {
+            break;
+        }
+    }
+
+    return kept;
+}
+
+} // namespace
+
+std::vector<std::size_t> selectPrototypes(
+    const std::vector<TrainingSample>& samples,
+    const PrototypeSelectionParams& params,
+    PrototypeSelectionStats* stats) {
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::size_t> kept(samples.size());
+    std::iota(kept.begin(), kept.end(), 0);
+
+    const FeatureMatrix features = toMatrix(samples);
+    PrototypeSelectionStats result;
+    result.original = samples.size();
+
+    if (params.edit && params.editK > 0 && samples.size() > static_cast<std::size_t>(params.editK)) {
+        std::vector<std::size_t> edited = editSamples(samples, features, params.editK, params.threads);
+        // a set where every sample looks like noise is better left alone
+        if (!edited.empty()) {
+            kept = std::move(edited);
+        }
+    }
+    result.edited = kept.size();
+
+    if (params.condense && !kept.empty()) {
+        kept = condenseSamples(samples, features, kept, params, result.condensePasses);
+        std::sort(kept.begin(), kept.end());
+    }
+    result.condensed = kept.size();
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (stats) {
+        *stats = result;
+    }
+
+    return kept;
+}
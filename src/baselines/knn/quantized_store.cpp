@@ -0,0 +1,177 @@
+#include "baselines/knn/quantized_store.h"
+#include "baselines/knn/distance_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <numeric>
+
+namespace {
+
+// int16 values per SIMD vector, every int16 group is padded to a multiple of it
+constexpr std::size_t int16Lane = 16;
+constexpr long maxInt16 = 32767;
+
+std::size_t roundUp(std::size_t value, std::size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+long quantizeValue(float value, float scale, long maxValue) {
+    return std::clamp(std::lround(value * scale), 0L, maxValue);
+}
+
+} // namespace
+
+void QuantizedFeatureStore::AlignedDeleter::operator()(std::uint8_t* ptr) const {
+    std::free(ptr);
+}
+
+QuantizedFeatureStore::QuantizedFeatureStore() {}
+
+bool QuantizedFeatureStore::supports(const KNNFeatureLayout& layout) {
+    if (!layout.valid() || layout.pixelCount() > 65536) {
+        return false;
+    }
+
+    // largest zone, row and column sums in pixel units
+    return layout.zonePixels() * 255L <= maxInt16
+        && layout.width * 255L <= maxInt16
+        && layout.height * 255L <= maxInt16;
+}
+
+bool QuantizedFeatureStore::reset(const KNNFeatureLayout& layout, std::size_t rows) {
+    clear();
+    if (!supports(layout)) {
+        return false;
+    }
+
+    featureLayout = layout;
+
+    pixelBytes = roundUp(layout.pixelCount(), alignment);
+    zoneValues = roundUp(layout.zoneCount(), int16Lane);
+    rowSumValues = roundUp(layout.height, int16Lane);
+    columnSumValues = roundUp(layout.width, int16Lane);
+
+    zoneOffset = pixelBytes;
+    rowSumOffset = zoneOffset + zoneValues * sizeof(std::int16_t);
+    columnSumOffset = rowSumOffset + rowSumValues * sizeof(std::int16_t);
+    rowStride = roundUp(columnSumOffset + columnSumValues * sizeof(std::int16_t), alignment);
+
+    // float features are value / (255 * n) with n = 1, zonePixels, width or height pixels;
+    // scaling every group by its own n, then dividing out the common factor, keeps the weights small
+    const Distance zonePixels = layout.zonePixels();
+    const Distance width = layout.width;
+    const Distance height = layout.height;
+    const Distance common = zonePixels * width * height;
+    const Distance divisor = std::gcd(std::gcd(common, width * height), std::gcd(zonePixels * height, zonePixels * width));
+
+    const Distance pixelScale = common / divisor;
+    pixelWeight = pixelScale * pixelScale;
+    zoneWeight = (width * height / divisor) * (width * height / divisor);
+    rowSumWeight = (zonePixels * height / divisor) * (zonePixels * height / divisor);
+    columnSumWeight = (zonePixels * width / divisor) * (zonePixels * width / divisor);
+
+    const double unit = 255.0 * static_cast<double>(pixelScale);
+    floatScale = 1.0 / (unit * unit);
+
+    rowCount = rows;
+    const std::size_t bytes = rowCount * rowStride;
+    if (bytes == 0) {
+        return true;
+    }
+
+    auto* raw = static_cast<std::uint8_t*>(std::aligned_alloc(alignment, bytes));
+    if (!raw) {
+        throw std::bad_alloc();
+    }
+
+    std::memset(raw, 0, bytes);
+    values.reset(raw);
+    return true;
+}
+
+void QuantizedFeatureStore::clear() {
+    values.reset();
+    rowCount = 0;
+    rowStride = 0;
+}
+
+void QuantizedFeatureStore::setRow(std::size_t r, const float* features, std::size_t count) {
+    quantize(features, count, values.get() + r * rowStride);
+}
+
+void QuantizedFeatureStore::quantize(const float* features, std::size_t count, std::uint8_t* out) const {
+    std::memset(out, 0, rowStride);
+
+    const std::size_t pixels = featureLayout.pixelCount();
+    const std::size_t zones = featureLayout.zoneCount();
+    const std::size_t height = featureLayout.height;
+    const std::size_t dimensions = std::min<std::size_t>(count, featureLayout.dimensions());
+
+    auto* zoneSums = reinterpret_cast<std::int16_t*>(out + zoneOffset);
+    auto* rowSums = reinterpret_cast<std::int16_t*>(out + rowSumOffset);
+    auto* columnSums = reinterpret_cast<std::int16_t*>(out + columnSumOffset);
+
+    const float zoneScale = 255.0f * featureLayout.zonePixels();
+    const float rowScale = 255.0f * featureLayout.width;
+    const float columnScale = 255.0f * featureLayout.height;
+
+    for (std::size_t i = 0; i < dimensions; i++) {
+        const float value = features[i];
+
+        if (i < pixels) {
+            out[i] = static_cast<std::uint8_t>(quantizeValue(value, 255.0f, 255));
+        } else if (i < pixels + zones) {
+            zoneSums[i - pixels] = static_cast<std::int16_t>(quantizeValue(value, zoneScale, maxInt16));
+        } else if (i < pixels + zones + height) {
+            rowSums[i - pixels - zones] = static_cast<std::int16_t>(quantizeValue(value, rowScale, maxInt16));
+        } else {
+            columnSums[i - pixels - zones - height] = static_cast<std::int16_t>(quantizeValue(value, columnScale, maxInt16));
+        }
+    }
+}
+
+QuantizedFeatureStore::Distance QuantizedFeatureStore::distance(const std::uint8_t* a, const std::uint8_t* b) const {
+    auto sums = [](const std::uint8_t* row, std::size_t offset) {
+        return reinterpret_cast<const std::int16_t*>(row + offset);
+    };
+
+    return pixelWeight * squaredDistanceU8(a, b, pixelBytes)
+        + zoneWeight * squaredDistanceI16(sums(a, zoneOffset), sums(b, zoneOffset), zoneValues)
+        + rowSumWeight * squaredDistanceI16(sums(a, rowSumOffset), sums(b, rowSumOffset), rowSumValues)
+        + columnSumWeight * squaredDistanceI16(sums(a, columnSumOffset), sums(b, columnSumOffset), columnSumValues);
+}
+
+void QuantizedFeatureStore::search(const std::uint8_t* query, NearestList& best) const {
+    const auto* queryZones = reinterpret_cast<const std::int16_t*>(query + zoneOffset);
+    const auto* queryRows = reinterpret_cast<const std::int16_t*>(query + rowSumOffset);
+    const auto* queryColumns = reinterpret_cast<const std::int16_t*>(query + columnSumOffset);
+
+    for (std::size_t i = 0; i < rowCount; i++) {
+        const std::uint8_t* candidate = row(i);
+        const Distance bound = best.bound();
+
+        // pixels dominate the distance, skip the sums once they alone are too far
+        Distance total = pixelWeight * squaredDistanceU8(query, candidate, pixelBytes);
+        if (total >= bound) {
+            continue;
+        }
+
+        total += zoneWeight * squaredDistanceI16(
+            queryZones, reinterpret_cast<const std::int16_t*>(candidate + zoneOffset), zoneValues);
+        total += rowSumWeight * squaredDistanceI16(
+            queryRows, reinterpret_cast<const std::int16_t*>(candidate + rowSumOffset), rowSumValues);
+        total += columnSumWeight * squaredDistanceI16(
+            queryColumns, reinterpret_cast<const std::int16_t*>(candidate + columnSumOffset), columnSumValues);
+
+        if (total < bound) {
+            best.push(static_cast<int>(i), total);
+        }
+    }
+}
+
+float QuantizedFeatureStore::toFloatDistance(Distance distance) const {
+    return static_cast<float>(static_cast<double>(distance) * floatScale);
+}
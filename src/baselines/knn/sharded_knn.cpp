@@ -0,0 +1,405 @@
+#include "baselines/knn/sharded_knn.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::uint32_t shardMagic = 0x44524853; // "SHRD"
+
+// coordinator batches are split so a request and its reply stay a few MB
+constexpr std::size_t queriesPerRequest = 1024;
+// sanity limits on what a server accepts
+constexpr std::uint64_t maxRequestQueries = 1 << 16;
+constexpr std::uint64_t maxRequestDim = 1 << 20;
+
+enum ShardOp : std::uint32_t {
+    shardHello = 1,    // reply: ShardHello
+    shardSearch = 2,   // count x dim floats follow; reply: count x k ShardNeighbor
+    shardShutdown = 3  // no reply, the server stops
+};
+
+// native byte order, both ends run on the same host
+struct ShardRequest {
+    std::uint32_t magic;
+    std::uint32_t op;
+    std::uint64_t count;
+    std::uint64_t dim;
+};
+
+struct ShardHello {
+    std::uint64_t rows;
+    std::uint32_t k;
+    std::uint32_t featureDim;
+};
+
+struct ShardNeighbor {
+    std::int32_t row;  // local to the shard, -1 = unused slot
+    std::int32_t label;
+    float distance;
+};
+
+bool sendAll(int fd, const void* data, std::size_t bytes) {
+    const char* bytePtr = static_cast<const char*>(data);
+    while (bytes > 0) {
+        // MSG_NOSIGNAL: a shard that went away is an error return, not SIGPIPE
+        const ssize_t sent = ::send(fd, bytePtr, bytes, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        bytePtr += sent;
+        bytes -= static_cast<std::size_t>(sent);
+    }
+    return true;
+}
+
+bool receiveAll(int fd, void* data, std::size_t bytes) {
+    char* bytePtr = static_cast<char*>(data);
+    while (bytes > 0) {
+        const ssize_t received = ::recv(fd, bytePtr, bytes, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        bytePtr += received;
+        bytes -= static_cast<std::size_t>(received);
+    }
+    return true;
+}
+
+bool socketAddress(const std::string& path, sockaddr_un& address) {
+    address = sockaddr_un{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path too long: " << path << "\n";
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+} // namespace
+
+KNNShardServer::KNNShardServer(const KNNClassifier& classifier, unsigned int threads)
+    : classifier(classifier), threads(threads) {}
+
+KNNShardServer::~KNNShardServer() {
+    close();
+}
+
+bool KNNShardServer::listen(const std::string& socketPath) {
+    close();
+
+    sockaddr_un address;
+    if (!socketAddress(socketPath, address)) {
+        return false;
+    }
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        std::cerr << "Cannot create socket for " << socketPath << "\n";
+        return false;
+    }
+
+    ::unlink(socketPath.c_str());
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, 4) != 0) {
+        std::cerr << "Cannot listen on " << socketPath << ": " << std::strerror(errno) << "\n";
+        ::close(fd);
+        return false;
+    }
+
+    listenFd = fd;
+    boundPath = socketPath;
+    return true;
+}
+
+void KNNShardServer::close() {
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        ::unlink(boundPath.c_str());
+        listenFd = -1;
+        boundPath.clear();
+    }
+}
+
+bool KNNShardServer::serve() {
+    if (listenFd < 0) {
+        return false;
+    }
+
+    bool shutdown = false;
+    while (!shutdown) {
+        const int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Shard accept failed: " << std::strerror(errno) << "\n";
+            return false;
+        }
+
+        while (handleRequest(fd, shutdown)) {
+        }
+        ::close(fd);
+    }
+
+    return true;
+}
+
+bool KNNShardServer::handleRequest(int fd, bool& shutdown) {
+    ShardRequest request{};
+    if (!receiveAll(fd, &request, sizeof(request)) || request.magic != shardMagic) {
+        return false;  // coordinator disconnected, or not one
+    }
+
+    if (request.op == shardShutdown) {
+        shutdown = true;
+        return false;
+    }
+
+    if (request.op == shardHello) {
+        ShardHello hello{};
+        hello.rows = classifier.size();
+        hello.k = static_cast<std::uint32_t>(classifier.getK());
+        hello.featureDim = static_cast<std::uint32_t>(classifier.inputDim());
+        return sendAll(fd, &hello, sizeof(hello));
+    }
+
+    if (request.op != shardSearch || request.count > maxRequestQueries || request.dim > maxRequestDim) {
+        std::cerr << "Shard got an invalid request\n";
+        return false;
+    }
+
+    std::vector<std::vector<float>> queries(request.count, std::vector<float>(request.dim));
+    for (auto& query : queries) {
+        if (!receiveAll(fd, query.data(), query.size() * sizeof(float))) {
+            return false;
+        }
+    }
+
+    const std::size_t k = static_cast<std::size_t>(classifier.getK());
+    const auto neighbors = classifier.neighborsBatch(queries, threads);
+
+    std::vector<ShardNeighbor> reply(queries.size() * k, ShardNeighbor{-1, -1, 0.0f});
+    for (std::size_t q = 0; q < neighbors.size(); q++) {
+        for (std::size_t i = 0; i < neighbors[q].size() && i < k; i++) {
+            const KNNNeighbor& neighbor = neighbors[q][i];
+            reply[q * k + i] = {neighbor.row, neighbor.label, neighbor.distance};
+        }
+    }
+
+    return sendAll(fd, reply.data(), reply.size() * sizeof(ShardNeighbor));
+}
+
+ShardedKNNClassifier::ShardedKNNClassifier() {}
+
+ShardedKNNClassifier::~ShardedKNNClassifier() {
+    disconnect();
+}
+
+bool ShardedKNNClassifier::connect(const std::vector<std::string>& socketPaths, int timeoutMs) {
+    disconnect();
+
+    for (const std::string& path : socketPaths) {
+        sockaddr_un address;
+        if (!socketAddress(path, address)) {
+            disconnect();
+            return false;
+        }
+
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            std::cerr << "Cannot create socket for " << path << "\n";
+            disconnect();
+            return false;
+        }
+        shards.push_back({fd, 0, 0});
+
+        // a freshly started shard may still be loading its model
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            const bool notYet = errno == ENOENT || errno == ECONNREFUSED || errno == EINTR;
+            if (!notYet || std::chrono::steady_clock::now() >= deadline) {
+                std::cerr << "Cannot connect to shard " << path << ": " << std::strerror(errno) << "\n";
+                disconnect();
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        const ShardRequest request{shardMagic, shardHello, 0, 0};
+        ShardHello hello{};
+        if (!sendAll(fd, &request, sizeof(request)) || !receiveAll(fd, &hello, sizeof(hello))) {
+            std::cerr << "Shard " << path << " did not answer\n";
+            disconnect();
+            return false;
+        }
+
+        const bool first = shards.size() == 1;
+        if (!first && (static_cast<int>(hello.k) != k || hello.featureDim != featureDim)) {
+            std::cerr << "Shard " << path << " has k = " << hello.k << ", " << hello.featureDim
+                      << " features; expected k = " << k << ", " << featureDim << " features\n";
+            disconnect();
+            return false;
+        }
+
+        k = static_cast<int>(hello.k);
+        featureDim = hello.featureDim;
+        shards.back().firstRow = totalRows;
+        shards.back().rows = hello.rows;
+        totalRows += hello.rows;
+    }
+
+    return !shards.empty();
+}
+
+void ShardedKNNClassifier::disconnect() {
+    for (const Shard& shard : shards) {
+        ::close(shard.fd);
+    }
+    shards.clear();
+    totalRows = 0;
+    featureDim = 0;
+    k = 0;
+}
+
+void ShardedKNNClassifier::shutdownShards() {
+    const ShardRequest request{shardMagic, shardShutdown, 0, 0};
+    for (const Shard& shard : shards) {
+        sendAll(shard.fd, &request, sizeof(request));
+    }
+    disconnect();
+}
+
+int ShardedKNNClassifier::predict(const std::vector<float>& features) {
+    return predictBatch({features}).front();
+}
+
+std::vector<int> ShardedKNNClassifier::predictBatch(const std::vector<std::vector<float>>& queries) {
+    const auto neighbors = neighborsBatch(queries);
+    std::vector<int> predictions(queries.size(), -1);
+    std::vector<std::pair<int, float>> labelled;
+
+    for (std::size_t q = 0; q < queries.size(); q++) {
+        labelled.clear();
+        for (const KNNNeighbor& neighbor : neighbors[q]) {
+            labelled.emplace_back(neighbor.label, neighbor.distance);
+        }
+        predictions[q] = KNNClassifier::vote(labelled);
+    }
+
+    return predictions;
+}
+
+std::vector<std::vector<KNNNeighbor>> ShardedKNNClassifier::neighborsBatch(const std::vector<std::vector<float>>& queries) {
+    std::vector<std::vector<KNNNeighbor>> neighbors(queries.size());
+
+    for (std::size_t begin = 0; begin < queries.size() && connected(); begin += queriesPerRequest) {
+        const std::size_t end = std::min(queries.size(), begin + queriesPerRequest);
+        if (!searchChunk(queries, begin, end, neighbors)) {
+            // the streams are out of step after a partial exchange
+            std::cerr << "Sharded search failed, disconnecting\n";
+            disconnect();
+            std::fill(neighbors.begin(), neighbors.end(), std::vector<KNNNeighbor>());
+        }
+    }
+
+    return neighbors;
+}
+
+bool ShardedKNNClassifier::searchChunk(
+    const std::vector<std::vector<float>>& queries,
+    std::size_t begin,
+    std::size_t end,
+    std::vector<std::vector<KNNNeighbor>>& neighbors) {
+
+    const std::size_t count = end - begin;
+    const ShardRequest request{shardMagic, shardSearch, count, featureDim};
+
+    // queries padded or cut to the shards' feature size, as encodeQuery() would
+    std::vector<float> payload(count * featureDim, 0.0f);
+    for (std::size_t q = 0; q < count; q++) {
+        const std::vector<float>& query = queries[begin + q];
+        std::copy_n(query.begin(), std::min(query.size(), featureDim), payload.begin() + q * featureDim);
+    }
+
+    // every shard gets the batch before any reply is read, so they search it concurrently
+    for (const Shard& shard : shards) {
+        if (!sendAll(shard.fd, &request, sizeof(request))
+            || !sendAll(shard.fd, payload.data(), payload.size() * sizeof(float))) {
+            return false;
+        }
+    }
+
+    const std::size_t slots = static_cast<std::size_t>(k);
+    std::vector<ShardNeighbor> reply(count * slots);
+
+    for (const Shard& shard : shards) {
+        if (!receiveAll(shard.fd, reply.data(), reply.size() * sizeof(ShardNeighbor))) {
+            return false;
+        }
+
+        for (std::size_t q = 0; q < count; q++) {
+            for (std::size_t i = 0; i < slots; i++) {
+                const ShardNeighbor& neighbor = reply[q * slots + i];
+                if (neighbor.row < 0) {
+                    break;
+                }
+                const int row = static_cast<int>(shard.firstRow) + neighbor.row;
+                neighbors[begin + q].push_back({row, neighbor.label, neighbor.distance});
+            }
+        }
+    }
+
+    // same order as KNearestList over the whole set: distance, then the earlier row
+    for (std::size_t q = begin; q < end; q++) {
+        auto& merged = neighbors[q];
+        std::sort(merged.begin(), merged.end(), [](const KNNNeighbor& a, const KNNNeighbor& b) {
+            return a.distance < b.distance || (a.distance == b.distance && a.row < b.row);
+        });
+        if (merged.size() > slots) {
+            merged.resize(slots);
+        }
+    }
+
+    return true;
+}
+
+pid_t startKNNShardProcess(const std::string& modelPath, const std::string& socketPath, int k, unsigned int threads) {
+    // unflushed output would otherwise be written again by the child
+    std::cout.flush();
+    std::fflush(stdout);
+
+    const pid_t pid = ::fork();
+    if (pid < 0) {
+        std::cerr << "Cannot start shard process for " << modelPath << "\n";
+        return -1;
+    }
+    if (pid > 0) {
+        return pid;
+    }
+
+    // child: serve the shard, then leave without running the parent's atexit handlers
+    KNNClassifier classifier(k);
+    bool served = false;
+    if (classifier.loadModel(modelPath)) {
+        KNNShardServer server(classifier, threads);
+        served = server.listen(socketPath) && server.serve();
+    }
+    std::cout.flush();
+    ::_exit(served ? 0 : 1);
+}
@@ -106,9 +106,16 @@ float NeuralNetwork::evaluate(std::vector<TrainingSample>& testData) {
 
     std::cout << "Evaluating Neural Network on " << testData.size() << " samples...\n";
 
-    int correct = 0;
-    int processed = 0;
-    const int progressInterval = std::max(1, static_cast<int>(testData.size() / 20));
+    const std::size_t correct = countCorrect(testData, true);
+
+    std::cout << "\nNeural Network Evaluation Completed!\n";
+    return static_cast<float>(correct) / testData.size();
+}
+
+std::size_t NeuralNetwork::countCorrect(const std::vector<TrainingSample>& testData, bool showProgress) {
+    std::size_t correct = 0;
+    std::size_t processed = 0;
+    const std::size_t progressInterval = std::max<std::size_t>(1, testData.size() / 20);
 
     for (const auto& sample : testData) {
         const int prediction = predict_digit(sample.features);
@@ -117,14 +124,13 @@ float NeuralNetwork::evaluate(std::vector<TrainingSample>& testData) {
         }
         processed++;
 
-        if (processed % progressInterval == 0) {
+        if (showProgress && processed % progressInterval == 0) {
             const float progress = static_cast<float>(processed) / testData.size() * 100.0f;
             std::cout << "\rProgress: " << static_cast<int>(progress) << "%" << std::flush;
         }
     }
 
-    std::cout << "\nNeural Network Evaluation Completed!\n";
-    return static_cast<float>(correct) / testData.size();
+    return correct;
 }
 
 bool NeuralNetwork::save_model(const std::string& filename) const {
@@ -0,0 +1,91 @@
+#include "baselines/nn_mlp_fast/batch_loader.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <utility>
+
+BatchLoader::BatchLoader(const FeatureDataset& data, std::size_t batchSize, int epochs, const BatchLoaderParams& params)
+    : data(data),
+      batchSize(std::max<std::size_t>(1, batchSize)),
+      perEpoch((data.size() + this->batchSize - 1) / this->batchSize),
+      total(perEpoch * static_cast<std::size_t>(std::max(0, epochs))),
+      params(params),
+      ring(std::max<std::size_t>(1, params.prefetchDepth)) {
+    if (total > 0) {
+        producer = std::thread(&BatchLoader::produce, this);
+    }
+}
+
+BatchLoader::~BatchLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    drained.notify_all();
+    if (producer.joinable()) {
+        producer.join();
+    }
+}
+
+bool BatchLoader::next(Batch& batch) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (delivered == total) {
+        return false;
+    }
+
+    filled.wait(lock, [this] { return ready > 0; });
+    // the caller's spent buffers take the slot's place and are refilled later
+    std::swap(batch, ring[head]);
+    head = (head + 1) % ring.size();
+    ready--;
+    delivered++;
+    lock.unlock();
+
+    drained.notify_one();
+    return true;
+}
+
+void BatchLoader::produce() {
+    const std::size_t cols = data.cols();
+    std::vector<std::size_t> order(data.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::mt19937 rng(params.seed);
+
+    std::size_t tail = 0;
+    for (std::size_t produced = 0; produced < total; produced++) {
+        const std::size_t start = (produced % perEpoch) * batchSize;
+        if (start == 0 && params.shuffle) {
+            std::shuffle(order.begin(), order.end(), rng);
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            drained.wait(lock, [this] { return stopping || ready < ring.size(); });
+            if (stopping) {
+                return;
+            }
+        }
+
+        // the tail slot is free and invisible to the trainer until ready counts it
+        Batch& batch = ring[tail];
+        const std::size_t rows = std::min(batchSize, data.size() - start);
+        batch.X.rows = static_cast<int>(rows);
+        batch.X.cols = static_cast<int>(cols);
+        batch.X.data.resize(rows * cols);
+        batch.y.resize(rows);
+        for (std::size_t r = 0; r < rows; r++) {
+            const std::size_t sample = order[start + r];
+            const float* row = data.features.row(sample);
+            std::copy(row, row + cols, batch.X.data.begin() + r * cols);
+            batch.y[r] = data.labels[sample];
+        }
+        tail = (tail + 1) % ring.size();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready++;
+        }
+        filled.notify_one();
+    }
+}
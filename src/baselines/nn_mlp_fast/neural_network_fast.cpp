@@ -12,42 +12,6 @@ NeuralNetworkFast::NeuralNetworkFast(int inputDim, int hidden1, int hidden2, int
       layer2(hidden1, hidden2),
       layer3(hidden2, numClasses) {}
 
-Matrix NeuralNetworkFast::makeBatchX(
-    const std::vector<TrainingSample>& data,
-    std::size_t start,
-    std::size_t batchSize) {
-
-    const std::size_t end = std::min(start + batchSize, data.size());
-    const std::size_t actualBatch = end - start;
-    const int featureDim = static_cast<int>(data[start].features.size());
-
-    Matrix X(static_cast<int>(actualBatch), featureDim, 0.0f);
-
-    for (std::size_t r = 0; r < actualBatch; r++) {
-        for (int c = 0; c < featureDim; c++) {
-            X(static_cast<int>(r), c) = data[start + r].features[c];
-        }
-    }
-
-    return X;
-}
-
-std::vector<int> NeuralNetworkFast::makeBatchY(
-    const std::vector<TrainingSample>& data,
-    std::size_t start,
-    std::size_t batchSize) {
-
-    const std::size_t end = std::min(start + batchSize, data.size());
-    std::vector<int> y;
-    y.reserve(end - start);
-
-    for (std::size_t i = start; i < end; i++) {
-        y.push_back(data[i].label);
-    }
-
-    return y;
-}
-
 Matrix NeuralNetworkFast::tanhForward(const Matrix& x) {
     Matrix out(x.rows, x.cols, 0.0f);
 
@@ -79,62 +43,114 @@ void NeuralNetworkFast::train(
     std::size_t batchSize,
     const std::string& runName) {
 
+    train(FeatureDataset::fromSamples(trainingData), epochs, learningRate, batchSize, runName);
+}
+
+void NeuralNetworkFast::train(
+    const FeatureDataset& trainingData,
+    int epochs,
+    float learningRate,
+    std::size_t batchSize,
+    const std::string& runName) {
+
     if (trainingData.empty()) {
         return;
     }
 
+    // batches of all epochs are assembled on the loader's thread while this one trains
+    BatchLoader loader(trainingData, batchSize, epochs, loaderParams);
+    Batch batch;
+
+    for (int epoch = 0; epoch < epochs; epoch++) {
+        float epochLoss = 0.0f;
+
+        for (std::size_t b = 0; b < loader.batchesPerEpoch(); b++) {
+            loader.next(batch);
+            epochLoss += trainBatch(batch.X, batch.y, learningRate);
+        }
+
+        logEpoch(epoch, epochs, epochLoss / static_cast<float>(loader.batchesPerEpoch()), runName);
+    }
+}
+
+void NeuralNetworkFast::train(
+    FeatureChunkSource& trainingData,
+    int epochs,
+    float learningRate,
+    std::size_t batchSize,
+    const std::string& runName) {
+
+    FeatureDataset chunk;
+    Batch batch;
     for (int epoch = 0; epoch < epochs; epoch++) {
         float epochLoss = 0.0f;
         std::size_t batches = 0;
 
-        for (std::size_t start = 0; start < trainingData.size(); start += batchSize) {
-            Matrix X = makeBatchX(trainingData, start, batchSize);
-            std::vector<int> y = makeBatchY(trainingData, start, batchSize);
+        trainingData.rewind();
+        while (trainingData.next(chunk)) {
+            // with shuffling on, a new order for every chunk of every epoch
+            BatchLoaderParams chunkParams = loaderParams;
+            chunkParams.seed += static_cast<unsigned int>(epoch * 7919 + batches);
+
+            BatchLoader loader(chunk, batchSize, 1, chunkParams);
+            while (loader.next(batch)) {
+                epochLoss += trainBatch(batch.X, batch.y, learningRate);
+                batches++;
+            }
+        }
+
+        if (batches == 0) {
+            return;
+        }
+        logEpoch(epoch, epochs, epochLoss / static_cast<float>(batches), runName);
+    }
+}
 
-            Matrix Z1 = layer1.forward(X);
-            Matrix A1 = tanhForward(Z1);
+float NeuralNetworkFast::trainBatch(const Matrix& X, const std::vector<int>& y, float learningRate) {
+    Matrix Z1 = layer1.forward(X);
+    Matrix A1 = tanhForward(Z1);
 
-            Matrix Z2 = layer2.forward(A1);
-            Matrix A2 = tanhForward(Z2);
+    Matrix Z2 = layer2.forward(A1);
+    Matrix A2 = tanhForward(Z2);
 
-            Matrix logits = layer3.forward(A2);
+    Matrix logits = layer3.forward(A2);
 
-            auto lossResult = softmaxCrossEntropyForward(logits, y);
-            epochLoss += lossResult.loss;
-            batches++;
+    auto lossResult = softmaxCrossEntropyForward(logits, y);
 
-            Matrix dLogits = softmaxCrossEntropyBackward(lossResult.probs, y);
-            Matrix dA2 = layer3.backward(dLogits);
-            Matrix dZ2 = tanhBackward(A2, dA2);
+    Matrix dLogits = softmaxCrossEntropyBackward(lossResult.probs, y);
+    Matrix dA2 = layer3.backward(dLogits);
+    Matrix dZ2 = tanhBackward(A2, dA2);
 
-            Matrix dA1 = layer2.backward(dZ2);
-            Matrix dZ1 = tanhBackward(A1, dA1);
+    Matrix dA1 = layer2.backward(dZ2);
+    Matrix dZ1 = tanhBackward(A1, dA1);
 
-            layer1.backward(dZ1);
+    layer1.backward(dZ1);
 
-            layer1.step(learningRate);
-            layer2.step(learningRate);
-            layer3.step(learningRate);
-        }
+    layer1.step(learningRate);
+    layer2.step(learningRate);
+    layer3.step(learningRate);
 
-        const float avgLoss = epochLoss / static_cast<float>(batches);
+    return lossResult.loss;
+}
 
-        std::cout << "Epoch " << (epoch + 1)
-                  << "/" << epochs
-                  << " - Avg Loss: " << avgLoss
-                  << "\n";
+void NeuralNetworkFast::logEpoch(int epoch, int epochs, float avgLoss, const std::string& runName) {
+    std::cout << "Epoch " << (epoch + 1)
+              << "/" << epochs
+              << " - Avg Loss: " << avgLoss
+              << "\n";
 
-        if (!runName.empty()) {
-            TrainingLogger::logEpochLoss(runName, epoch + 1, avgLoss);
-        }
+    if (!runName.empty()) {
+        TrainingLogger::logEpochLoss(runName, epoch + 1, avgLoss);
     }
 }
 
 int NeuralNetworkFast::predict_digit(const std::vector<float>& features) const {
-    Matrix X(1, static_cast<int>(features.size()), 0.0f);
-    for (int i = 0; i < static_cast<int>(features.size()); i++) {
-        X(0, i) = features[i];
-    }
+    return predictRow(features.data(), static_cast<int>(features.size()));
+}
+
+int NeuralNetworkFast::predictRow(const float* features, int featureDim) const {
+    Matrix X(1, featureDim, 0.0f);
+    std::copy(features, features + featureDim, X.data.begin());
 
     auto layer1Copy = const_cast<DenseLayer&>(layer1);
     auto layer2Copy = const_cast<DenseLayer&>(layer2);
@@ -177,6 +193,22 @@ float NeuralNetworkFast::evaluate(const std::vector<TrainingSample>& testData) c
     return static_cast<float>(correct) / static_cast<float>(testData.size());
 }
 
+float NeuralNetworkFast::evaluate(const FeatureDataset& testData) const {
+    if (testData.empty()) {
+        return 0.0f;
+    }
+
+    const int featureDim = static_cast<int>(testData.cols());
+    int correct = 0;
+    for (std::size_t i = 0; i < testData.size(); i++) {
+        if (predictRow(testData.features.row(i), featureDim) == testData.labels[i]) {
+            correct++;
+        }
+    }
+
+    return static_cast<float>(correct) / static_cast<float>(testData.size());
+}
+
 bool NeuralNetworkFast::save_model(const std::string& filename) const {
     std::ofstream out(filename, std::ios::binary);
     if (!out.is_open()) {
@@ -7,6 +7,14 @@ ImageMatrix::ImageMatrix() : width(0), height(0), channels(0) {}
 ImageMatrix::ImageMatrix(int w, int h, int c, unsigned char value)
     : width(w), height(h), channels(c), data(w*h*c, value) {}
 
+ImageMatrix::ImageMatrix(const ImageView& view)
+    : width(view.width), height(view.height), channels(view.channels), data(view.width * view.height * view.channels) {
+    const std::size_t rowBytes = static_cast<std::size_t>(width) * channels;
+    for (int y = 0; y < height; y++) {
+        std::copy(view.row(y), view.row(y) + rowBytes, data.begin() + y * rowBytes);
+    }
+}
+
 
 bool ImageMatrix::empty() const {
     return data.empty();
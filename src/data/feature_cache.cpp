@@ -0,0 +1,190 @@
+#include "data/feature_cache.h"
+#include "io/mapped_file.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+
+constexpr std::uint32_t cacheMagic = 0x4546434b; // "KCFE"
+constexpr std::uint32_t cacheVersion = 1;
+
+struct CacheFileHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t key;
+    std::uint64_t rows;
+    std::uint64_t cols;
+    std::uint64_t stride;         // floats per stored row
+    std::uint64_t labelOffset;    // rows x int32
+    std::uint64_t featureOffset;  // rows x stride floats, FeatureMatrix::alignment aligned
+};
+
+constexpr std::uint64_t hashSeed = 0xcbf29ce484222325ull;
+constexpr std::uint64_t hashMultiplier = 0x9e3779b97f4a7c15ull;
+
+// multiply-xorshift over 8-byte words: a few GB/s, so hashing the MNIST
+// files costs far less than extracting their features
+std::uint64_t hashBytes(std::uint64_t hash, const unsigned char* data, std::size_t size) {
+    std::size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * hashMultiplier;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ data[i]) * hashMultiplier;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+std::uint64_t hashValue(std::uint64_t hash, std::uint64_t value) {
+    return hashBytes(hash, reinterpret_cast<const unsigned char*>(&value), sizeof(value));
+}
+
+std::uint64_t alignOffset(std::uint64_t offset) {
+    return (offset + FeatureMatrix::alignment - 1) / FeatureMatrix::alignment * FeatureMatrix::alignment;
+}
+
+} // namespace
+
+FeatureCache::FeatureCache(std::string directory) : directory(std::move(directory)) {}
+
+std::uint64_t FeatureCache::key(const std::vector<std::string>& files, const std::string& config) {
+    std::uint64_t hash = hashValue(hashSeed, files.size());
+
+    for (const std::string& path : files) {
+        MappedFile mapped;
+        if (!mapped.open(path)) {
+            return 0;
+        }
+        // the length separates the files, so bytes cannot shift from one to the next
+        hash = hashValue(hash, mapped.size());
+        hash = hashBytes(hash, mapped.data(), mapped.size());
+    }
+
+    hash = hashValue(hash, config.size());
+    hash = hashBytes(hash, reinterpret_cast<const unsigned char*>(config.data()), config.size());
+    // 0 is the "unreadable" key
+    return hash == 0 ? 1 : hash;
+}
+
+std::string FeatureCache::entryPath(std::uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.features", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(directory) / name).string();
+}
+
+bool FeatureCache::load(std::uint64_t key, FeatureDataset& dataset) const {
+    const std::string path = entryPath(key);
+    std::error_code error;
+    if (!std::filesystem::exists(path, error)) {
+        return false;
+    }
+
+    auto mapped = std::make_shared<MappedFile>();
+    if (!mapped->open(path)) {
+        return false;
+    }
+
+    CacheFileHeader header{};
+    if (mapped->size() >= sizeof(header)) {
+        std::memcpy(&header, mapped->data(), sizeof(header));
+    }
+
+    // as in the model file: cols bounded before stride * sizeof(float) is taken, and offsets
+    // ordered and in the file before any row count is multiplied out
+    const std::uint64_t fileSize = mapped->size();
+    const bool valid = header.magic == cacheMagic
+        && header.version == cacheVersion
+        && header.key == key
+        && header.cols <= fileSize / sizeof(float)
+        && header.stride != 0
+        && header.stride == FeatureMatrix::paddedSize(header.cols)
+        && header.featureOffset % FeatureMatrix::alignment == 0
+        && header.labelOffset <= header.featureOffset
+        && header.featureOffset <= fileSize
+        && header.rows <= (header.featureOffset - header.labelOffset) / sizeof(std::int32_t)
+        && header.rows <= (fileSize - header.featureOffset) / (header.stride * sizeof(float));
+    if (!valid) {
+        std::cerr << "Ignoring invalid feature cache entry " << path << "\n";
+        return false;
+    }
+
+    const auto* labels = reinterpret_cast<const std::int32_t*>(mapped->data() + header.labelOffset);
+    dataset.labels.assign(labels, labels + header.rows);
+    dataset.features = FeatureMatrix::view(
+        reinterpret_cast<const float*>(mapped->data() + header.featureOffset), header.rows, header.cols);
+    dataset.storage = std::move(mapped);
+    return true;
+}
+
+bool FeatureCache::store(std::uint64_t key, const FeatureDataset& dataset) const {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        std::cerr << "Cannot create feature cache directory " << directory << "\n";
+        return false;
+    }
+
+    const std::string path = entryPath(key);
+    // unique per process, so two writers of the same entry never share a temporary file
+    const std::string temporary = path + ".tmp." + std::to_string(::getpid());
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Cannot write feature cache entry " << temporary << "\n";
+            return false;
+        }
+
+        const std::uint64_t rows = dataset.size();
+        CacheFileHeader header{};
+        header.magic = cacheMagic;
+        header.version = cacheVersion;
+        header.key = key;
+        header.rows = rows;
+        header.cols = dataset.cols();
+        header.stride = FeatureMatrix::paddedSize(dataset.cols());
+        header.labelOffset = alignOffset(sizeof(header));
+        header.featureOffset = alignOffset(header.labelOffset + rows * sizeof(std::int32_t));
+
+        auto padTo = [&file](std::uint64_t offset) {
+            static const char zeros[FeatureMatrix::alignment] = {};
+            const std::uint64_t position = static_cast<std::uint64_t>(file.tellp());
+            file.write(zeros, static_cast<std::streamsize>(offset - position));
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        padTo(header.labelOffset);
+        for (const int label : dataset.labels) {
+            const std::int32_t stored = label;
+            file.write(reinterpret_cast<const char*>(&stored), sizeof(stored));
+        }
+        padTo(header.featureOffset);
+        // rows are contiguous with their padding, one write for the whole matrix
+        if (rows > 0) {
+            file.write(reinterpret_cast<const char*>(dataset.features.row(0)), rows * header.stride * sizeof(float));
+        }
+
+        if (!file) {
+            std::cerr << "Cannot write feature cache entry " << temporary << "\n";
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::cerr << "Cannot move feature cache entry into place: " << path << "\n";
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,660 @@
+#include "data/gzip_reader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::size_t inputBlock = 1 << 18;  // bytes per read() of the compressed file
+constexpr std::size_t windowSize = 1 << 15;  // DEFLATE back-references reach 32 KB
+constexpr std::size_t windowMask = windowSize - 1;
+
+constexpr std::uint16_t lengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr std::uint8_t lengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr std::uint16_t distanceBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr std::uint8_t distanceExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+// order in which a dynamic block lists the code length code lengths
+constexpr std::uint8_t codeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// slice-by-8 tables: entries[k][b] is the CRC of byte b followed by k zero bytes
+struct CrcTables {
+    std::uint32_t entries[8][256];
+};
+
+const CrcTables& crcTables() {
+    static const CrcTables tables = [] {
+        CrcTables built{};
+        for (std::uint32_t n = 0; n < 256; n++) {
+            std::uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            built.entries[0][n] = c;
+        }
+        for (std::uint32_t n = 0; n < 256; n++) {
+            for (int k = 1; k < 8; k++) {
+                const std::uint32_t previous = built.entries[k - 1][n];
+                built.entries[k][n] = (previous >> 8) ^ built.entries[0][previous & 0xff];
+            }
+        }
+        return built;
+    }();
+    return tables;
+}
+
+std::uint32_t crc32Update(std::uint32_t crc, const std::uint8_t* data, std::size_t size) {
+    const auto& table = crcTables().entries;
+    crc = ~crc;
+    std::size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        std::uint32_t low;
+        std::uint32_t high;
+        std::memcpy(&low, data + i, sizeof(low));
+        std::memcpy(&high, data + i + 4, sizeof(high));
+        low ^= crc;
+        crc = table[7][low & 0xff] ^ table[6][(low >> 8) & 0xff] ^ table[5][(low >> 16) & 0xff] ^ table[4][low >> 24]
+            ^ table[3][high & 0xff] ^ table[2][(high >> 8) & 0xff] ^ table[1][(high >> 16) & 0xff] ^ table[0][high >> 24];
+    }
+    for (; i < size; i++) {
+        crc = table[0][(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// canonical code from per-symbol code lengths (0 = unused); false for an over-subscribed set
+bool buildTable(GzipReader::HuffmanTable& table, const std::uint8_t* lengths, int symbols) {
+    std::memset(table.count, 0, sizeof(table.count));
+    for (int s = 0; s < symbols; s++) {
+        table.count[lengths[s]]++;
+    }
+    table.count[0] = 0;
+
+    int left = 1;
+    for (int len = 1; len < 16; len++) {
+        left = (left << 1) - table.count[len];
+        if (left < 0) {
+            return false;
+        }
+    }
+
+    // symbols ordered by (length, symbol), the order their codes are assigned in
+    std::uint16_t offsets[16] = {};
+    for (int len = 1; len < 15; len++) {
+        offsets[len + 1] = static_cast<std::uint16_t>(offsets[len] + table.count[len]);
+    }
+    for (int s = 0; s < symbols; s++) {
+        if (lengths[s] != 0) {
+            table.symbols[offsets[lengths[s]]++] = static_cast<std::uint16_t>(s);
+        }
+    }
+
+    // DEFLATE packs codes most significant bit first into a least significant bit first
+    // stream, so a code's table slots are its bit-reversal plus every pattern of the bits after it
+    std::memset(table.fast, 0, sizeof(table.fast));
+    std::uint32_t nextCode[16] = {};
+    std::uint32_t code = 0;
+    for (int len = 1; len < 16; len++) {
+        code = (code + table.count[len - 1]) << 1;
+        nextCode[len] = code;
+    }
+    for (int s = 0; s < symbols; s++) {
+        const int len = lengths[s];
+        if (len == 0) {
+            continue;
+        }
+        const std::uint32_t assigned = nextCode[len]++;
+        if (len > GzipReader::fastBits) {
+            continue;
+        }
+        std::uint32_t reversed = 0;
+        for (int b = 0; b < len; b++) {
+            reversed |= ((assigned >> b) & 1u) << (len - 1 - b);
+        }
+        for (std::uint32_t slot = reversed; slot < (1u << GzipReader::fastBits); slot += 1u << len) {
+            table.fast[slot] = static_cast<std::uint16_t>(s << 4 | len);
+        }
+    }
+    return true;
+}
+
+const GzipReader::HuffmanTable& fixedLiteralCodes() {
+    static const auto table = [] {
+        std::uint8_t lengths[288];
+        std::fill(lengths, lengths + 144, 8);
+        std::fill(lengths + 144, lengths + 256, 9);
+        std::fill(lengths + 256, lengths + 280, 7);
+        std::fill(lengths + 280, lengths + 288, 8);
+        GzipReader::HuffmanTable built;
+        buildTable(built, lengths, 288);
+        return built;
+    }();
+    return table;
+}
+
+const GzipReader::HuffmanTable& fixedDistanceCodes() {
+    static const auto table = [] {
+        std::uint8_t lengths[30];
+        std::fill(lengths, lengths + 30, 5);
+        GzipReader::HuffmanTable built;
+        buildTable(built, lengths, 30);
+        return built;
+    }();
+    return table;
+}
+
+} // namespace
+
+bool isGzipFile(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    std::uint8_t magic[2] = {};
+    const bool gzip = ::pread(fd, magic, sizeof(magic), 0) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+    ::close(fd);
+    return gzip;
+}
+
+GzipReader::GzipReader() {}
+
+GzipReader::~GzipReader() {
+    close();
+}
+
+bool GzipReader::open(const std::string& filePath) {
+    close();
+
+    fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Cannot open " << filePath << "\n";
+        return false;
+    }
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    path = filePath;
+    input.resize(inputBlock);
+    window.resize(windowSize);
+    reset();
+
+    // the first member header tells a gzip file from anything else
+    if (!readMemberHeader()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void GzipReader::close() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = -1;
+    state = State::Done;
+    input.clear();
+    input.shrink_to_fit();
+    window.clear();
+    window.shrink_to_fit();
+}
+
+bool GzipReader::rewind() {
+    if (!isOpen() || ::lseek(fd, 0, SEEK_SET) != 0) {
+        return false;
+    }
+    reset();
+    return readMemberHeader();
+}
+
+bool GzipReader::finish() {
+    std::uint8_t rest[4096];
+    while (state != State::Done && state != State::Error) {
+        read(rest, sizeof(rest));
+    }
+    return finished();
+}
+
+void GzipReader::reset() {
+    state = State::MemberHeader;
+    inputPos = 0;
+    inputEnd = 0;
+    inputExhausted = false;
+    bitBuffer = 0;
+    bitCount = 0;
+    windowPos = 0;
+    lastBlock = false;
+    storedRemaining = 0;
+    copyLength = 0;
+    copyDistance = 0;
+    crc = 0;
+    members = 0;
+}
+
+bool GzipReader::fail(const char* reason) {
+    std::cerr << "Cannot decompress " << path << ": " << reason << "\n";
+    state = State::Error;
+    return false;
+}
+
+bool GzipReader::fillInput() {
+    if (inputExhausted) {
+        return false;
+    }
+
+    ssize_t got = 0;
+    do {
+        got = ::read(fd, input.data(), input.size());
+    } while (got < 0 && errno == EINTR);
+
+    if (got <= 0) {
+        inputExhausted = true;
+        return false;
+    }
+    inputPos = 0;
+    inputEnd = static_cast<std::size_t>(got);
+    return true;
+}
+
+void GzipReader::refillBits() {
+    // whole 8-byte loads while the input block has them, bytes at its end
+    if (inputEnd - inputPos >= 8) {
+        std::uint64_t word;
+        std::memcpy(&word, input.data() + inputPos, sizeof(word));
+        const unsigned int bytes = (63 - bitCount) >> 3;
+        // only whole bytes: the bits above bitCount stay zero for the byte paths
+        bitBuffer |= (word & ((std::uint64_t{1} << (bytes * 8)) - 1)) << bitCount;
+        inputPos += bytes;
+        bitCount += bytes * 8;
+        return;
+    }
+    while (bitCount <= 56) {
+        if (inputPos == inputEnd && !fillInput()) {
+            return;
+        }
+        bitBuffer |= static_cast<std::uint64_t>(input[inputPos++]) << bitCount;
+        bitCount += 8;
+    }
+}
+
+bool GzipReader::needBits(unsigned int count) {
+    if (bitCount < count) {
+        refillBits();
+    }
+    return bitCount >= count;
+}
+
+std::uint32_t GzipReader::takeBits(unsigned int count) {
+    const std::uint32_t value = static_cast<std::uint32_t>(bitBuffer & ((std::uint64_t{1} << count) - 1));
+    bitBuffer >>= count;
+    bitCount -= count;
+    return value;
+}
+
+bool GzipReader::readByte(std::uint8_t& byte) {
+    if (!needBits(8)) {
+        return false;
+    }
+    byte = static_cast<std::uint8_t>(takeBits(8));
+    return true;
+}
+
+int GzipReader::decodeSymbol(const HuffmanTable& table) {
+    if (bitCount < 15) {
+        refillBits();
+    }
+
+    const std::uint16_t entry = table.fast[bitBuffer & ((1u << fastBits) - 1)];
+    if (entry != 0) {
+        const unsigned int len = entry & 15;
+        if (len > bitCount) {
+            return -1;
+        }
+        takeBits(len);
+        return entry >> 4;
+    }
+
+    // longer than fastBits: walk the canonical code one bit at a time
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (unsigned int len = 1; len < 16 && len <= bitCount; len++) {
+        code |= static_cast<int>((bitBuffer >> (len - 1)) & 1);
+        const int count = table.count[len];
+        if (code < first + count) {
+            takeBits(len);
+            return table.symbols[index + code - first];
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+bool GzipReader::readMemberHeader() {
+    refillBits();
+    if (bitCount == 0 && members > 0) {
+        state = State::Done;
+        return true;
+    }
+
+    std::uint8_t header[10];
+    for (std::uint8_t& byte : header) {
+        if (!readByte(byte)) {
+            // zero padding after the last member is tolerated, like gzip itself does
+            if (members > 0) {
+                state = State::Done;
+                return true;
+            }
+            return fail("truncated header");
+        }
+    }
+    if (header[0] != 0x1f || header[1] != 0x8b) {
+        if (members > 0) {
+            state = State::Done;
+            return true;
+        }
+        return fail("not a gzip file");
+    }
+    if (header[2] != 8) {
+        return fail("unsupported compression method");
+    }
+
+    const std::uint8_t flags = header[3];
+    if (flags & 0xe0) {
+        return fail("reserved header flags set");
+    }
+
+    std::uint8_t byte = 0;
+    if (flags & 0x04) {  // FEXTRA
+        std::uint8_t low = 0;
+        std::uint8_t high = 0;
+        if (!readByte(low) || !readByte(high)) {
+            return fail("truncated header");
+        }
+        for (int skip = low | high << 8; skip > 0; skip--) {
+            if (!readByte(byte)) {
+                return fail("truncated header");
+            }
+        }
+    }
+    for (const std::uint8_t textFlag : {std::uint8_t{0x08}, std::uint8_t{0x10}}) {  // FNAME, FCOMMENT
+        if (flags & textFlag) {
+            do {
+                if (!readByte(byte)) {
+                    return fail("truncated header");
+                }
+            } while (byte != 0);
+        }
+    }
+    if (flags & 0x02) {  // FHCRC
+        if (!readByte(byte) || !readByte(byte)) {
+            return fail("truncated header");
+        }
+    }
+
+    crc = 0;
+    windowPos = 0;
+    lastBlock = false;
+    state = State::BlockHeader;
+    return true;
+}
+
+bool GzipReader::readBlockHeader() {
+    if (!needBits(3)) {
+        return fail("truncated block header");
+    }
+    lastBlock = takeBits(1) != 0;
+    const std::uint32_t type = takeBits(2);
+
+    if (type == 0) {
+        takeBits(bitCount & 7);
+        if (!needBits(32)) {
+            return fail("truncated stored block");
+        }
+        const std::uint32_t length = takeBits(16);
+        const std::uint32_t complement = takeBits(16);
+        if (length != (~complement & 0xffff)) {
+            return fail("corrupt stored block length");
+        }
+        storedRemaining = length;
+        state = State::Stored;
+        return true;
+    }
+    if (type == 1) {
+        literalCodes = fixedLiteralCodes();
+        distanceCodes = fixedDistanceCodes();
+        state = State::Codes;
+        return true;
+    }
+    if (type == 2) {
+        if (!readDynamicTables()) {
+            return false;
+        }
+        state = State::Codes;
+        return true;
+    }
+    return fail("invalid block type");
+}
+
+bool GzipReader::readDynamicTables() {
+    if (!needBits(14)) {
+        return fail("truncated block header");
+    }
+    const int literalCount = static_cast<int>(takeBits(5)) + 257;
+    const int distanceCount = static_cast<int>(takeBits(5)) + 1;
+    const int codeLengthCount = static_cast<int>(takeBits(4)) + 4;
+    if (literalCount > 286 || distanceCount > 30) {
+        return fail("too many codes");
+    }
+
+    std::uint8_t lengths[286 + 30] = {};
+    for (int i = 0; i < codeLengthCount; i++) {
+        if (!needBits(3)) {
+            return fail("truncated block header");
+        }
+        lengths[codeLengthOrder[i]] = static_cast<std::uint8_t>(takeBits(3));
+    }
+
+    HuffmanTable lengthCodes;
+    if (!buildTable(lengthCodes, lengths, 19)) {
+        return fail("corrupt code length code");
+    }
+
+    std::fill(lengths, lengths + 19, 0);
+    const int total = literalCount + distanceCount;
+    for (int i = 0; i < total;) {
+        const int symbol = decodeSymbol(lengthCodes);
+        if (symbol < 0) {
+            return fail("corrupt code lengths");
+        }
+        if (symbol < 16) {
+            lengths[i++] = static_cast<std::uint8_t>(symbol);
+            continue;
+        }
+
+        std::uint8_t value = 0;
+        int repeat = 0;
+        if (symbol == 16) {
+            if (i == 0 || !needBits(2)) {
+                return fail("corrupt code lengths");
+            }
+            value = lengths[i - 1];
+            repeat = 3 + static_cast<int>(takeBits(2));
+        } else if (symbol == 17) {
+            if (!needBits(3)) {
+                return fail("corrupt code lengths");
+            }
+            repeat = 3 + static_cast<int>(takeBits(3));
+        } else {
+            if (!needBits(7)) {
+                return fail("corrupt code lengths");
+            }
+            repeat = 11 + static_cast<int>(takeBits(7));
+        }
+        if (i + repeat > total) {
+            return fail("corrupt code lengths");
+        }
+        std::fill(lengths + i, lengths + i + repeat, value);
+        i += repeat;
+    }
+
+    if (lengths[256] == 0) {
+        return fail("missing end-of-block code");
+    }
+    if (!buildTable(literalCodes, lengths, literalCount) || !buildTable(distanceCodes, lengths + literalCount, distanceCount)) {
+        return fail("corrupt literal or distance code");
+    }
+    return true;
+}
+
+bool GzipReader::readMemberTrailer() {
+    takeBits(bitCount & 7);
+
+    std::uint8_t trailer[8];
+    for (std::uint8_t& byte : trailer) {
+        if (!readByte(byte)) {
+            return fail("truncated trailer");
+        }
+    }
+    const std::uint32_t storedCrc = trailer[0] | trailer[1] << 8 | trailer[2] << 16 | static_cast<std::uint32_t>(trailer[3]) << 24;
+    const std::uint32_t storedSize = trailer[4] | trailer[5] << 8 | trailer[6] << 16 | static_cast<std::uint32_t>(trailer[7]) << 24;
+    if (storedCrc != crc) {
+        return fail("CRC mismatch");
+    }
+    if (storedSize != static_cast<std::uint32_t>(windowPos)) {
+        return fail("length mismatch");
+    }
+
+    members++;
+    state = State::MemberHeader;
+    return true;
+}
+
+bool GzipReader::decodeCodes(std::uint8_t* out, std::size_t size, std::size_t& produced) {
+    std::uint8_t* history = window.data();
+
+    while (produced < size) {
+        if (copyLength > 0) {
+            const std::size_t n = std::min(copyLength, size - produced);
+            const std::size_t from = (windowPos - copyDistance) & windowMask;
+            const std::size_t to = windowPos & windowMask;
+            if (from + n <= windowSize && to + n <= windowSize) {
+                // byte by byte: a source closer than n overlaps the bytes being written
+                for (std::size_t i = 0; i < n; i++) {
+                    history[to + i] = history[from + i];
+                }
+                std::memcpy(out + produced, history + to, n);
+                windowPos += n;
+                produced += n;
+            } else {
+                for (std::size_t i = 0; i < n; i++) {
+                    const std::uint8_t byte = history[(windowPos - copyDistance) & windowMask];
+                    history[windowPos++ & windowMask] = byte;
+                    out[produced++] = byte;
+                }
+            }
+            copyLength -= n;
+            continue;
+        }
+
+        const int symbol = decodeSymbol(literalCodes);
+        if (symbol < 0) {
+            return fail("truncated or corrupt data");
+        }
+        if (symbol < 256) {
+            history[windowPos++ & windowMask] = static_cast<std::uint8_t>(symbol);
+            out[produced++] = static_cast<std::uint8_t>(symbol);
+            continue;
+        }
+        if (symbol == 256) {
+            state = lastBlock ? State::MemberTrailer : State::BlockHeader;
+            return true;
+        }
+
+        const int lengthCode = symbol - 257;
+        if (lengthCode >= 29 || !needBits(lengthExtra[lengthCode])) {
+            return fail("corrupt length code");
+        }
+        const std::size_t length = lengthBase[lengthCode] + takeBits(lengthExtra[lengthCode]);
+
+        const int distanceCode = decodeSymbol(distanceCodes);
+        if (distanceCode < 0 || distanceCode >= 30 || !needBits(distanceExtra[distanceCode])) {
+            return fail("corrupt distance code");
+        }
+        const std::size_t distance = distanceBase[distanceCode] + takeBits(distanceExtra[distanceCode]);
+        if (distance > windowPos) {
+            return fail("distance too far back");
+        }
+
+        copyLength = length;
+        copyDistance = distance;
+    }
+    return true;
+}
+
+std::size_t GzipReader::read(std::uint8_t* out, std::size_t size) {
+    std::size_t produced = 0;
+    std::size_t checked = 0;  // out[0, checked) is already in crc
+
+    while (produced < size && state != State::Done && state != State::Error) {
+        switch (state) {
+        case State::MemberHeader:
+            readMemberHeader();
+            break;
+        case State::BlockHeader:
+            readBlockHeader();
+            break;
+        case State::Stored:
+            while (storedRemaining > 0 && produced < size) {
+                // bytes already in the bit buffer first, then straight from the input block
+                std::size_t n = 0;
+                if (bitCount > 0) {
+                    std::uint8_t byte = 0;
+                    readByte(byte);
+                    out[produced] = byte;
+                    n = 1;
+                } else if (inputPos < inputEnd || fillInput()) {
+                    n = std::min({storedRemaining, size - produced, inputEnd - inputPos});
+                    std::memcpy(out + produced, input.data() + inputPos, n);
+                    inputPos += n;
+                } else {
+                    fail("truncated stored block");
+                    break;
+                }
+                for (std::size_t i = 0; i < n; i++) {
+                    window[windowPos++ & windowMask] = out[produced + i];
+                }
+                produced += n;
+                storedRemaining -= n;
+            }
+            if (storedRemaining == 0 && state == State::Stored) {
+                state = lastBlock ? State::MemberTrailer : State::BlockHeader;
+            }
+            break;
+        case State::Codes:
+            decodeCodes(out, size, produced);
+            break;
+        case State::MemberTrailer:
+            crc = crc32Update(crc, out + checked, produced - checked);
+            checked = produced;
+            readMemberTrailer();
+            break;
+        case State::Done:
+        case State::Error:
+            break;
+        }
+    }
+
+    if (state != State::Error) {
+        crc = crc32Update(crc, out + checked, produced - checked);
+    }
+    return produced;
+}
@@ -0,0 +1,76 @@
+#include "data/mapped_mnist.h"
+#include "data/gzip_reader.h"
+#include "data/idx_format.h"
+
+#include <cstring>
+#include <iostream>
+
+void MNISTImageView::copyTo(ImageMatrix& image) const {
+    if (image.width != width || image.height != height || image.channels != 1) {
+        image = ImageMatrix(width, height, 1);
+    }
+    std::memcpy(image.data.data(), pixels, static_cast<std::size_t>(width) * height);
+}
+
+bool MappedMNISTDataset::open(const std::string& imagePath, const std::string& labelPath) {
+    close();
+
+    if (isGzipFile(imagePath) || isGzipFile(labelPath)) {
+        std::cerr << "Cannot map a compressed IDX file, stream it instead: "
+                  << (isGzipFile(imagePath) ? imagePath : labelPath) << "\n";
+        return false;
+    }
+    if (!imageFile.open(imagePath) || !labelFile.open(labelPath)) {
+        close();
+        return false;
+    }
+
+    const std::uint8_t* imageBytes = imageFile.data();
+    const std::uint8_t* labelBytes = labelFile.data();
+
+    IDXImageHeader header;
+    if (imageFile.size() < idxImageHeaderSize || !parseIDXImageHeader(imageBytes, header)) {
+        std::cerr << "Not an IDX image file: " << imagePath << "\n";
+        close();
+        return false;
+    }
+    std::size_t labelCount = 0;
+    if (labelFile.size() < idxLabelHeaderSize || !parseIDXLabelHeader(labelBytes, labelCount)) {
+        std::cerr << "Not an IDX label file: " << labelPath << "\n";
+        close();
+        return false;
+    }
+
+    if (idxImageHeaderSize + header.count * header.imageBytes() > imageFile.size()) {
+        std::cerr << "Truncated IDX image file: " << imagePath << "\n";
+        close();
+        return false;
+    }
+    if (idxLabelHeaderSize + labelCount > labelFile.size()) {
+        std::cerr << "Truncated IDX label file: " << labelPath << "\n";
+        close();
+        return false;
+    }
+    if (labelCount != header.count) {
+        std::cerr << "Number of labels doesn't match number of images!\n";
+        close();
+        return false;
+    }
+
+    pixels = imageBytes + idxImageHeaderSize;
+    labelData = labelBytes + idxLabelHeaderSize;
+    count = header.count;
+    rows = header.rows;
+    cols = header.cols;
+    return true;
+}
+
+void MappedMNISTDataset::close() {
+    imageFile.close();
+    labelFile.close();
+    pixels = nullptr;
+    labelData = nullptr;
+    count = 0;
+    rows = 0;
+    cols = 0;
+}
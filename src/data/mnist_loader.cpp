@@ -1,116 +1,97 @@
 #include "data/mnist_loader.h"
-#include <fstream>
-#include <ios>
+#include "data/gzip_reader.h"
+#include <cstring>
 #include <iostream>
 
-MNISTLoader::MNISTLoader() {}
-
-int MNISTLoader::reverseInt(int i) {
-    unsigned char c1, c2, c3, c4;
-    c1 = i & 255;
-    c2 = (i >> 8) & 255;
-    c3 = (i >> 16) & 255;
-    c4 = (i >> 24) & 255;
-
-    return ((int)c1 << 24) + ((int)c2 << 16) + ((int)c3 << 8) + c4;
-}
-
-bool MNISTLoader::loadImages(const std::string& imagePath, std::vector<MNISTImage>& data) {
-    std::ifstream file(imagePath, std::ios::binary);
+void MNISTDataset::assign(const MappedMNISTDataset& source) {
+    width = source.imageWidth();
+    height = source.imageHeight();
 
-    if (!file.is_open()) {
-        std::cerr << "Cannot open image file: " << imagePath << "\n";
-        return false;
+    const std::size_t imageBytes = static_cast<std::size_t>(width) * height;
+    pixels.resize(source.size() * imageBytes);
+    if (!pixels.empty()) {
+        std::memcpy(pixels.data(), source.image(0).pixels, pixels.size());
     }
 
-    int magicNumber = 0;
-    int numberOfImages = 0;
-    int nRows;
-    int nCols;
-
-    file.read((char*)&magicNumber, sizeof(magicNumber));
-    magicNumber = reverseInt(magicNumber);
-
-    file.read((char*)&numberOfImages, sizeof(numberOfImages));
-    numberOfImages = reverseInt(numberOfImages);
-
-    file.read((char*)&nRows, sizeof(nRows));
-    nRows = reverseInt(nRows);
-
-    file.read((char*)&nCols, sizeof(nCols));
-    nCols = reverseInt(nCols);
-
-    std::cout << "Loading " << numberOfImages << " images of size " << nRows << "x" << nCols << "\n";
-
-    data.resize(numberOfImages);
+    const Span<const std::uint8_t> labels = source.labels();
+    labelData.assign(labels.begin(), labels.end());
+}
 
-    for (int i = 0; i < numberOfImages; i++) {
-        ImageMatrix image(nCols, nRows, 1);
-        for (int r = 0; r < nRows; r++) {
-            for (int c = 0; c < nCols; c++) {
-                unsigned char pixel = 0;
-                file.read((char*)&pixel, sizeof(pixel));
-                image(r, c, 0) = pixel;
-            }
+bool MNISTDataset::assign(MNISTStreamReader& source) {
+    width = source.imageWidth();
+    height = source.imageHeight();
+
+    const std::size_t imageBytes = static_cast<std::size_t>(width) * height;
+    // a checked header gives the final size, so each chunk is copied straight into place;
+    // a compressed file's header is only trusted as far as its chunks arrive
+    const bool sized = source.sizeChecked();
+    pixels.resize(sized ? source.size() * imageBytes : 0);
+    labelData.resize(sized ? source.size() : 0);
+
+    const bool complete = source.forEachChunk([&](const MNISTChunk& chunk) {
+        if (!sized) {
+            pixels.resize((chunk.first + chunk.size()) * imageBytes);
+            labelData.resize(chunk.first + chunk.size());
         }
-        data[i].image = image;
+        std::memcpy(pixels.data() + chunk.first * imageBytes, chunk.pixels, chunk.size() * imageBytes);
+        std::memcpy(labelData.data() + chunk.first, chunk.labels, chunk.size());
+    });
+    if (!complete) {
+        clear();
     }
+    return complete;
+}
 
-    file.close();
-    return true;
+void MNISTDataset::clear() {
+    pixels.clear();
+    labelData.clear();
+    width = 0;
+    height = 0;
 }
 
-bool MNISTLoader::loadLabels(const std::string& labelPath, std::vector<MNISTImage>& data) {
-    std::ifstream file(labelPath, std::ios::binary);
-    if (!file.is_open()) {
-        std::cerr << "Cannot open label file: " << labelPath << "\n";
-        return false;
-    }
+MNISTLoader::MNISTLoader() {}
 
-    int magicNumber;
-    int numberOfLabels;
+bool MNISTLoader::loadData(const std::string& imagePath, const std::string& labelPath, MNISTDataset& data) {
+    if (isGzipFile(imagePath) || isGzipFile(labelPath)) {
+        MNISTStreamReader reader;
+        if (!reader.open(imagePath, labelPath)) {
+            return false;
+        }
 
-    file.read((char*)&magicNumber, sizeof(magicNumber));
-    magicNumber = reverseInt(magicNumber);
+        std::cout << "Loading " << reader.size() << " images of size " << reader.imageHeight() << "x" << reader.imageWidth() << " (compressed)\n";
 
-    file.read((char*)&numberOfLabels, sizeof(numberOfLabels));
-    numberOfLabels = reverseInt(numberOfLabels);
+        return data.assign(reader);
+    }
 
-    if (numberOfLabels != data.size()) {
-        std::cerr << "Number of labels doesn't match number of images!\n";
+    MappedMNISTDataset mapped;
+    if (!mapped.open(imagePath, labelPath)) {
         return false;
     }
 
-    for (int i = 0; i < numberOfLabels; i++) {
-        unsigned char label = 0;
-        file.read((char*)&label, sizeof(label));
-        data[i].label = label;
-    }
+    std::cout << "Loading " << mapped.size() << " images of size " << mapped.imageHeight() << "x" << mapped.imageWidth() << "\n";
 
-    file.close();
+    data.assign(mapped);
     return true;
 }
 
 bool MNISTLoader::loadTrainingData(const std::string& imagePath, const std::string& labelPath) {
-    if (!loadImages(imagePath, trainingData)) return false;
-    if (!loadLabels(labelPath, trainingData)) return false;
+    if (!loadData(imagePath, labelPath, trainingData)) return false;
 
     std::cout << "Successfuly loaded " << trainingData.size() << " training samples\n";
     return true;
 }
 
 bool MNISTLoader::loadTestData(const std::string& imagePath, const std::string& labelPath) {
-    if (!loadImages(imagePath, testData)) return false;
-    if (!loadLabels(labelPath, testData)) return false;
+    if (!loadData(imagePath, labelPath, testData)) return false;
 
     std::cout << "Successfuly loaded " << testData.size() << " test samples\n";
     return true;
 }
 
-const std::vector<MNISTImage>& MNISTLoader::getTrainingData() const {
+const MNISTDataset& MNISTLoader::getTrainingData() const {
     return trainingData;
 }
 
-const std::vector<MNISTImage>& MNISTLoader::getTestData() const {
+const MNISTDataset& MNISTLoader::getTestData() const {
     return testData;
 }
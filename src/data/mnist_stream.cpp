@@ -0,0 +1,241 @@
+#include "data/mnist_stream.h"
+#include "data/idx_format.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <iostream>
+#include <limits>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// reads exactly size bytes at offset; pread may return short counts on large requests
+bool readFully(int fd, std::uint8_t* data, std::size_t size, std::size_t offset) {
+    while (size > 0) {
+        const ssize_t got = ::pread(fd, data, size, static_cast<off_t>(offset));
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        data += got;
+        offset += static_cast<std::size_t>(got);
+        size -= static_cast<std::size_t>(got);
+    }
+    return true;
+}
+
+} // namespace
+
+bool MNISTStreamReader::Source::open(const std::string& path) {
+    close();
+    compressed = isGzipFile(path);
+    if (compressed) {
+        return gzip.open(path);
+    }
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    return fd >= 0;
+}
+
+void MNISTStreamReader::Source::close() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = -1;
+    gzip.close();
+    compressed = false;
+    position = 0;
+}
+
+bool MNISTStreamReader::Source::read(std::uint8_t* data, std::size_t size, std::size_t offset) {
+    if (!compressed) {
+        return readFully(fd, data, size, offset);
+    }
+
+    // a gzip stream only runs forwards: going back means inflating again from the start
+    if (offset < position) {
+        if (!gzip.rewind()) {
+            return false;
+        }
+        position = 0;
+    }
+    std::uint8_t skipped[4096];
+    while (position < offset) {
+        const std::size_t step = std::min(sizeof(skipped), offset - position);
+        if (gzip.read(skipped, step) != step) {
+            return false;
+        }
+        position += step;
+    }
+    if (gzip.read(data, size) != size) {
+        return false;
+    }
+    position += size;
+    return true;
+}
+
+bool MNISTStreamReader::Source::read(std::vector<std::uint8_t>& buffer, std::size_t size, std::size_t offset) {
+    if (!compressed) {
+        buffer.resize(size);
+        return read(buffer.data(), size, offset);
+    }
+
+    constexpr std::size_t step = std::size_t{1} << 20;
+    buffer.clear();
+    while (buffer.size() < size) {
+        const std::size_t done = buffer.size();
+        const std::size_t bytes = std::min(step, size - done);
+        buffer.resize(done + bytes);
+        if (!read(buffer.data() + done, bytes, offset + done)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MNISTStreamReader::Source::finish() {
+    if (!compressed) {
+        return true;
+    }
+    // the stream is at its end, so the next read starts over
+    position = std::numeric_limits<std::size_t>::max();
+    return gzip.finish();
+}
+
+std::size_t MNISTStreamReader::Source::fileSize() const {
+    struct stat info {};
+    return !compressed && ::fstat(fd, &info) == 0 ? static_cast<std::size_t>(info.st_size) : 0;
+}
+
+MNISTStreamReader::MNISTStreamReader(std::size_t chunkImages) : chunkImages(std::max<std::size_t>(1, chunkImages)) {}
+
+MNISTStreamReader::~MNISTStreamReader() {
+    close();
+}
+
+bool MNISTStreamReader::open(const std::string& imagePath, const std::string& labelPath) {
+    close();
+
+    const bool imageOpened = imageSource.open(imagePath);
+    if (!imageOpened || !labelSource.open(labelPath)) {
+        std::cerr << "Cannot open " << (imageOpened ? labelPath : imagePath) << "\n";
+        close();
+        return false;
+    }
+
+    std::uint8_t imageHeader[idxImageHeaderSize];
+    std::uint8_t labelHeader[idxLabelHeaderSize];
+    IDXImageHeader header;
+    std::size_t labelCount = 0;
+
+    if (!imageSource.read(imageHeader, sizeof(imageHeader), 0) || !parseIDXImageHeader(imageHeader, header)) {
+        std::cerr << "Not an IDX image file: " << imagePath << "\n";
+        close();
+        return false;
+    }
+    if (!labelSource.read(labelHeader, sizeof(labelHeader), 0) || !parseIDXLabelHeader(labelHeader, labelCount)) {
+        std::cerr << "Not an IDX label file: " << labelPath << "\n";
+        close();
+        return false;
+    }
+    // a compressed file's length is unknown up front; it being short shows as a read error instead
+    const bool imageShort = !imageSource.compressed
+        && idxImageHeaderSize + header.count * header.imageBytes() > imageSource.fileSize();
+    const bool labelShort = !labelSource.compressed && idxLabelHeaderSize + labelCount > labelSource.fileSize();
+    if (imageShort || labelShort) {
+        std::cerr << "Truncated IDX file: " << imagePath << "\n";
+        close();
+        return false;
+    }
+    if (labelCount != header.count) {
+        std::cerr << "Number of labels doesn't match number of images!\n";
+        close();
+        return false;
+    }
+
+    count = header.count;
+    rows = header.rows;
+    cols = header.cols;
+
+    rewind();
+    return true;
+}
+
+void MNISTStreamReader::close() {
+    imageSource.close();
+    labelSource.close();
+    count = 0;
+    rows = 0;
+    cols = 0;
+    nextImage = 0;
+    readFailed = false;
+    pixelBuffer.clear();
+    pixelBuffer.shrink_to_fit();
+    labelBuffer.clear();
+    labelBuffer.shrink_to_fit();
+}
+
+void MNISTStreamReader::rewind() {
+    nextImage = 0;
+    readFailed = false;
+    if (isOpen()) {
+        readAhead(0);
+    }
+}
+
+void MNISTStreamReader::readAhead(std::size_t first) const {
+    if (first >= count) {
+        return;
+    }
+    const std::size_t images = std::min(chunkImages, count - first);
+    const std::size_t imageBytes = static_cast<std::size_t>(rows) * cols;
+    // compressed sources read ahead on their own, in large sequential blocks
+    if (!imageSource.compressed) {
+        ::posix_fadvise(imageSource.fd, static_cast<off_t>(idxImageHeaderSize + first * imageBytes),
+                        static_cast<off_t>(images * imageBytes), POSIX_FADV_WILLNEED);
+    }
+    if (!labelSource.compressed) {
+        ::posix_fadvise(labelSource.fd, static_cast<off_t>(idxLabelHeaderSize + first), static_cast<off_t>(images),
+                        POSIX_FADV_WILLNEED);
+    }
+}
+
+bool MNISTStreamReader::next(MNISTChunk& chunk) {
+    if (!isOpen() || readFailed || nextImage >= count) {
+        return false;
+    }
+
+    const std::size_t images = std::min(chunkImages, count - nextImage);
+    const std::size_t imageBytes = static_cast<std::size_t>(rows) * cols;
+    if (!imageSource.read(pixelBuffer, images * imageBytes, idxImageHeaderSize + nextImage * imageBytes)
+        || !labelSource.read(labelBuffer, images, idxLabelHeaderSize + nextImage)) {
+        std::cerr << "Read error at image " << nextImage << " of " << count << "\n";
+        readFailed = true;
+        return false;
+    }
+    // a corrupt compressed file only shows in the trailer after its last byte
+    const bool last = nextImage + images == count;
+    if (last && (!imageSource.finish() || !labelSource.finish())) {
+        std::cerr << "Compressed IDX file fails its CRC or length check\n";
+        readFailed = true;
+        return false;
+    }
+
+    chunk.first = nextImage;
+    chunk.count = images;
+    chunk.width = cols;
+    chunk.height = rows;
+    chunk.pixels = pixelBuffer.data();
+    chunk.labels = labelBuffer.data();
+
+    nextImage += images;
+    // the kernel fetches the following chunk while the caller works on this one
+    readAhead(nextImage);
+    return true;
+}
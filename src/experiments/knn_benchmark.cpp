@@ -0,0 +1,339 @@
+#include "experiments/knn_benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+KNNSearchReport KNNBenchmark::measure(
+    const KNNClassifier& classifier,
+    const std::vector<TrainingSample>& queries,
+    const std::vector<std::vector<int>>* groundTruth,
+    std::vector<std::vector<int>>* neighbors,
+    const std::string& config) {
+
+    KNNSearchReport report;
+    report.config = config;
+
+    if (queries.empty()) {
+        return report;
+    }
+
+    std::vector<std::vector<int>> found(queries.size());
+    int correct = 0;
+    KNNSearchStats stats;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < queries.size(); i++) {
+        found[i] = classifier.nearestRows(queries[i].features, &stats);
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    for (std::size_t i = 0; i < queries.size(); i++) {
+        if (classifier.predict(queries[i].features) == queries[i].label) {
+            correct++;
+        }
+    }
+
+    report.microsPerQuery = std::chrono::duration<double, std::micro>(end - start).count() / queries.size();
+    report.accuracy = static_cast<float>(correct) / static_cast<float>(queries.size());
+    report.prunedFraction = stats.prunedFraction();
+
+    if (groundTruth) {
+        std::size_t hits = 0;
+        std::size_t total = 0;
+
+        for (std::size_t i = 0; i < queries.size(); i++) {
+            const auto& truth = (*groundTruth)[i];
+            for (const int row : found[i]) {
+                if (std::find(truth.begin(), truth.end(), row) != truth.end()) {
+                    hits++;
+                }
+            }
+            total += truth.size();
+        }
+
+        report.recall = total > 0 ? static_cast<double>(hits) / static_cast<double>(total) : 0.0;
+    } else {
+        report.recall = 1.0;
+    }
+
+    if (neighbors) {
+        *neighbors = std::move(found);
+    }
+
+    return report;
+}
+
+std::vector<KNNSearchReport> KNNBenchmark::hnswRecallVsLatency(
+    KNNClassifier& classifier,
+    const std::vector<TrainingSample>& queries,
+    const std::vector<int>& efValues) {
+
+    std::vector<KNNSearchReport> reports;
+    const KNNSearchMode previousMode = classifier.getSearchMode();
+    const int previousEf = classifier.getHNSWParams().efSearch;
+
+    std::vector<std::vector<int>> groundTruth;
+    classifier.setSearchMode(KNNSearchMode::Exact);
+    reports.push_back(measure(classifier, queries, nullptr, &groundTruth, "exact"));
+
+    classifier.setSearchMode(KNNSearchMode::HNSW);
+    classifier.buildIndex();
+
+    for (const int ef : efValues) {
+        classifier.setHNSWEfSearch(ef);
+        reports.push_back(measure(classifier, queries, &groundTruth, nullptr, "hnsw_ef" + std::to_string(ef)));
+    }
+
+    classifier.setHNSWEfSearch(previousEf);
+    classifier.setSearchMode(previousMode);
+    return reports;
+}
+
+std::vector<KNNSearchReport> KNNBenchmark::pqRecallVsRerank(
+    KNNClassifier& classifier,
+    const std::vector<TrainingSample>& queries,
+    const std::vector<int>& rerankValues) {
+
+    std::vector<KNNSearchReport> reports;
+    if (!classifier.hasFeatures()) {
+        std::cerr << "PQ benchmark needs the float features, load the uncompressed model\n";
+        return reports;
+    }
+
+    const KNNSearchMode previousMode = classifier.getSearchMode();
+    const int previousRerank = classifier.getPQParams().rerankCount;
+
+    std::vector<std::vector<int>> groundTruth;
+    classifier.setSearchMode(KNNSearchMode::Exact);
+    reports.push_back(measure(classifier, queries, nullptr, &groundTruth, "exact"));
+
+    classifier.setSearchMode(KNNSearchMode::PQ);
+    classifier.buildIndex();
+
+    for (const int rerank : rerankValues) {
+        classifier.setPQRerankCount(rerank);
+        reports.push_back(measure(classifier, queries, &groundTruth, nullptr, "pq_rerank" + std::to_string(rerank)));
+    }
+
+    classifier.setPQRerankCount(previousRerank);
+    classifier.setSearchMode(previousMode);
+    return reports;
+}
+
+std::vector<KNNSearchReport> KNNBenchmark::pivotPruning(
+    KNNClassifier& classifier,
+    const std::vector<TrainingSample>& queries,
+    const std::vector<int>& pivotCounts) {
+
+    std::vector<KNNSearchReport> reports;
+    if (!classifier.hasFeatures()) {
+        std::cerr << "Pivot benchmark needs the float features\n";
+        return reports;
+    }
+
+    const KNNSearchMode previousMode = classifier.getSearchMode();
+    const PivotParams previousParams = classifier.getPivotParams();
+
+    std::vector<std::vector<int>> groundTruth;
+    classifier.setSearchMode(KNNSearchMode::Exact);
+    reports.push_back(measure(classifier, queries, nullptr, &groundTruth, "exact"));
+
+    classifier.setSearchMode(KNNSearchMode::Pivot);
+    for (const int pivots : pivotCounts) {
+        PivotParams params = previousParams;
+        params.pivots = pivots;
+        classifier.setPivotParams(params);
+        reports.push_back(measure(classifier, queries, &groundTruth, nullptr, "pivots" + std::to_string(pivots)));
+    }
+
+    classifier.setSearchMode(previousMode);
+    classifier.setPivotParams(previousParams);
+    return reports;
+}
+
+std::vector<KNNSearchReport> KNNBenchmark::ivfRecallVsProbes(
+    KNNClassifier& classifier,
+    const std::vector<TrainingSample>& queries,
+    const std::vector<int>& probeCounts) {
+
+    std::vector<KNNSearchReport> reports;
+    if (!classifier.hasFeatures()) {
+        std::cerr << "IVF benchmark needs the float features\n";
+        return reports;
+    }
+
+    const KNNSearchMode previousMode = classifier.getSearchMode();
+    const int previousProbes = classifier.getIVFParams().nprobe;
+
+    std::vector<std::vector<int>> groundTruth;
+    classifier.setSearchMode(KNNSearchMode::Exact);
+    reports.push_back(measure(classifier, queries, nullptr, &groundTruth, "exact"));
+
+    // the index is usually built already (switching modes builds it), so it is rebuilt
+    // from scratch here to time the build
+    classifier.setSearchMode(KNNSearchMode::IVF);
+    const auto start = std::chrono::steady_clock::now();
+    classifier.setIVFParams(classifier.getIVFParams());
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "IVF index: " << classifier.getIVFParams().lists << " lists, "
+              << classifier.compressedBytes() / 1024 << " KB, built in " << elapsed.count() << "s\n";
+
+    for (const int nprobe : probeCounts) {
+        classifier.setIVFProbes(nprobe);
+        reports.push_back(measure(classifier, queries, &groundTruth, nullptr, "ivf_nprobe" + std::to_string(nprobe)));
+    }
+
+    classifier.setIVFProbes(previousProbes);
+    classifier.setSearchMode(previousMode);
+    return reports;
+}
+
+std::vector<KNNSearchReport> KNNBenchmark::cascadeRecallVsShortlist(
+    KNNClassifier& classifier,
+    const std::vector<TrainingSample>& queries,
+    const std::vector<int>& shortlistSizes) {
+
+    std::vector<KNNSearchReport> reports;
+    if (!classifier.hasFeatures()) {
+        std::cerr << "Cascade benchmark needs the float features\n";
+        return reports;
+    }
+
+    const KNNSearchMode previousMode = classifier.getSearchMode();
+    const int previousShortlist = classifier.getCascadeParams().shortlist;
+
+    std::vector<std::vector<int>> groundTruth;
+    classifier.setSearchMode(KNNSearchMode::Exact);
+    reports.push_back(measure(classifier, queries, nullptr, &groundTruth, "exact"));
+
+    classifier.setSearchMode(KNNSearchMode::Cascade);
+    classifier.buildIndex();
+
+    for (const int shortlist : shortlistSizes) {
+        classifier.setCascadeShortlist(shortlist);
+        reports.push_back(measure(classifier, queries, &groundTruth, nullptr, "cascade_shortlist" + std::to_string(shortlist)));
+    }
+
+    classifier.setCascadeShortlist(previousShortlist);
+    classifier.setSearchMode(previousMode);
+    return reports;
+}
+
+std::vector<KNNSearchReport> KNNBenchmark::pcaDimensions(
+    const std::vector<TrainingSample>& trainingData,
+    const std::vector<TrainingSample>& queries,
+    const std::vector<int>& componentCounts,
+    int k) {
+
+    std::vector<KNNSearchReport> reports;
+    if (trainingData.empty()) {
+        std::cerr << "PCA benchmark needs the training samples\n";
+        return reports;
+    }
+
+    KNNClassifier reference(k);
+    reference.train(&trainingData, false);
+
+    std::vector<std::vector<int>> groundTruth;
+    reports.push_back(measure(reference, queries, nullptr, &groundTruth, "full_" + std::to_string(trainingData.front().features.size())));
+
+    for (const int components : componentCounts) {
+        if (components <= 0) {
+            continue;
+        }
+
+        KNNClassifier projected(k);
+        PCAParams params;
+        params.components = components;
+        projected.setPCAParams(params);
+
+        const auto start = std::chrono::steady_clock::now();
+        projected.train(&trainingData, false);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        if (projected.projectedDim() == 0) {
+            continue;
+        }
+
+        std::cout << "PCA " << components << ": trained in " << elapsed.count() << "s, "
+                  << projected.explainedVariance() * 100.0 << "% of the variance kept\n";
+        reports.push_back(measure(projected, queries, &groundTruth, nullptr, "pca" + std::to_string(components)));
+    }
+
+    return reports;
+}
+
+std::vector<KNNSearchReport> KNNBenchmark::compactVsFloat(
+    const KNNClassifier& classifier,
+    const std::vector<TrainingSample>& trainingData,
+    const std::vector<TrainingSample>& queries) {
+
+    std::vector<KNNSearchReport> reports;
+    const KNNSearchMode mode = classifier.getSearchMode();
+    if (KNNClassifier::storesFloatFeatures(mode) || !classifier.hasIndex() || trainingData.empty()) {
+        std::cerr << "Compact store benchmark needs a Quantized or Binary classifier and its training samples\n";
+        return reports;
+    }
+
+    KNNClassifier reference(classifier.getK());
+    reference.train(&trainingData, false);
+
+    const std::string name = mode == KNNSearchMode::Binary ? "binary" : "quantized";
+    std::vector<std::vector<int>> groundTruth;
+    reports.push_back(measure(reference, queries, nullptr, &groundTruth, "float"));
+    reports.push_back(measure(classifier, queries, &groundTruth, nullptr, name));
+
+    const std::size_t floatBytes = reference.size() * FeatureMatrix::paddedSize(trainingData.front().features.size()) * sizeof(float);
+    std::cout << "Reference set: float " << floatBytes / 1024 << " KB, " << name << " "
+              << classifier.compressedBytes() / 1024 << " KB\n";
+
+    return reports;
+}
+
+void KNNBenchmark::printReport(const std::string& title, const std::vector<KNNSearchReport>& reports) {
+    std::cout << "\n=== " << title << " ===\n";
+    std::cout << std::left << std::setw(24) << "config"
+              << std::right << std::setw(10) << "recall"
+              << std::setw(14) << "us/query"
+              << std::setw(12) << "accuracy"
+              << std::setw(10) << "pruned" << "\n";
+
+    for (const auto& report : reports) {
+        std::cout << std::left << std::setw(24) << report.config
+                  << std::right << std::fixed << std::setprecision(4)
+                  << std::setw(10) << report.recall
+                  << std::setprecision(1) << std::setw(14) << report.microsPerQuery
+                  << std::setprecision(2) << std::setw(11) << report.accuracy * 100.0f << "%"
+                  << std::setprecision(1) << std::setw(9) << report.prunedFraction * 100.0 << "%\n";
+    }
+
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
+
+void KNNBenchmark::logReport(const std::string& name, const std::vector<KNNSearchReport>& reports) {
+    fs::create_directories("results");
+
+    const std::string path = "results/knn_" + name + ".csv";
+    const bool exists = fs::exists(path);
+
+    std::ofstream out(path, std::ios::app);
+    if (!exists) {
+        out << "config,recall,us_per_query,accuracy,pruned_fraction\n";
+    }
+
+    for (const auto& report : reports) {
+        out << report.config << ","
+            << report.recall << ","
+            << report.microsPerQuery << ","
+            << report.accuracy << ","
+            << report.prunedFraction << "\n";
+    }
+}
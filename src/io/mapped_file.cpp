@@ -0,0 +1,65 @@
+#include "io/mapped_file.h"
+
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+MappedFile::MappedFile() {}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : mapping(std::exchange(other.mapping, nullptr)), length(std::exchange(other.length, 0)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        mapping = std::exchange(other.mapping, nullptr);
+        length = std::exchange(other.length, 0);
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Cannot open " << path << "\n";
+        return false;
+    }
+
+    struct stat info {};
+    if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+        std::cerr << "Cannot map empty or unreadable file " << path << "\n";
+        ::close(fd);
+        return false;
+    }
+
+    const std::size_t fileSize = static_cast<std::size_t>(info.st_size);
+    void* address = ::mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+
+    if (address == MAP_FAILED) {
+        std::cerr << "Cannot map " << path << "\n";
+        return false;
+    }
+
+    mapping = address;
+    length = fileSize;
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapping) {
+        ::munmap(mapping, length);
+        mapping = nullptr;
+        length = 0;
+    }
+}
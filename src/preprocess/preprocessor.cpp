@@ -6,8 +6,12 @@ Preprocessor::Preprocessor() {}
 
 // main processing function/pipeline
 ImageMatrix Preprocessor::preprocess(const ImageMatrix& input) {
-    ImageMatrix processed = applyGrayscale(input);
-    processed = applyThreshold(processed);
+    return preprocess(input.view());
+}
+
+ImageMatrix Preprocessor::preprocess(const ImageView& input) {
+    // a grayscale input is thresholded in place, without a grayscale copy first
+    ImageMatrix processed = input.channels == 1 ? applyThreshold(input) : applyThreshold(applyGrayscale(input));
     processed = removeNoise(processed);
 
     return processed;
@@ -16,6 +20,11 @@ ImageMatrix Preprocessor::preprocess(const ImageMatrix& input) {
 // Grayscale to simplify processing, reduces data from 3 channels (RGB) to 1 Gray channel
 ImageMatrix Preprocessor::applyGrayscale(const ImageMatrix& input) {
     if (input.channels == 1) return input;  // already Grayscale
+    return applyGrayscale(input.view());
+}
+
+ImageMatrix Preprocessor::applyGrayscale(const ImageView& input) {
+    if (input.channels == 1) return ImageMatrix(input);  // already Grayscale
 
     ImageMatrix gray(input.width, input.height, 1);
     if (input.channels == 3) {
@@ -38,9 +47,13 @@ ImageMatrix Preprocessor::applyGrayscale(const ImageMatrix& input) {
 // Binary Conversion.
 // Converts grayscale image to binary (black&white) using 128 thresholding
 ImageMatrix Preprocessor::applyThreshold(const ImageMatrix& input) {
+    return applyThreshold(input.view());
+}
+
+ImageMatrix Preprocessor::applyThreshold(const ImageView& input) {
     ImageMatrix binary(input.width, input.height, 1);
 
-    const unsigned char threshold = 128;
+    const unsigned char threshold = binaryThreshold;
 
     for (int y = 0; y < input.height; y++) {
         for (int x = 0; x < input.width; x++) {
@@ -190,6 +203,10 @@ void Preprocessor::findConnectedComponents(const ImageMatrix& binary, std::vecto
 
 
 std::vector<ImageMatrix> Preprocessor::extractDigits(const ImageMatrix& image, int targetWidth, int targetHeight) {
+    return extractDigits(image.view(), targetWidth, targetHeight);
+}
+
+std::vector<ImageMatrix> Preprocessor::extractDigits(const ImageView& image, int targetWidth, int targetHeight) {
     ImageMatrix processed = preprocess(image);
     std::vector<BoundingBox> digitBoxes = findDigitContours(processed);
 
@@ -197,20 +214,8 @@ std::vector<ImageMatrix> Preprocessor::extractDigits(const ImageMatrix& image, i
     digits.reserve(digitBoxes.size());
 
     for (const auto& box : digitBoxes) {
-        ImageMatrix digit(box.width, box.height, 1);
-
-        for (int y = 0; y < box.height; y++) {
-            for (int x = 0; x < box.width; x++) {
-                int imageY = box.y + y;
-                int imageX = box.x + x;
-                if (imageY < processed.height && imageX < processed.width) {
-                    digit(y, x, 0) = processed(imageY, imageX, 0);
-                }
-            }
-        }
-
-        // Resize to standard size for feature extraction
-        ImageMatrix resized = resizeDigit(digit, targetWidth, targetHeight);
+        // Resize to standard size for feature extraction, sampling the box where it lies
+        ImageMatrix resized = resizeDigit(processed.view(box.x, box.y, box.width, box.height), targetWidth, targetHeight);
 
         digits.push_back(std::move(resized));
     }
@@ -220,6 +225,10 @@ std::vector<ImageMatrix> Preprocessor::extractDigits(const ImageMatrix& image, i
 
 
 ImageMatrix Preprocessor::resizeDigit(const ImageMatrix& digit, int targetWidth, int targetHeight) {
+    return resizeDigit(digit.view(), targetWidth, targetHeight);
+}
+
+ImageMatrix Preprocessor::resizeDigit(const ImageView& digit, int targetWidth, int targetHeight) {
     ImageMatrix resized(targetWidth, targetHeight, 1);
 
     float scaleX = static_cast<float>(digit.width) / targetWidth;
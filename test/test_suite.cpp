@@ -1,8 +1,33 @@
 #include "test_suite.h"
+#include "../include/baselines/common/feature_matrix.h"
+#include "../include/baselines/knn/distance_kernels.h"
+#include "../include/baselines/knn/feature_extractor.h"
 #include "../include/baselines/knn/knn_classifier.h"
+#include "../include/baselines/knn/pq_index.h"
+#include "../include/baselines/knn/sharded_knn.h"
+#include "../include/baselines/nn_mlp_fast/batch_loader.h"
+#include "../include/data/feature_cache.h"
+#include "../include/data/gzip_reader.h"
+#include "../include/data/mapped_mnist.h"
+#include "../include/data/mnist_loader.h"
+#include "../include/data/mnist_stream.h"
+#include "../include/preprocess/preprocessor.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
 #include <iostream>
 #include <unistd.h>
 #include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <vector>
 
 void TestSuite::assertTrue(bool condition, const std::string& testName) {
     if (condition) {
@@ -22,6 +47,102 @@ void TestSuite::assertEquals(float actual, float expected, float tolerance, cons
     }
 }
 
+namespace {
+
+// count sparse random 28x28 digits as KNN feature samples, labelled i % 10
+std::vector<TrainingSample> randomDigitSamples(const FeatureExtractor& extractor, std::size_t count, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::vector<TrainingSample> samples(count);
+    for (std::size_t i = 0; i < count; i++) {
+        ImageMatrix image(28, 28, 1);
+        for (int y = 0; y < 28; y++) {
+            for (int x = 0; x < 28; x++) {
+                image(y, x, 0) = static_cast<unsigned char>(rng() % 4 == 0 ? rng() % 256 : 0);
+            }
+        }
+        samples[i] = {extractor.extractKNNFeatures(image), static_cast<int>(i % 10)};
+    }
+    return samples;
+}
+
+// 250 reference digits, 50 held-out queries and an exact classifier over the reference
+struct KNNFixture {
+    FeatureExtractor extractor;
+    std::vector<TrainingSample> reference;
+    std::vector<TrainingSample> queries;
+    KNNClassifier exact{3};
+
+    KNNFixture() {
+        const std::vector<TrainingSample> images = randomDigitSamples(extractor, 300, 7);
+        reference.assign(images.begin(), images.begin() + 250);
+        queries.assign(images.begin() + 250, images.end());
+        exact.train(&reference);
+    }
+
+    // true when knn finds the exact classifier's nearest rows for every query
+    bool sameNeighbors(const KNNClassifier& knn) const {
+        bool same = true;
+        for (const auto& query : queries) {
+            same = same && exact.nearestRows(query.features) == knn.nearestRows(query.features);
+        }
+        return same;
+    }
+};
+
+// a fresh directory for one test's files, unique to this process
+std::filesystem::path testDirectory(const std::string& name) {
+    const std::filesystem::path directory =
+        std::filesystem::temp_directory_path() / ("ocr_" + name + "_" + std::to_string(getpid()));
+    std::filesystem::create_directories(directory);
+    return directory;
+}
+
+// a 3-image 2x3 IDX pair, pixel i of the file = i * 13, labels 7 1 9
+void writeTinyIDXPair(const std::string& imagePath, const std::string& labelPath) {
+    const unsigned char imageHeader[] = {0, 0, 8, 3, 0, 0, 0, 3, 0, 0, 0, 2, 0, 0, 0, 3};
+    const unsigned char labelHeader[] = {0, 0, 8, 1, 0, 0, 0, 3};
+    std::ofstream imageFile(imagePath, std::ios::binary);
+    std::ofstream labelFile(labelPath, std::ios::binary);
+    imageFile.write(reinterpret_cast<const char*>(imageHeader), sizeof(imageHeader));
+    labelFile.write(reinterpret_cast<const char*>(labelHeader), sizeof(labelHeader));
+    for (int i = 0; i < 18; i++) {
+        imageFile.put(static_cast<char>(i * 13));
+    }
+    labelFile.write("\x07\x01\x09", 3);
+}
+
+// overwrites the 4 bytes at offset, to corrupt a saved file in a known place
+void patchFile(const std::string& path, std::streamoff offset, std::int32_t value) {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(offset);
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+} // namespace
+
+void TestSuite::runAllTests() {
+    testKNN();
+    testKNNQuantized();
+    testKNNBinary();
+    testKNNHNSW();
+    testKNNPQ();
+    testPrototypeSelection();
+    testKNNModelFile();
+    testKNNPivot();
+    testKNNCascade();
+    testKNNPCA();
+    testKNNIVF();
+    testKNNOnline();
+    testKNNSharded();
+    testBatchLoader();
+    testEuclideanDistance();
+    testFeatureExtraction();
+    testImageView();
+    testFeatureCache();
+    testMNISTData();
+    testGzipReader();
+}
+
 void TestSuite::testKNN() {
     std::cout << "\n=== Test: KNN CLassifier ===\n";
 
@@ -68,6 +189,875 @@ void TestSuite::testKNN() {
     float accuracy2 = knn2.evaluate(data2);
     assertTrue(accuracy2 > 0.99f, "KNN 3-class accuracy on train set");
 
+    const std::vector<std::vector<float>> queries = {{0.05f, 0.05f}, {1.05f, 1.05f}, {0.05f, 1.05f}};
+    const std::vector<int> batch = knn2.predictBatch(queries);
+    assertTrue(batch == std::vector<int>({0, 1, 2}), "KNN batch prediction matches single predictions");
+
+    // labels are any ints, negative ones included
+    assertTrue(KNNClassifier::vote({{-2, 1.0f}, {7, 0.5f}, {-2, 2.0f}}) == -2, "KNN vote picks a negative majority label");
+    assertTrue(KNNClassifier::vote({{-3, 1.0f}, {4, 0.5f}}) == 4, "KNN vote breaks a tie by the smaller distance with negative labels");
+    assertTrue(KNNClassifier::vote({{-1, 1.0f}, {-5, 1.0f}}) == -5, "KNN vote breaks an exact tie by the smaller negative label");
+
+    KNNFixture fixture;
+    const float singleThreaded = fixture.exact.evaluate(fixture.queries, 0, false, 1);
+    assertEquals(fixture.exact.evaluate(fixture.queries, 0, false, 4), singleThreaded, 0.0f, "KNN evaluate with 4 threads matches 1 thread");
+
+    // a contiguous dataset trains and evaluates like the per-sample vectors
+    const std::vector<TrainingSample> firstHalf(fixture.reference.begin(), fixture.reference.begin() + 125);
+    const std::vector<TrainingSample> secondHalf(fixture.reference.begin() + 125, fixture.reference.end());
+    FeatureDataset referenceSet = FeatureDataset::fromSamples(firstHalf);
+    referenceSet.append(secondHalf);
+    KNNClassifier datasetKnn(3);
+    datasetKnn.train(referenceSet);
+
+    assertTrue(datasetKnn.size() == fixture.reference.size(), "KNN trained on a contiguous dataset keeps every row");
+    assertTrue(referenceSet.subset({0, 200}).toSamples().back().features == fixture.reference[200].features,
+        "Feature dataset subset copies the selected rows");
+    assertTrue(fixture.sameNeighbors(datasetKnn), "KNN trained on a contiguous dataset matches per-sample neighbors");
+    assertEquals(datasetKnn.evaluate(FeatureDataset::fromSamples(fixture.queries), 0, false, 4), singleThreaded, 0.0f,
+        "KNN evaluate on a contiguous dataset matches per-sample evaluate");
+
     sleep(1);
     std::cout << "\nKNN test finished\n\n";
 }
+
+void TestSuite::testKNNQuantized() {
+    std::cout << "\n=== Test: KNN integer features ===\n";
+
+    KNNFixture fixture;
+    KNNClassifier quantizedKnn(3);
+    quantizedKnn.setFeatureLayout(fixture.extractor.getKNNFeatureLayout(28, 28));
+    quantizedKnn.setSearchMode(KNNSearchMode::Quantized);
+    quantizedKnn.train(&fixture.reference);
+    assertTrue(quantizedKnn.hasIndex(), "KNN integer features build their store on training");
+    assertTrue(fixture.sameNeighbors(quantizedKnn), "KNN integer features match float neighbors");
+
+    // rows added after the integer store was built are searched too
+    KNNClassifier appendedKnn(1);
+    appendedKnn.setFeatureLayout(fixture.extractor.getKNNFeatureLayout(28, 28));
+    appendedKnn.train(&fixture.reference);
+    appendedKnn.setSearchMode(KNNSearchMode::Quantized);
+    appendedKnn.buildIndex();
+    TrainingSample added = fixture.queries.front();
+    added.label = 10;
+    assertTrue(appendedKnn.hasIndex(), "KNN integer store builds over a model trained in exact mode");
+    assertTrue(appendedKnn.addSamples({added}) && appendedKnn.hasIndex(), "KNN integer store is rebuilt after adding samples");
+    assertTrue(appendedKnn.predict(added.features) == added.label, "KNN integer features predict an added sample's label");
+    assertTrue(appendedKnn.nearestRows(added.features).front() == static_cast<int>(fixture.reference.size()),
+        "KNN integer features find rows added after the store was built");
+}
+
+void TestSuite::testKNNBinary() {
+    std::cout << "\n=== Test: KNN binary features ===\n";
+
+    KNNFixture fixture;
+    const KNNFeatureLayout layout = fixture.extractor.getKNNFeatureLayout(28, 28);
+    const int threshold = 100;
+    KNNClassifier binaryKnn(3);
+    binaryKnn.setFeatureLayout(layout);
+    binaryKnn.setBinaryThreshold(threshold);
+    binaryKnn.setSearchMode(KNNSearchMode::Binary);
+    binaryKnn.train(&fixture.reference);
+    assertTrue(binaryKnn.hasIndex(), "KNN binary features build their store on training");
+
+    // brute force: Hamming distance between the thresholded pixels, ties to the lower row
+    const auto bitsOf = [&](const std::vector<float>& features) {
+        std::vector<bool> bits(layout.pixelCount());
+        for (std::size_t i = 0; i < bits.size(); i++) {
+            bits[i] = std::lround(features[i] * 255.0f) > threshold;
+        }
+        return bits;
+    };
+    std::vector<std::vector<bool>> referenceBits;
+    for (const auto& sample : fixture.reference) {
+        referenceBits.push_back(bitsOf(sample.features));
+    }
+    bool sameRows = true;
+    bool samePredictions = true;
+    for (const auto& query : fixture.queries) {
+        const std::vector<bool> queryBits = bitsOf(query.features);
+        std::vector<std::pair<int, int>> distances;  // (Hamming distance, row)
+        for (std::size_t r = 0; r < referenceBits.size(); r++) {
+            int distance = 0;
+            for (std::size_t i = 0; i < queryBits.size(); i++) {
+                distance += queryBits[i] != referenceBits[r][i];
+            }
+            distances.push_back({distance, static_cast<int>(r)});
+        }
+        std::sort(distances.begin(), distances.end());
+
+        std::vector<int> rows;
+        std::vector<std::pair<int, float>> neighbors;
+        for (int i = 0; i < 3; i++) {
+            rows.push_back(distances[i].second);
+            neighbors.push_back({fixture.reference[distances[i].second].label, static_cast<float>(distances[i].first)});
+        }
+        sameRows = sameRows && binaryKnn.nearestRows(query.features) == rows;
+        samePredictions = samePredictions && binaryKnn.predict(query.features) == KNNClassifier::vote(neighbors);
+    }
+    assertTrue(sameRows, "KNN binary features find the brute-force Hamming neighbors");
+    assertTrue(samePredictions, "KNN binary features predict the brute-force Hamming vote");
+
+    // Hamming counts can't be mixed with appended float rows
+    TrainingSample added = fixture.queries.front();
+    added.label = 10;
+    assertTrue(!binaryKnn.appendSample(added), "KNN binary features refuse appended samples");
+    assertTrue(binaryKnn.size() == fixture.reference.size(), "KNN binary features keep their rows after a refused append");
+}
+
+void TestSuite::testKNNHNSW() {
+    std::cout << "\n=== Test: KNN HNSW index ===\n";
+
+    // a saved graph loads next to the same reference rows and searches like the one it was saved from
+    KNNFixture fixture;
+    const std::filesystem::path indexDir = testDirectory("hnsw");
+    const std::string indexPath = (indexDir / "reference.hnsw").string();
+    KNNClassifier builtKnn(3);
+    builtKnn.setSearchMode(KNNSearchMode::HNSW);
+    builtKnn.train(&fixture.reference);
+    KNNClassifier loadedKnn(3);
+    loadedKnn.setSearchMode(KNNSearchMode::HNSW);
+    loadedKnn.train(&fixture.reference, false);
+
+    assertTrue(builtKnn.hasIndex(), "KNN HNSW builds its graph on training");
+    assertTrue(!loadedKnn.hasIndex(), "KNN HNSW training without buildSearchIndex leaves no graph");
+    assertTrue(builtKnn.saveIndex(indexPath) && loadedKnn.loadIndex(indexPath) && loadedKnn.hasIndex(), "KNN HNSW saves and loads its graph");
+
+    bool sameLoaded = true;
+    std::size_t found = 0;
+    for (const auto& query : fixture.queries) {
+        const std::vector<int> exactRows = fixture.exact.nearestRows(query.features);
+        const std::vector<int> graphRows = loadedKnn.nearestRows(query.features);
+        sameLoaded = sameLoaded && graphRows == builtKnn.nearestRows(query.features);
+        for (const int row : graphRows) {
+            found += static_cast<std::size_t>(std::count(exactRows.begin(), exactRows.end(), row));
+        }
+    }
+    const float recall = static_cast<float>(found) / (fixture.queries.size() * 3);
+    assertTrue(sameLoaded, "KNN HNSW loaded graph searches like the one it was saved from");
+    assertTrue(recall >= 0.9f, "KNN HNSW finds the exact neighbors (recall " + std::to_string(recall) + ")");
+
+    // header: magic, version, rows, cols (24 bytes), M, efConstruction, efSearch, maxLevel, entryPoint;
+    // then one level per row, then the layer 0 link lists (count, ids)
+    const std::streamoff entryPointOffset = 40;
+    const std::streamoff firstLinkOffset = 48 + static_cast<std::streamoff>(fixture.reference.size() * sizeof(std::int32_t)) + 4;
+    KNNClassifier corruptKnn(3);
+    corruptKnn.setSearchMode(KNNSearchMode::HNSW);
+    corruptKnn.train(&fixture.reference, false);
+    patchFile(indexPath, entryPointOffset, static_cast<std::int32_t>(fixture.reference.size()));
+    assertTrue(!corruptKnn.loadIndex(indexPath), "KNN HNSW rejects an index file with an out-of-range entry point");
+    builtKnn.saveIndex(indexPath);
+    patchFile(indexPath, firstLinkOffset, 1 << 20);
+    assertTrue(!corruptKnn.loadIndex(indexPath) && !corruptKnn.hasIndex(), "KNN HNSW rejects an index file with an out-of-range link");
+    std::filesystem::remove_all(indexDir);
+}
+
+void TestSuite::testKNNPQ() {
+    std::cout << "\n=== Test: KNN product quantization ===\n";
+
+    // exact re-ranking of the PQ shortlist puts the exact nearest row first
+    KNNFixture fixture;
+    KNNClassifier pqKnn(3);
+    PQParams pqParams;
+    pqParams.rerankCount = 64;
+    pqKnn.setSearchMode(KNNSearchMode::PQ);
+    pqKnn.setPQParams(pqParams);
+    pqKnn.train(&fixture.reference);
+
+    assertTrue(pqKnn.hasIndex(), "KNN PQ builds its codes on training");
+    bool sameTop = true;
+    for (const auto& query : fixture.queries) {
+        sameTop = sameTop && pqKnn.nearestRows(query.features).front() == fixture.exact.nearestRows(query.features).front();
+    }
+    assertTrue(sameTop, "KNN PQ with re-ranking finds the exact nearest row");
+
+    // the compressed model keeps labels and codes only, and loads as PQ without re-ranking
+    const std::filesystem::path modelDir = testDirectory("pq");
+    const std::string modelPath = (modelDir / "reference.kpq").string();
+    KNNClassifier loadedKnn(3);
+    assertTrue(pqKnn.saveCompressedModel(modelPath) && KNNClassifier::isCompressedModel(modelPath),
+        "KNN compressed PQ model is saved and recognized");
+    assertTrue(loadedKnn.loadCompressedModel(modelPath), "KNN compressed PQ model loads");
+    assertTrue(!loadedKnn.hasFeatures(), "KNN compressed PQ model keeps no float features");
+    assertTrue(loadedKnn.getSearchMode() == KNNSearchMode::PQ, "KNN compressed PQ model loads in PQ mode");
+    assertTrue(loadedKnn.size() == fixture.reference.size(), "KNN compressed PQ model keeps every row");
+    pqKnn.setPQRerankCount(0);
+    bool sameCompressed = true;
+    for (const auto& query : fixture.queries) {
+        sameCompressed = sameCompressed && loadedKnn.nearestRows(query.features) == pqKnn.nearestRows(query.features)
+            && loadedKnn.predict(query.features) == pqKnn.predict(query.features);
+    }
+    assertTrue(sameCompressed, "KNN compressed PQ model round-trips codes and labels");
+
+    // header: magic, version, rows (offset 8), featureDim; a huge row count or a cut-off file fails the load
+    KNNClassifier corruptKnn(3);
+    const std::uintmax_t modelBytes = std::filesystem::file_size(modelPath);
+    patchFile(modelPath, 12, 1 << 30);
+    assertTrue(!corruptKnn.loadCompressedModel(modelPath), "KNN compressed PQ model rejects a row count larger than the file");
+    pqKnn.saveCompressedModel(modelPath);
+    std::filesystem::resize_file(modelPath, modelBytes - 1);
+    assertTrue(!corruptKnn.loadCompressedModel(modelPath), "KNN compressed PQ model rejects a truncated file");
+    std::filesystem::remove_all(modelDir);
+
+    // PQ headers (rows, dim, subspaces, subDim) whose sizes overflow or outgrow the stream
+    const std::uint64_t lyingHeaders[][4] = {{1ull << 40, 8, 1, 8}, {1, 8, 1ull << 62, 4}, {1, 8, 1, 1ull << 62}};
+    for (const auto& header : lyingHeaders) {
+        std::stringstream stream;
+        stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+        stream << std::string(PQIndex::centroidCount * sizeof(float) * 8 + 1, '\0');
+        PQIndex index;
+        assertTrue(!index.read(stream) && index.empty(), "KNN PQ index rejects a header sized beyond its stream");
+    }
+}
+
+void TestSuite::testPrototypeSelection() {
+    std::cout << "\n=== Test: KNN prototype selection ===\n";
+
+    // two 6x6 grids of points, class 0 around (0, 0) and class 1 around (5, 5),
+    // plus one class 1 point in the middle of class 0
+    std::vector<TrainingSample> samples;
+    for (int i = 0; i < 36; i++) {
+        const float x = (i % 6) * 0.2f;
+        const float y = (i / 6) * 0.2f;
+        samples.push_back({{x, y}, 0});
+        samples.push_back({{x + 5.0f, y + 5.0f}, 1});
+    }
+    const std::size_t mislabelled = samples.size();
+    samples.push_back({{0.5f, 0.5f}, 1});
+
+    PrototypeSelectionParams editOnly;
+    editOnly.condense = false;
+    const std::vector<std::size_t> edited = selectPrototypes(samples, editOnly);
+
+    KNNClassifier condensedKnn(1);
+    PrototypeSelectionStats stats;
+    const std::vector<std::size_t> kept = condensedKnn.trainPrototypes(&samples, {}, &stats);
+
+    assertTrue(std::find(edited.begin(), edited.end(), mislabelled) == edited.end(), "Wilson editing drops the mislabelled sample");
+    assertTrue(edited.size() == samples.size() - 1, "Wilson editing keeps every other sample");
+    assertTrue(std::find(kept.begin(), kept.end(), mislabelled) == kept.end(), "Condensing after editing leaves out the mislabelled sample");
+    assertTrue(stats.edited == edited.size() && stats.condensed == kept.size(), "Prototype selection stats count the edited and kept samples");
+    assertTrue(kept.size() < edited.size(), "Hart condensing keeps fewer samples than editing");
+    assertTrue(condensedKnn.size() == kept.size(), "KNN trained on prototypes stores only the kept samples");
+
+    bool classifiesKept = true;
+    for (const std::size_t index : edited) {
+        classifiesKept = classifiesKept && condensedKnn.predict(samples[index].features) == samples[index].label;
+    }
+    assertTrue(classifiesKept, "Condensed prototypes classify every edited training sample correctly");
+}
+
+void TestSuite::testKNNModelFile() {
+    std::cout << "\n=== Test: KNN model file ===\n";
+
+    // a saved model maps back in and answers like the classifier that wrote it, with and without PCA
+    KNNFixture fixture;
+    const std::filesystem::path modelDir = testDirectory("model");
+    const std::string modelPath = (modelDir / "reference.knn").string();
+    const std::string pcaModelPath = (modelDir / "reference_pca.knn").string();
+    KNNClassifier pcaKnn(3);
+    PCAParams pcaParams;
+    pcaParams.components = 20;
+    pcaKnn.setPCAParams(pcaParams);
+    pcaKnn.train(&fixture.reference);
+
+    KNNClassifier loadedKnn(3);
+    KNNClassifier loadedPcaKnn(3);
+    assertTrue(fixture.exact.saveModel(modelPath) && KNNClassifier::isModelFile(modelPath), "KNN model file is saved and recognized");
+    assertTrue(loadedKnn.loadModel(modelPath) && loadedKnn.size() == fixture.reference.size(), "KNN model file loads every row");
+    assertTrue(pcaKnn.saveModel(pcaModelPath) && loadedPcaKnn.loadModel(pcaModelPath), "KNN model file with PCA saves and loads");
+    assertTrue(loadedPcaKnn.projectedDim() == 20, "KNN model file keeps the PCA projection");
+
+    bool samePredictions = true;
+    bool samePcaNeighbors = true;
+    for (const auto& query : fixture.queries) {
+        samePredictions = samePredictions && loadedKnn.predict(query.features) == fixture.exact.predict(query.features);
+        samePcaNeighbors = samePcaNeighbors && loadedPcaKnn.nearestRows(query.features) == pcaKnn.nearestRows(query.features);
+    }
+    assertTrue(samePredictions, "KNN model file predicts like the classifier that saved it");
+    assertTrue(fixture.sameNeighbors(loadedKnn), "KNN model file finds the exact neighbors");
+    assertTrue(samePcaNeighbors, "KNN model file with PCA finds the neighbors of the classifier that saved it");
+
+    // header: magic, version, rows, cols, stride, labelOffset, normOffset, featureOffset, projectionOffset;
+    // a version 1 header is the same without projectionOffset, the offsets after it are unchanged
+    const std::streamoff versionOffset = 4;
+    const std::streamoff labelOffsetField = 32;
+    patchFile(modelPath, versionOffset, 1);
+    KNNClassifier versionOneKnn(3);
+    assertTrue(versionOneKnn.loadModel(modelPath) && fixture.sameNeighbors(versionOneKnn), "KNN model file loads version 1 headers");
+
+    // a file cut short, or labels overlapping the norms, is refused
+    KNNClassifier corruptKnn(3);
+    const std::uintmax_t modelSize = std::filesystem::file_size(modelPath);
+    std::filesystem::resize_file(modelPath, modelSize - 4);
+    assertTrue(!corruptKnn.loadModel(modelPath), "KNN model file rejects a truncated file");
+    fixture.exact.saveModel(modelPath);
+    patchFile(modelPath, labelOffsetField, 1 << 20);
+    assertTrue(!corruptKnn.loadModel(modelPath) && corruptKnn.size() == 0, "KNN model file rejects a label offset past the norms");
+
+    // cols = stride = 2^62 match paddedSize() but make stride * sizeof(float) wrap to 0
+    const std::streamoff colsField = 16;
+    const std::streamoff strideField = 24;
+    const std::streamoff projectionOffsetField = 56;
+    fixture.exact.saveModel(modelPath);
+    for (const std::streamoff field : {colsField, strideField}) {
+        patchFile(modelPath, field, 0);
+        patchFile(modelPath, field + 4, 1 << 30);
+    }
+    assertTrue(!corruptKnn.loadModel(modelPath), "KNN model file rejects a column count larger than the file");
+
+    // a projection block pointing back into the labels is refused before it is parsed
+    patchFile(pcaModelPath, projectionOffsetField, 64);
+    patchFile(pcaModelPath, projectionOffsetField + 4, 0);
+    assertTrue(!corruptKnn.loadModel(pcaModelPath), "KNN model file rejects a projection offset inside the rows");
+    std::filesystem::remove_all(modelDir);
+}
+
+void TestSuite::testKNNPivot() {
+    std::cout << "\n=== Test: KNN pivot pruning ===\n";
+
+    KNNFixture fixture;
+    KNNClassifier pivotKnn(3);
+    pivotKnn.setSearchMode(KNNSearchMode::Pivot);
+    pivotKnn.setPivotParams({8, 4, 42});
+    pivotKnn.train(&fixture.reference);
+    assertTrue(pivotKnn.hasIndex(), "KNN pivot pruning builds its pivot table on training");
+    assertTrue(fixture.sameNeighbors(pivotKnn), "KNN pivot pruning matches exact neighbors");
+}
+
+void TestSuite::testKNNCascade() {
+    std::cout << "\n=== Test: KNN cascade ===\n";
+
+    // a shortlist covering every row leaves nothing for the coarse stage to drop
+    KNNFixture fixture;
+    KNNClassifier cascadeKnn(3);
+    cascadeKnn.setFeatureLayout(fixture.extractor.getKNNFeatureLayout(28, 28));
+    cascadeKnn.setSearchMode(KNNSearchMode::Cascade);
+    cascadeKnn.setCascadeShortlist(static_cast<int>(fixture.reference.size()));
+    cascadeKnn.train(&fixture.reference);
+    assertTrue(cascadeKnn.hasIndex(), "KNN cascade builds its coarse features on training");
+    assertTrue(fixture.sameNeighbors(cascadeKnn), "KNN cascade with a full shortlist matches exact neighbors");
+}
+
+void TestSuite::testKNNPCA() {
+    std::cout << "\n=== Test: KNN PCA projection ===\n";
+
+    // queries go through the same projection as the stored rows, so a training sample finds itself
+    KNNFixture fixture;
+    KNNClassifier pcaKnn(3);
+    PCAParams pcaParams;
+    pcaParams.components = 20;
+    pcaKnn.setPCAParams(pcaParams);
+    pcaKnn.train(&fixture.reference);
+
+    assertTrue(pcaKnn.projectedDim() == 20, "KNN with PCA keeps the requested number of components");
+    assertTrue(pcaKnn.explainedVariance() > 0.0 && pcaKnn.explainedVariance() <= 1.0, "KNN with PCA reports an explained variance in (0, 1]");
+
+    bool findsItself = true;
+    for (std::size_t i = 0; i < 20; i++) {
+        findsItself = findsItself && pcaKnn.nearestRows(fixture.reference[i].features).front() == static_cast<int>(i);
+    }
+    assertTrue(findsItself, "KNN with PCA projects queries like the stored samples");
+
+    // the compressed model stores the projection after the labels: header (24 bytes), rows x int32,
+    // then outputDim, inputDim; an input size that does not match the features is refused unread
+    const std::filesystem::path modelDir = testDirectory("pca");
+    const std::string modelPath = (modelDir / "reference_pca.kpq").string();
+    KNNClassifier compressedKnn(3);
+    compressedKnn.setPCAParams(pcaParams);
+    compressedKnn.setSearchMode(KNNSearchMode::PQ);
+    compressedKnn.train(&fixture.reference);
+    KNNClassifier loadedKnn(3);
+    assertTrue(compressedKnn.saveCompressedModel(modelPath) && loadedKnn.loadCompressedModel(modelPath)
+        && loadedKnn.projectedDim() == 20, "KNN compressed model keeps the PCA projection");
+    const std::streamoff inputDimField = 24 + static_cast<std::streamoff>(fixture.reference.size() * sizeof(std::int32_t)) + 8;
+    patchFile(modelPath, inputDimField + 4, 1 << 30);
+    assertTrue(!loadedKnn.loadCompressedModel(modelPath), "KNN compressed model rejects a projection of the wrong size");
+    std::filesystem::remove_all(modelDir);
+
+    // a projection header larger than its block fails before allocating
+    const std::uint64_t lyingHeader[3] = {1ull << 20, 1ull << 40, 0};
+    std::stringstream stream;
+    stream.write(reinterpret_cast<const char*>(lyingHeader), sizeof(lyingHeader));
+    PCAProjection projection;
+    assertTrue(!projection.read(stream, sizeof(lyingHeader)) && projection.empty(), "PCA projection rejects a header sized beyond its block");
+}
+
+void TestSuite::testKNNIVF() {
+    std::cout << "\n=== Test: KNN IVF index ===\n";
+
+    // rows added after the build land in their nearest cell; probing every cell is an exact scan
+    KNNFixture fixture;
+    KNNClassifier ivfKnn(3);
+    IVFParams ivfParams;
+    ivfParams.lists = 8;
+    ivfParams.nprobe = 8;
+    ivfKnn.setSearchMode(KNNSearchMode::IVF);
+    ivfKnn.setIVFParams(ivfParams);
+    const std::vector<TrainingSample> firstHalf(fixture.reference.begin(), fixture.reference.begin() + 125);
+    const std::vector<TrainingSample> secondHalf(fixture.reference.begin() + 125, fixture.reference.end());
+    ivfKnn.train(&firstHalf);
+    ivfKnn.addSamples(secondHalf);
+
+    assertTrue(ivfKnn.hasIndex(), "KNN IVF keeps its index after samples are added");
+    assertTrue(ivfKnn.size() == fixture.reference.size(), "KNN IVF stores the added samples");
+    assertTrue(fixture.sameNeighbors(ivfKnn), "KNN IVF with inserted samples matches exact neighbors");
+}
+
+void TestSuite::testKNNOnline() {
+    std::cout << "\n=== Test: KNN online appends ===\n";
+
+    // samples appended while another thread keeps predicting are found by later queries
+    KNNFixture fixture;
+    const std::vector<TrainingSample> firstHalf(fixture.reference.begin(), fixture.reference.begin() + 125);
+    const std::vector<TrainingSample> secondHalf(fixture.reference.begin() + 125, fixture.reference.end());
+    KNNClassifier onlineKnn(3);
+    onlineKnn.train(&firstHalf);
+    std::thread writer([&]() {
+        for (const auto& sample : secondHalf) {
+            onlineKnn.appendSample(sample);
+        }
+    });
+    const std::vector<std::vector<float>> onlineQueries(16, fixture.reference.back().features);
+    onlineKnn.predictBatch(onlineQueries, 2);
+    writer.join();
+
+    assertTrue(onlineKnn.appendedCount() == secondHalf.size(), "KNN online appends are all pending before merging");
+    assertTrue(onlineKnn.size() == fixture.reference.size(), "KNN online appends count towards the size");
+    assertTrue(fixture.sameNeighbors(onlineKnn), "KNN online appends match exact neighbors before merging");
+    assertTrue(onlineKnn.mergeAppendedSamples() && onlineKnn.appendedCount() == 0, "KNN online merge empties the pending samples");
+    assertTrue(fixture.sameNeighbors(onlineKnn), "KNN online appends match exact neighbors after merging");
+}
+
+void TestSuite::testKNNSharded() {
+    std::cout << "\n=== Test: KNN sharded processes ===\n";
+
+    // three local shard processes, merged by the coordinator, answer like the single classifier
+    KNNFixture fixture;
+    const std::filesystem::path shardDir = testDirectory("shards");
+    const std::string shardPrefix = (shardDir / "reference").string();
+    const std::vector<std::string> shardModels = fixture.exact.saveShardModels(shardPrefix, 3);
+    std::vector<std::string> shardSockets;
+    std::vector<pid_t> shardPids;
+    for (std::size_t s = 0; s < shardModels.size(); s++) {
+        shardSockets.push_back(shardPrefix + ".shard" + std::to_string(s) + ".sock");
+        shardPids.push_back(startKNNShardProcess(shardModels[s], shardSockets.back(), 3));
+    }
+    assertTrue(shardModels.size() == 3, "KNN sharded model is split into three shard files");
+    assertTrue(std::all_of(shardPids.begin(), shardPids.end(), [](pid_t pid) { return pid > 0; }), "KNN shard processes start");
+
+    std::vector<std::vector<float>> shardQueries;
+    for (const auto& query : fixture.queries) {
+        shardQueries.push_back(query.features);
+    }
+
+    ShardedKNNClassifier shardedKnn;
+    const bool connected = shardedKnn.connect(shardSockets);
+    assertTrue(connected, "KNN sharded coordinator connects to every shard");
+    if (connected) {
+        assertTrue(shardedKnn.size() == fixture.reference.size(), "KNN shards hold every reference row between them");
+
+        const auto merged = shardedKnn.neighborsBatch(shardQueries);
+        const auto single = fixture.exact.neighborsBatch(shardQueries);
+        bool sameNeighbors = merged.size() == single.size();
+        for (std::size_t q = 0; sameNeighbors && q < shardQueries.size(); q++) {
+            sameNeighbors = merged[q].size() == single[q].size();
+            for (std::size_t i = 0; sameNeighbors && i < merged[q].size(); i++) {
+                sameNeighbors = merged[q][i].row == single[q][i].row && merged[q][i].label == single[q][i].label;
+            }
+        }
+        assertTrue(sameNeighbors, "KNN sharded over local processes finds the single classifier's neighbors");
+        assertTrue(shardedKnn.predictBatch(shardQueries) == fixture.exact.predictBatch(shardQueries),
+            "KNN sharded over local processes predicts like the single classifier");
+    }
+
+    // shards that never got the shutdown message (no connection) are killed, so none outlives the test
+    shardedKnn.shutdownShards();
+    bool exitedCleanly = true;
+    for (const pid_t pid : shardPids) {
+        if (pid <= 0) {
+            continue;
+        }
+        int status = 0;
+        pid_t waited = 0;
+        for (int attempt = 0; attempt < 200 && waited == 0; attempt++) {
+            waited = waitpid(pid, &status, WNOHANG);
+            if (waited == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+        if (waited == 0) {
+            kill(pid, SIGKILL);
+            waited = waitpid(pid, &status, 0);
+        }
+        exitedCleanly = exitedCleanly && waited == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    assertTrue(exitedCleanly, "KNN shard processes exit cleanly on shutdown");
+    std::filesystem::remove_all(shardDir);
+}
+
+void TestSuite::testFeatureExtraction() {
+    std::cout << "\n=== Test: Feature extraction ===\n";
+
+    // the one-sweep extractor reproduces the per-group extractors exactly, also when the
+    // size does not divide into the zoning grid and on multi-channel images
+    FeatureExtractor extractor;
+    std::mt19937 rng(7);
+    std::vector<ImageMatrix> oddDigits(3, ImageMatrix(30, 29, 3));
+    for (auto& digit : oddDigits) {
+        for (auto& value : digit.data) {
+            value = static_cast<unsigned char>(rng() % 256);
+        }
+    }
+    const std::size_t oddDims = static_cast<std::size_t>(extractor.getKNNFeatureDimensions(30, 29));
+    FeatureMatrix oddFeatures(oddDigits.size(), oddDims);
+    extractor.extractKNNFeaturesBatch(oddDigits, oddFeatures.row(0), oddFeatures.stride());
+
+    bool sameSize = true;
+    bool sameFusedFeatures = true;
+    bool zeroPadding = true;
+    for (std::size_t i = 0; i < oddDigits.size(); i++) {
+        std::vector<float> expected = extractor.extractPixelFeatures(oddDigits[i]);
+        const auto zoning = extractor.extractZoningFeatures(oddDigits[i]);
+        const auto projection = extractor.extractProjectionFeatures(oddDigits[i]);
+        expected.insert(expected.end(), zoning.begin(), zoning.end());
+        expected.insert(expected.end(), projection.begin(), projection.end());
+
+        sameSize = sameSize && expected.size() == oddDims;
+        sameFusedFeatures = sameFusedFeatures && sameSize && std::equal(expected.begin(), expected.end(), oddFeatures.row(i));
+        zeroPadding = zeroPadding && oddFeatures.row(i)[oddDims] == 0.0f;
+    }
+    assertTrue(sameSize, "KNN feature dimensions match the per-group extractors' output");
+    assertTrue(sameFusedFeatures, "KNN one-pass feature extraction matches the per-group extractors");
+    assertTrue(zeroPadding, "KNN one-pass feature extraction leaves the row padding zero");
+}
+
+void TestSuite::testImageView() {
+    std::cout << "\n=== Test: Image views ===\n";
+
+    // a strided crop reads the same pixels as a packed copy of the region, and crops clip to the image
+    FeatureExtractor extractor;
+    std::mt19937 rng(11);
+    ImageMatrix digit(30, 29, 3);
+    for (auto& value : digit.data) {
+        value = static_cast<unsigned char>(rng() % 256);
+    }
+    const ImageView crop = digit.view(3, 2, 20, 21);
+    const ImageMatrix cropCopy(crop);
+    const ImageView clipped = digit.view(25, 25, 10, 10);
+    assertTrue(!crop.contiguous() && cropCopy.view().contiguous(), "Image crop is strided and its copy packed");
+    assertTrue(crop(20, 19, 2) == digit(22, 22, 2), "Image crop addresses the pixels of its region");
+    assertTrue(clipped.width == 5 && clipped.height == 4, "Image crop clips to the image");
+    assertTrue(extractor.extractKNNFeatures(crop) == extractor.extractKNNFeatures(cropCopy),
+        "Image views extract the same KNN features as packed copies");
+    assertTrue(extractor.extractNeuralNetworkFeatures(crop) == extractor.extractNeuralNetworkFeatures(cropCopy),
+        "Image views extract the same neural network features as packed copies");
+
+    // digits found in a region of a scan match those found in a copy of that region (the short bar is too small to count)
+    ImageMatrix scan(140, 60, 3, 0);
+    for (int y = 10; y < 45; y++) {
+        for (int x = 0; x < 140; x++) {
+            const bool stroke = (x >= 20 && x < 36) || (x >= 64 && x < 76) || (x >= 100 && x < 118 && y > 30);
+            for (int c = 0; stroke && c < 3; c++) {
+                scan(y, x, c) = 220;
+            }
+        }
+    }
+    Preprocessor preprocessor;
+    const ImageView region = scan.view(10, 4, 120, 50);
+    const std::vector<ImageMatrix> regionDigits = preprocessor.extractDigits(region);
+    const std::vector<ImageMatrix> copiedDigits = preprocessor.extractDigits(ImageMatrix(region));
+    assertTrue(regionDigits.size() == 2, "Digits are found in a region of a scan");
+    bool sameDigits = regionDigits.size() == copiedDigits.size();
+    for (std::size_t i = 0; sameDigits && i < regionDigits.size(); i++) {
+        sameDigits = regionDigits[i].width == 28 && regionDigits[i].data == copiedDigits[i].data;
+    }
+    assertTrue(sameDigits, "Image views extract the same digits as packed copies");
+}
+
+void TestSuite::testFeatureCache() {
+    std::cout << "\n=== Test: Feature cache ===\n";
+
+    // a cached dataset comes back as a mapped view with the same rows; the key follows file and config
+    const std::filesystem::path cacheDir = testDirectory("feature_cache");
+    const std::string sourcePath = (cacheDir / "source.idx").string();
+    std::ofstream(sourcePath, std::ios::binary) << "idx bytes";
+
+    FeatureExtractor extractor;
+    const FeatureDataset referenceSet = FeatureDataset::fromSamples(randomDigitSamples(extractor, 40, 7));
+    FeatureCache cache((cacheDir / "entries").string());
+    const std::uint64_t cacheKey = FeatureCache::key({sourcePath}, "knn-v1");
+    FeatureDataset cached;
+    assertTrue(!cache.load(cacheKey, cached), "Feature cache misses before the entry is stored");
+    assertTrue(cache.store(cacheKey, referenceSet) && cache.load(cacheKey, cached), "Feature cache stores and loads an entry");
+    assertTrue(cached.storage != nullptr, "Feature cache entries load as a mapped view");
+    assertTrue(cached.labels == referenceSet.labels && cached.cols() == referenceSet.cols(), "Feature cache keeps labels and columns");
+    bool sameCached = cached.size() == referenceSet.size();
+    for (std::size_t i = 0; sameCached && i < referenceSet.size(); i++) {
+        sameCached = std::equal(referenceSet.features.row(i), referenceSet.features.row(i) + referenceSet.features.stride(),
+                                cached.features.row(i));
+    }
+    assertTrue(sameCached, "Feature cache round-trips the feature rows");
+    std::ofstream(sourcePath, std::ios::binary | std::ios::app) << "!";
+    assertTrue(cacheKey != 0 && FeatureCache::key({sourcePath}, "knn-v1") != cacheKey, "Feature cache key follows the file contents");
+    assertTrue(FeatureCache::key({sourcePath}, "knn-v2") != FeatureCache::key({sourcePath}, "knn-v1"), "Feature cache key follows the configuration");
+
+    // header: magic, version, key, rows (offset 16), ...; a row count of 2^62 + 40 wraps
+    // rows * stride * 4 back to the real size, so it must be refused before multiplying
+    patchFile(cache.entryPath(cacheKey), 20, 1 << 30);
+    FeatureDataset corrupt;
+    assertTrue(!cache.load(cacheKey, corrupt), "Feature cache rejects an entry whose row count overflows");
+    assertTrue(corrupt.size() == 0, "Feature cache leaves the dataset untouched on a rejected entry");
+
+    // cols = stride = 2^62 (offsets 24 and 32) match paddedSize() but wrap stride * sizeof(float) to 0
+    cache.store(cacheKey, referenceSet);
+    for (const std::streamoff field : {24, 32}) {
+        patchFile(cache.entryPath(cacheKey), field, 0);
+        patchFile(cache.entryPath(cacheKey), field + 4, 1 << 30);
+    }
+    assertTrue(!cache.load(cacheKey, corrupt), "Feature cache rejects an entry whose column count overflows");
+
+    std::filesystem::remove_all(cacheDir);
+}
+
+void TestSuite::testMNISTData() {
+    std::cout << "\n=== Test: MNIST IDX loading ===\n";
+
+    // mapped views and the loader's contiguous copy see the same pixels and labels
+    const std::filesystem::path dataDir = testDirectory("idx");
+    const std::string idxImages = (dataDir / "images.idx").string();
+    const std::string idxLabels = (dataDir / "labels.idx").string();
+    writeTinyIDXPair(idxImages, idxLabels);
+
+    MappedMNISTDataset mapped;
+    MNISTLoader idxLoader;
+    assertTrue(mapped.open(idxImages, idxLabels), "Mapped IDX dataset opens an image and label pair");
+    assertTrue(idxLoader.loadTestData(idxImages, idxLabels), "MNIST loader loads an IDX pair");
+    assertTrue(mapped.size() == 3 && mapped.imageWidth() == 3 && mapped.imageHeight() == 2, "Mapped IDX dataset reads the header");
+    assertTrue(mapped.labels().size() == 3 && mapped.labels()[2] == 9, "Mapped IDX dataset views the labels");
+    bool sameIdx = idxLoader.getTestData().size() == mapped.size();
+    for (std::size_t i = 0; sameIdx && i < mapped.size(); i++) {
+        const MNISTImageView view = mapped.image(i);
+        const MNISTImage copied = idxLoader.getTestData()[i];
+        sameIdx = copied.label == mapped.label(i) && view(1, 2) == static_cast<std::uint8_t>((i * 6 + 5) * 13)
+            && copied.image.pixels == idxLoader.getTestData().pixelData() + i * 6
+            && std::equal(view.pixels, view.pixels + 6, copied.image.pixels);
+    }
+    // streamed in chunks of 2 images: a full chunk, then the short tail, again after a rewind
+    MNISTStreamReader stream(2);
+    std::vector<std::size_t> chunkSizes;
+    assertTrue(stream.open(idxImages, idxLabels), "IDX stream opens an image and label pair");
+    bool sameStream = true;
+    bool readAll = true;
+    for (int pass = 0; pass < 2; pass++) {
+        readAll = stream.forEachChunk([&](const MNISTChunk& chunk) {
+            chunkSizes.push_back(chunk.size());
+            for (std::size_t i = 0; i < chunk.size(); i++) {
+                sameStream = sameStream && chunk.label(i) == mapped.label(chunk.first + i)
+                    && std::equal(chunk.image(i).pixels, chunk.image(i).pixels + 6, mapped.image(chunk.first + i).pixels);
+            }
+        }) && readAll;
+    }
+    assertTrue(readAll, "IDX stream reads every chunk twice without an error");
+    assertTrue(chunkSizes == std::vector<std::size_t>{2, 1, 2, 1}, "IDX stream hands out full chunks, then the short tail");
+    assertTrue(sameStream, "Streamed IDX chunks match the mapped images and labels");
+
+    assertTrue(sameIdx, "Mapped IDX dataset views match the loaded images and labels");
+
+    // a label file in place of the images fails the magic check
+    MappedMNISTDataset swapped;
+    assertTrue(!swapped.open(idxLabels, idxLabels) && !swapped.isOpen(), "Mapped IDX dataset rejects a file with the wrong magic");
+    std::filesystem::remove_all(dataDir);
+}
+
+void TestSuite::testGzipReader() {
+    std::cout << "\n=== Test: gzip-compressed IDX files ===\n";
+
+    // the tiny IDX pair gzip-compressed (gzip -9 -n): detected by magic, inflated by the loader and the stream
+    const std::filesystem::path dataDir = testDirectory("gzip");
+    const std::string idxImages = (dataDir / "images.idx").string();
+    const std::string idxLabels = (dataDir / "labels.idx").string();
+    writeTinyIDXPair(idxImages, idxLabels);
+    MappedMNISTDataset mapped;
+    mapped.open(idxImages, idxLabels);
+
+    const std::string gzImages = idxImages + ".gz";
+    const std::string gzLabels = idxLabels + ".gz";
+    {
+        const unsigned char imageGzip[] = {
+            0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x63, 0x60, 0xe0, 0x60, 0x66, 0x60, 0x60,
+            0x00, 0x61, 0x26, 0x30, 0xcd, 0x2b, 0xa5, 0x6e, 0xe2, 0xe8, 0x17, 0x9d, 0x51, 0xda, 0xd4, 0x3f, 0x67,
+            0xe5, 0xb6, 0xc3, 0x17, 0xee, 0x02, 0x00, 0xf1, 0x11, 0x26, 0xdd, 0x22, 0x00, 0x00, 0x00};
+        const unsigned char labelGzip[] = {
+            0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x63, 0x60, 0xe0, 0x60, 0x64, 0x60,
+            0x60, 0x60, 0x66, 0x67, 0xe4, 0x04, 0x00, 0xe4, 0x23, 0xc8, 0x6b, 0x0b, 0x00, 0x00, 0x00};
+        std::ofstream(gzImages, std::ios::binary).write(reinterpret_cast<const char*>(imageGzip), sizeof(imageGzip));
+        std::ofstream(gzLabels, std::ios::binary).write(reinterpret_cast<const char*>(labelGzip), sizeof(labelGzip));
+    }
+    MNISTLoader gzLoader;
+    MNISTStreamReader gzStream(2);
+    assertTrue(mapped.isOpen() && isGzipFile(gzImages) && !isGzipFile(idxImages), "gzip files are told apart by their magic bytes");
+    assertTrue(gzLoader.loadTestData(gzImages, gzLabels) && gzLoader.getTestData().size() == 3, "MNIST loader inflates a gzip pair");
+    assertTrue(std::equal(gzLoader.getTestData().pixelData(), gzLoader.getTestData().pixelData() + 18, mapped.image(0).pixels),
+        "gzip-compressed IDX images load like the raw pair");
+    assertTrue(gzStream.open(gzImages, gzLabels), "IDX stream opens a gzip pair");
+    bool sameGzip = true;
+    bool readAll = true;
+    for (int pass = 0; pass < 2; pass++) {
+        readAll = gzStream.forEachChunk([&](const MNISTChunk& chunk) {
+            for (std::size_t i = 0; i < chunk.size(); i++) {
+                sameGzip = sameGzip && chunk.label(i) == gzLoader.getTestData().label(chunk.first + i)
+                    && std::equal(chunk.image(i).pixels, chunk.image(i).pixels + 6, mapped.image(chunk.first + i).pixels);
+            }
+        }) && readAll;
+    }
+    assertTrue(readAll, "IDX stream inflates a gzip pair twice without an error");
+    assertTrue(sameGzip, "gzip-compressed IDX files stream like the raw pair");
+
+    // a damaged CRC only shows in the trailer after the last image, which still fails the load
+    patchFile(gzImages, static_cast<std::streamoff>(std::filesystem::file_size(gzImages)) - 8, 0);
+    MNISTLoader corruptLoader;
+    MNISTStreamReader corruptStream(2);
+    assertTrue(!corruptLoader.loadTestData(gzImages, gzLabels), "MNIST loader rejects a gzip file with a bad CRC");
+    assertTrue(corruptStream.open(gzImages, gzLabels) && !corruptStream.forEachChunk([](const MNISTChunk&) {}) && corruptStream.failed(),
+        "IDX stream reports a gzip file with a bad CRC as a read error");
+    // a member cut short fails its read instead of yielding partial images
+    std::filesystem::resize_file(gzImages, 30);
+    MNISTLoader truncatedLoader;
+    assertTrue(!truncatedLoader.loadTestData(gzImages, gzLabels), "MNIST loader rejects a truncated gzip file");
+
+    // headers claiming 0xffffffff images of 65535x65535 over a few bytes: nothing is allocated up front
+    {
+        const unsigned char imageGzip[] = {
+            0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x63, 0x60, 0xe0, 0x60, 0xfe, 0x0f, 0x04,
+            0x0c, 0x0c, 0x50, 0xcc, 0x2b, 0xa5, 0x6e, 0xe2, 0xe8, 0x17, 0x9d, 0x51, 0xda, 0xd4, 0x3f, 0x67, 0xe5,
+            0xb6, 0xc3, 0x17, 0xee, 0x02, 0x00, 0xf8, 0xd3, 0x61, 0xd4, 0x22, 0x00, 0x00, 0x00};
+        const unsigned char labelGzip[] = {
+            0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x63, 0x60, 0xe0, 0x60, 0xfc, 0x0f,
+            0x04, 0xec, 0x8c, 0x9c, 0x00, 0x8b, 0xac, 0xee, 0x1b, 0x0b, 0x00, 0x00, 0x00};
+        std::ofstream(gzImages, std::ios::binary | std::ios::trunc).write(reinterpret_cast<const char*>(imageGzip), sizeof(imageGzip));
+        std::ofstream(gzLabels, std::ios::binary | std::ios::trunc).write(reinterpret_cast<const char*>(labelGzip), sizeof(labelGzip));
+    }
+    MNISTLoader lyingLoader;
+    MNISTStreamReader lyingStream;
+    assertTrue(!lyingLoader.loadTestData(gzImages, gzLabels), "MNIST loader rejects a gzip pair whose header overstates its images");
+    assertTrue(lyingLoader.getTestData().size() == 0, "MNIST loader keeps no images from a lying gzip header");
+    assertTrue(lyingStream.open(gzImages, gzLabels), "IDX stream opens a gzip pair with a lying header");
+    assertTrue(!lyingStream.forEachChunk([](const MNISTChunk&) {}), "IDX stream reports a lying gzip header as a read error");
+
+    mapped.close();
+    std::filesystem::remove_all(dataDir);
+}
+
+void TestSuite::testBatchLoader() {
+    std::cout << "\n=== Test: Minibatch loader ===\n";
+
+    // 10 rows in batches of 3: every epoch hands out each row once, the last batch short;
+    // row i holds the value i in every column and has label i
+    std::vector<TrainingSample> samples;
+    for (int i = 0; i < 10; i++) {
+        samples.push_back({std::vector<float>(3, static_cast<float>(i)), i});
+    }
+    const FeatureDataset rows = FeatureDataset::fromSamples(samples);
+
+    for (const bool shuffle : {false, true}) {
+        BatchLoaderParams params;
+        params.shuffle = shuffle;
+        BatchLoader loader(rows, 3, 2, params);
+        Batch batch;
+        std::vector<int> epochLabels;
+        const std::string mode = shuffle ? " (shuffled)" : " (in order)";
+        bool batchShapes = true;
+        bool rowsMatchLabels = true;
+        bool inOrder = true;
+        bool eachOnce = true;
+        std::size_t batches = 0;
+        for (; loader.next(batch); batches++) {
+            batchShapes = batchShapes && batch.y.size() == (batches % 4 == 3 ? 1u : 3u) && batch.X.cols == 3;
+            for (std::size_t r = 0; r < batch.y.size(); r++) {
+                rowsMatchLabels = rowsMatchLabels && batch.X(static_cast<int>(r), 2) == static_cast<float>(batch.y[r]);
+                epochLabels.push_back(batch.y[r]);
+            }
+            if (batches % 4 == 3) {
+                inOrder = inOrder && std::is_sorted(epochLabels.begin(), epochLabels.end());
+                std::sort(epochLabels.begin(), epochLabels.end());
+                eachOnce = eachOnce && epochLabels.size() == 10
+                    && std::adjacent_find(epochLabels.begin(), epochLabels.end()) == epochLabels.end();
+                epochLabels.clear();
+            }
+        }
+        assertTrue(loader.batchesPerEpoch() == 4 && batches == 8, "BatchLoader hands out every batch of both epochs" + mode);
+        assertTrue(batchShapes, "BatchLoader batches are full except the last of each epoch" + mode);
+        assertTrue(rowsMatchLabels, "BatchLoader batch rows keep their labels" + mode);
+        assertTrue(eachOnce, "BatchLoader delivers every row once per epoch" + mode);
+        if (!shuffle) {
+            assertTrue(inOrder, "BatchLoader keeps dataset order without shuffling");
+        }
+    }
+
+    // the producer is blocked on a full ring here; the destructor must wake and join it
+    bool stopped = false;
+    {
+        BatchLoader loader(rows, 3, 1000);
+        Batch batch;
+        stopped = loader.next(batch) && batch.y.size() == 3;
+    }
+    assertTrue(stopped, "BatchLoader stops its producer when destroyed mid-epoch");
+}
+
+void TestSuite::testEuclideanDistance() {
+    std::cout << "\n=== Test: Distance kernel (" << distanceKernelName() << ") ===\n";
+
+    // lengths around the SIMD widths, plus the padded MNIST feature size
+    const std::size_t lengths[] = {0, 1, 7, 8, 15, 16, 31, 33, 64, 100, 864};
+
+    for (std::size_t n : lengths) {
+        std::vector<float> a(n);
+        std::vector<float> b(n);
+        for (std::size_t i = 0; i < n; i++) {
+            a[i] = static_cast<float>((i * 37) % 101) / 101.0f;
+            b[i] = static_cast<float>((i * 53) % 97) / 97.0f;
+        }
+
+        const float expected = squaredL2DistanceScalar(a.data(), b.data(), n);
+        const float actual = squaredL2Distance(a.data(), b.data(), n);
+        assertEquals(actual, expected, 1e-4f * (1.0f + expected), "Squared L2, n=" + std::to_string(n));
+    }
+
+    const float a[] = {0.0f, 3.0f};
+    const float b[] = {4.0f, 0.0f};
+    assertEquals(squaredL2Distance(a, b, 2), 25.0f, 1e-6f, "Squared L2 of (0,3)-(4,0)");
+
+    // integer kernels must be exact, including the byte extremes
+    for (std::size_t n : lengths) {
+        std::vector<std::uint8_t> pixelsA(n);
+        std::vector<std::uint8_t> pixelsB(n);
+        std::vector<std::int16_t> sumsA(n);
+        std::vector<std::int16_t> sumsB(n);
+        std::uint64_t expectedPixels = 0;
+        std::uint64_t expectedSums = 0;
+
+        for (std::size_t i = 0; i < n; i++) {
+            pixelsA[i] = static_cast<std::uint8_t>(i % 3 == 0 ? 255 : (i * 37) % 256);
+            pixelsB[i] = static_cast<std::uint8_t>(i % 3 == 0 ? 0 : (i * 53) % 256);
+            sumsA[i] = static_cast<std::int16_t>((i * 997) % 12000);
+            sumsB[i] = static_cast<std::int16_t>((i * 331) % 12000);
+
+            const std::int64_t pixelDiff = pixelsA[i] - pixelsB[i];
+            const std::int64_t sumDiff = sumsA[i] - sumsB[i];
+            expectedPixels += pixelDiff * pixelDiff;
+            expectedSums += sumDiff * sumDiff;
+        }
+
+        assertTrue(squaredDistanceU8(pixelsA.data(), pixelsB.data(), n) == expectedPixels, "Squared u8, n=" + std::to_string(n));
+        assertTrue(squaredDistanceI16(sumsA.data(), sumsB.data(), n) == expectedSums, "Squared i16, n=" + std::to_string(n));
+    }
+
+    // 13 words = one binarized 28x28 digit
+    const std::uint64_t query[13] = {~0ull, 0, 0xF0F0F0F0F0F0F0F0ull, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0x8000000000000000ull};
+    std::uint64_t rows[2 * 13] = {};
+    rows[13 + 3] = 1;
+    std::uint32_t hamming[2] = {};
+    hammingDistanceRows(query, rows, 13, 2, hamming);
+    assertTrue(hamming[0] == 64 + 32 + 1 + 1 && hamming[1] == 64 + 32 + 1, "Hamming distance of packed rows");
+}
@@ -8,13 +8,33 @@
 class TestSuite {
 public:
     TestSuite() = default;
-    // void runAllTests();
+    void runAllTests();
 
     // Core algorithms tests
     void testKNN();
+    void testKNNQuantized();
+    void testKNNBinary();
+    void testKNNHNSW();
+    void testKNNPQ();
+    void testPrototypeSelection();
+    void testKNNModelFile();
+    void testKNNPivot();
+    void testKNNCascade();
+    void testKNNPCA();
+    void testKNNIVF();
+    void testKNNOnline();
+    void testKNNSharded();
+    void testBatchLoader();
     void testEuclideanDistance();
     void testPrepocessingPipeline();
 
+    // Features and data tests
+    void testFeatureExtraction();
+    void testImageView();
+    void testFeatureCache();
+    void testMNISTData();
+    void testGzipReader();
+
     // Accuracy tests
     void testMNISTAccuracy();
 